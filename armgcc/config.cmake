@@ -47,6 +47,11 @@ set(CONFIG_USE_driver_display-hx8394 true)
 set(CONFIG_USE_driver_display-rm68191 true)
 set(CONFIG_USE_driver_display-rm68200 true)
 set(CONFIG_USE_driver_lpi2c_freertos true)
+set(CONFIG_USE_driver_gpt true)
+set(CONFIG_USE_driver_edma true)
+set(CONFIG_USE_driver_dmamux true)
+set(CONFIG_USE_driver_lpi2c_edma true)
+set(CONFIG_USE_driver_pxp true)
 
 # 依赖
 set(CONFIG_USE_driver_memory true)
@@ -167,6 +167,7 @@ SET(CMAKE_EXE_LINKER_FLAGS_DEBUG " \
     -flto -ffat-lto-objects \
     ${FPU} \
     ${SPECS} \
+    -T\"${ProjDirPath}/mem_regions.ld\" \
     -T\"${ProjDirPath}/../platform/platform/boards/nxp/mimxrt1170-evkb-freertos/cmake/armgcc/MIMXRT1176xxxxx_cm7_flexspi_nor_sdram.ld\" -static \
 ")
 SET(CMAKE_EXE_LINKER_FLAGS_RELEASE " \
@@ -197,5 +198,6 @@ SET(CMAKE_EXE_LINKER_FLAGS_RELEASE " \
     -flto -ffat-lto-objects \
     ${FPU} \
     ${SPECS} \
+    -T\"${ProjDirPath}/mem_regions.ld\" \
     -T\"${ProjDirPath}/../platform/platform/boards/nxp/mimxrt1170-evkb-freertos/cmake/armgcc/MIMXRT1176xxxxx_cm7_flexspi_nor_sdram.ld\" -static \
 ")
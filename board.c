@@ -58,6 +58,13 @@ void BOARD_LPI2C_Init(LPI2C_Type *base, uint32_t clkSrc_Hz)
     LPI2C_MasterInit(base, &lpi2cConfig, clkSrc_Hz);
 }
 
+/* Every BOARD_LPI2C_* helper ends here. The application overrides it to route
+ * transfers on shared buses through its transaction queue (src/i2c_bus.cpp). */
+__WEAK status_t BOARD_LPI2C_Transfer(LPI2C_Type *base, lpi2c_master_transfer_t *xfer)
+{
+    return LPI2C_MasterTransferBlocking(base, xfer);
+}
+
 status_t BOARD_LPI2C_Send(LPI2C_Type *base,
                           uint8_t deviceAddress,
                           uint32_t subAddress,
@@ -75,7 +82,7 @@ status_t BOARD_LPI2C_Send(LPI2C_Type *base,
     xfer.data           = txBuff;
     xfer.dataSize       = txBuffSize;
 
-    return LPI2C_MasterTransferBlocking(base, &xfer);
+    return BOARD_LPI2C_Transfer(base, &xfer);
 }
 
 status_t BOARD_LPI2C_Receive(LPI2C_Type *base,
@@ -95,7 +102,7 @@ status_t BOARD_LPI2C_Receive(LPI2C_Type *base,
     xfer.data           = rxBuff;
     xfer.dataSize       = rxBuffSize;
 
-    return LPI2C_MasterTransferBlocking(base, &xfer);
+    return BOARD_LPI2C_Transfer(base, &xfer);
 }
 
 status_t BOARD_LPI2C_SendSCCB(LPI2C_Type *base,
@@ -115,7 +122,7 @@ status_t BOARD_LPI2C_SendSCCB(LPI2C_Type *base,
     xfer.data           = txBuff;
     xfer.dataSize       = txBuffSize;
 
-    return LPI2C_MasterTransferBlocking(base, &xfer);
+    return BOARD_LPI2C_Transfer(base, &xfer);
 }
 
 status_t BOARD_LPI2C_ReceiveSCCB(LPI2C_Type *base,
@@ -136,7 +143,7 @@ status_t BOARD_LPI2C_ReceiveSCCB(LPI2C_Type *base,
     xfer.data           = NULL;
     xfer.dataSize       = 0;
 
-    status = LPI2C_MasterTransferBlocking(base, &xfer);
+    status = BOARD_LPI2C_Transfer(base, &xfer);
 
     if (kStatus_Success == status)
     {
@@ -145,7 +152,7 @@ status_t BOARD_LPI2C_ReceiveSCCB(LPI2C_Type *base,
         xfer.data           = rxBuff;
         xfer.dataSize       = rxBuffSize;
 
-        status = LPI2C_MasterTransferBlocking(base, &xfer);
+        status = BOARD_LPI2C_Transfer(base, &xfer);
     }
 
     return status;
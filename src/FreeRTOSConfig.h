@@ -51,6 +51,13 @@ extern "C" {
 #include <stdint.h>
 extern uint32_t SystemCoreClock;
 
+/* runtime_stats.cpp */
+void RunTimeStats_InitCounter(void);
+uint64_t RunTimeStats_ReadCounter(void);
+
+/* tickless_idle.cpp */
+void TicklessIdle_Sleep(uint32_t expectedIdleTicks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -58,7 +65,15 @@ extern uint32_t SystemCoreClock;
 
 #define ucHeap __HeapBase
 #define configUSE_PREEMPTION 1
-#define configUSE_TICKLESS_IDLE 0
+/* APP_TICKLESS_IDLE=1 stops the tick while idle and sleeps until the next
+   deadline on GPT2 (see tickless_idle.h). */
+#ifndef APP_TICKLESS_IDLE
+#define APP_TICKLESS_IDLE 1
+#endif
+#define configUSE_TICKLESS_IDLE APP_TICKLESS_IDLE
+#if APP_TICKLESS_IDLE
+#define portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime) TicklessIdle_Sleep(xExpectedIdleTime)
+#endif
 #define configCPU_CLOCK_HZ (SystemCoreClock)
 #define configTICK_RATE_HZ ((TickType_t)1000)
 #define configMAX_PRIORITIES 5
@@ -67,6 +82,9 @@ extern uint32_t SystemCoreClock;
 #define configUSE_16_BIT_TICKS 0
 #define configIDLE_SHOULD_YIELD 1
 #define configUSE_TASK_NOTIFICATIONS 1
+/* Index 0 is the task's own event bits, index 1 blocking I2C transfers (i2c_bus.h),
+   index 2 framebuffer flips (framebuffer.h), index 3 PXP blits (blit_engine.h). */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 4
 #define configUSE_MUTEXES 1
 #define configUSE_RECURSIVE_MUTEXES 1
 #define configUSE_COUNTING_SEMAPHORES 1
@@ -84,7 +102,13 @@ extern uint32_t SystemCoreClock;
 #define configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H 1
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION 0
+/* APP_STATIC_ALLOCATION=1 creates all application tasks, queues and timers
+   from static buffers in DTCM (see static_alloc.h). The heap stays enabled
+   for C++ objects. */
+#ifndef APP_STATIC_ALLOCATION
+#define APP_STATIC_ALLOCATION 0
+#endif
+#define configSUPPORT_STATIC_ALLOCATION APP_STATIC_ALLOCATION
 #define configSUPPORT_DYNAMIC_ALLOCATION 1
 #define configTOTAL_HEAP_SIZE ((size_t)(1024 * 1024 * 15))
 #define configAPPLICATION_ALLOCATED_HEAP 1
@@ -97,7 +121,11 @@ extern uint32_t SystemCoreClock;
 #define configUSE_DAEMON_TASK_STARTUP_HOOK 0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS 0
+/* Driven by the DWT cycle counter, extended to 64 bits in software. */
+#define configGENERATE_RUN_TIME_STATS 1
+#define configRUN_TIME_COUNTER_TYPE uint64_t
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() RunTimeStats_InitCounter()
+#define portGET_RUN_TIME_COUNTER_VALUE() RunTimeStats_ReadCounter()
 #define configUSE_TRACE_FACILITY 1
 #define configUSE_STATS_FORMATTING_FUNCTIONS 0
 
@@ -125,7 +153,7 @@ extern uint32_t SystemCoreClock;
 /* Optional functions - most linkers will remove unused functions anyway. */
 #define INCLUDE_vTaskPrioritySet 0
 #define INCLUDE_uxTaskPriorityGet 0
-#define INCLUDE_vTaskDelete 0
+#define INCLUDE_vTaskDelete 1
 #define INCLUDE_vTaskSuspend 1
 #define INCLUDE_vTaskDelayUntil 1
 #define INCLUDE_vTaskDelay 1
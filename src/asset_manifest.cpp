@@ -0,0 +1,28 @@
+#include "asset_manifest.h"
+
+#include <platforminterface/log.h>
+
+#include "glyph_cache.h"
+
+#if !APP_ASSET_MANIFEST
+// The generated tables replace these.
+extern const ImageAsset AssetManifest_Images[1] = {};
+extern const uint32_t AssetManifest_ImageCount = 0;
+extern const AssetFont AssetManifest_Fonts[1] = {};
+extern const uint32_t AssetManifest_FontCount = 0;
+#endif
+
+void AssetManifest_Register() {
+  if (AssetManifest_ImageCount != 0U) {
+    ImageCache_SetAssets(AssetManifest_Images, AssetManifest_ImageCount);
+  }
+  for (uint32_t i = 0; i < AssetManifest_FontCount; i++) {
+    const AssetFont &font = AssetManifest_Fonts[i];
+    if (!GlyphCache_Prewarm(font.font, font.size, font.text, font.pin)) {
+      Qul::PlatformInterface::log("Prewarming font %u at %u px could not be queued\r\n", (unsigned)font.font,
+                                  (unsigned)font.size);
+    }
+  }
+  Qul::PlatformInterface::log("Asset manifest: %u images, %u font runs\r\n", (unsigned)AssetManifest_ImageCount,
+                              (unsigned)AssetManifest_FontCount);
+}
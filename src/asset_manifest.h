@@ -0,0 +1,40 @@
+#ifndef ASSET_MANIFEST_H
+#define ASSET_MANIFEST_H
+
+#include <stdint.h>
+
+#include "image_cache.h"
+
+// The images and fonts the application warms at boot.
+//
+// With APP_ASSET_MANIFEST (armgcc/CMakeLists.txt), tools/asset_manifest.py
+// turns the manifest file it names into these tables at build time: QOI
+// images embedded in flash as ImageAssets, and glyph runs per font and size.
+// The manifest belongs with the UI's assets, which are not part of this
+// tree; without it both tables are empty and the preloader has nothing to do.
+//
+// AssetManifest_Register() hands the images to the image cache, whose
+// preload-marked entries the preload task decodes (preload.h), and queues
+// the fonts with GlyphCache_Prewarm(). Those run on the Qul thread once the
+// glue registers its rasterizer, since the font engine is not thread safe,
+// not on the preload task.
+
+struct AssetFont {
+  uint16_t font; // the glue's font id, as in glyph_cache.h
+  uint16_t size; // pixels
+  const char *text;
+  bool pin;
+};
+
+// Generated, or empty without APP_ASSET_MANIFEST.
+extern const ImageAsset AssetManifest_Images[];
+extern const uint32_t AssetManifest_ImageCount;
+extern const AssetFont AssetManifest_Fonts[];
+extern const uint32_t AssetManifest_FontCount;
+
+// Registers the manifest's images with the image cache and queues its fonts
+// for prewarming. Call from main() after ImageCache_Init() and
+// GlyphCache_Init(), before the scheduler starts.
+void AssetManifest_Register();
+
+#endif // ASSET_MANIFEST_H
@@ -0,0 +1,226 @@
+#include "blit.h"
+
+// Round-to-nearest x / 255 for x <= 255 * 255.
+static inline uint32_t div255(uint32_t x) { return ((x + 128U) * 257U) >> 16; }
+
+static inline uint32_t unpack565(uint32_t p) {
+  const uint32_t r = (p >> 11) & 0x1FU;
+  const uint32_t g = (p >> 5) & 0x3FU;
+  const uint32_t b = p & 0x1FU;
+  return 0xFF000000U | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+static inline uint32_t unpack4444(uint32_t p) {
+  return ((p >> 12) & 0xFU) * 0x11000000U | ((p >> 8) & 0xFU) * 0x110000U | ((p >> 4) & 0xFU) * 0x1100U |
+         (p & 0xFU) * 0x11U;
+}
+
+static inline uint16_t pack565(uint32_t c) {
+  return (uint16_t)(((c >> 8) & 0xF800U) | ((c >> 5) & 0x07E0U) | ((c >> 3) & 0x001FU));
+}
+
+static inline uint16_t pack4444(uint32_t c) {
+  return (uint16_t)(((c >> 16) & 0xF000U) | ((c >> 12) & 0x0F00U) | ((c >> 8) & 0x00F0U) | ((c >> 4) & 0x000FU));
+}
+
+// Gathers count source pixels at base[offsets[i]] into ARGB8888.
+typedef void (*FetchFn)(uint32_t *line, const void *base, const uint32_t *offsets, uint32_t count);
+// Converts count destination pixels to ARGB8888.
+typedef void (*LoadFn)(uint32_t *line, const void *pixels, uint32_t count);
+typedef void (*StoreFn)(void *pixels, const uint32_t *line, uint32_t count);
+
+static void fetch565(uint32_t *line, const void *base, const uint32_t *offsets, uint32_t count) {
+  const uint16_t *src = static_cast<const uint16_t *>(base);
+  for (uint32_t i = 0; i < count; i++) {
+    line[i] = unpack565(src[offsets[i]]);
+  }
+}
+
+static void fetch4444(uint32_t *line, const void *base, const uint32_t *offsets, uint32_t count) {
+  const uint16_t *src = static_cast<const uint16_t *>(base);
+  for (uint32_t i = 0; i < count; i++) {
+    line[i] = unpack4444(src[offsets[i]]);
+  }
+}
+
+static void fetch8888(uint32_t *line, const void *base, const uint32_t *offsets, uint32_t count) {
+  const uint32_t *src = static_cast<const uint32_t *>(base);
+  for (uint32_t i = 0; i < count; i++) {
+    line[i] = src[offsets[i]];
+  }
+}
+
+static void load565(uint32_t *line, const void *pixels, uint32_t count) {
+  const uint16_t *src = static_cast<const uint16_t *>(pixels);
+  for (uint32_t i = 0; i < count; i++) {
+    line[i] = unpack565(src[i]);
+  }
+}
+
+static void load4444(uint32_t *line, const void *pixels, uint32_t count) {
+  const uint16_t *src = static_cast<const uint16_t *>(pixels);
+  for (uint32_t i = 0; i < count; i++) {
+    line[i] = unpack4444(src[i]);
+  }
+}
+
+static void load8888(uint32_t *line, const void *pixels, uint32_t count) {
+  const uint32_t *src = static_cast<const uint32_t *>(pixels);
+  for (uint32_t i = 0; i < count; i++) {
+    line[i] = src[i];
+  }
+}
+
+static void store565(void *pixels, const uint32_t *line, uint32_t count) {
+  uint16_t *dst = static_cast<uint16_t *>(pixels);
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = pack565(line[i]);
+  }
+}
+
+static void store4444(void *pixels, const uint32_t *line, uint32_t count) {
+  uint16_t *dst = static_cast<uint16_t *>(pixels);
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = pack4444(line[i]);
+  }
+}
+
+static void store8888(void *pixels, const uint32_t *line, uint32_t count) {
+  uint32_t *dst = static_cast<uint32_t *>(pixels);
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = line[i];
+  }
+}
+
+// dst = src over dst, src alpha scaled by opacity.
+static void blendLine(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t opacity) {
+  for (uint32_t i = 0; i < count; i++) {
+    const uint32_t s = src[i];
+    const uint32_t d = dst[i];
+    const uint32_t a = div255((s >> 24) * opacity);
+    const uint32_t ia = 255U - a;
+    const uint32_t r = div255(((s >> 16) & 0xFFU) * a + ((d >> 16) & 0xFFU) * ia);
+    const uint32_t g = div255(((s >> 8) & 0xFFU) * a + ((d >> 8) & 0xFFU) * ia);
+    const uint32_t b = div255((s & 0xFFU) * a + (d & 0xFFU) * ia);
+    const uint32_t outA = a + div255((d >> 24) * ia);
+    dst[i] = outA << 24 | r << 16 | g << 8 | b;
+  }
+}
+
+uint32_t Blit_BytesPerPixel(PixelFormat format) { return format == PixelFormat::Argb8888 ? 4U : 2U; }
+
+bool Blit_Valid(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op) {
+  return dst.pixels != nullptr && src.pixels != nullptr && src.width != 0U && src.height != 0U &&
+         op.width != 0U && op.height != 0U && op.width <= BLIT_MAX_LINE &&
+         (uint32_t)op.x + op.width <= dst.width && (uint32_t)op.y + op.height <= dst.height &&
+         dst.stride % Blit_BytesPerPixel(dst.format) == 0U && src.stride % Blit_BytesPerPixel(src.format) == 0U;
+}
+
+static bool rotated(BlitRotation rotation) {
+  return rotation == BlitRotation::Rot90 || rotation == BlitRotation::Rot270;
+}
+
+// Line buffers and the column table of the blit in progress.
+static uint32_t s_line[BLIT_MAX_LINE];
+static uint32_t s_dstLine[BLIT_MAX_LINE];
+static uint32_t s_columns[BLIT_MAX_LINE];
+
+bool Blit_Cpu(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op) {
+  if (!Blit_Valid(dst, src, op)) {
+    return false;
+  }
+  // Source pixel of destination (u, v): undo the rotation into the unrotated
+  // wr x hr rectangle, then scale that down or up to the source.
+  const uint32_t wr = rotated(op.rotation) ? op.height : op.width;
+  const uint32_t hr = rotated(op.rotation) ? op.width : op.height;
+  const uint32_t pitch = src.stride / Blit_BytesPerPixel(src.format);
+  const uint32_t sw = src.width;
+  const uint32_t sh = src.height;
+  for (uint32_t u = 0; u < op.width; u++) {
+    switch (op.rotation) {
+    case BlitRotation::None:
+      s_columns[u] = u * sw / wr;
+      break;
+    case BlitRotation::Rot90:
+      s_columns[u] = (hr - 1U - u) * sh / hr * pitch;
+      break;
+    case BlitRotation::Rot180:
+      s_columns[u] = (wr - 1U - u) * sw / wr;
+      break;
+    case BlitRotation::Rot270:
+      s_columns[u] = u * sh / hr * pitch;
+      break;
+    }
+  }
+
+  const FetchFn fetch = src.format == PixelFormat::Rgb565     ? fetch565
+                        : src.format == PixelFormat::Argb4444 ? fetch4444
+                                                              : fetch8888;
+  const LoadFn load = dst.format == PixelFormat::Rgb565     ? load565
+                      : dst.format == PixelFormat::Argb4444 ? load4444
+                                                            : load8888;
+  const StoreFn store = dst.format == PixelFormat::Rgb565     ? store565
+                        : dst.format == PixelFormat::Argb4444 ? store4444
+                                                              : store8888;
+  const uint32_t srcBpp = Blit_BytesPerPixel(src.format);
+  const uint32_t dstBpp = Blit_BytesPerPixel(dst.format);
+  for (uint32_t v = 0; v < op.height; v++) {
+    uint32_t row = 0;
+    switch (op.rotation) {
+    case BlitRotation::None:
+      row = v * sh / hr * pitch;
+      break;
+    case BlitRotation::Rot90:
+      row = v * sw / wr;
+      break;
+    case BlitRotation::Rot180:
+      row = (hr - 1U - v) * sh / hr * pitch;
+      break;
+    case BlitRotation::Rot270:
+      row = (wr - 1U - v) * sw / wr;
+      break;
+    }
+    fetch(s_line, static_cast<const uint8_t *>(src.pixels) + row * srcBpp, s_columns, op.width);
+    void *out = static_cast<uint8_t *>(dst.pixels) + (op.y + v) * dst.stride + op.x * dstBpp;
+    if (op.blend) {
+      load(s_dstLine, out, op.width);
+      blendLine(s_dstLine, s_line, op.width, op.opacity);
+      store(out, s_dstLine, op.width);
+    } else {
+      store(out, s_line, op.width);
+    }
+  }
+  return true;
+}
+
+bool Blit_CpuMask(const BlitSurface &dst, const uint8_t *mask, uint32_t pitch, uint16_t width, uint16_t height,
+                  int32_t x, int32_t y, uint32_t argb) {
+  const int32_t left = x < 0 ? -x : 0;
+  const int32_t top = y < 0 ? -y : 0;
+  const int32_t right = x + width > dst.width ? dst.width - x : width;
+  const int32_t bottom = y + height > dst.height ? dst.height - y : height;
+  if (dst.pixels == nullptr || mask == nullptr || left >= right || top >= bottom || dst.width > BLIT_MAX_LINE ||
+      dst.stride % Blit_BytesPerPixel(dst.format) != 0U) {
+    return false;
+  }
+  const LoadFn load = dst.format == PixelFormat::Rgb565     ? load565
+                      : dst.format == PixelFormat::Argb4444 ? load4444
+                                                            : load8888;
+  const StoreFn store = dst.format == PixelFormat::Rgb565     ? store565
+                        : dst.format == PixelFormat::Argb4444 ? store4444
+                                                              : store8888;
+  const uint32_t dstBpp = Blit_BytesPerPixel(dst.format);
+  const uint32_t count = (uint32_t)(right - left);
+  const uint32_t rgb = argb & 0xFFFFFFU;
+  for (int32_t v = top; v < bottom; v++) {
+    const uint8_t *coverage = mask + v * pitch + left;
+    for (uint32_t i = 0; i < count; i++) {
+      s_line[i] = (uint32_t)coverage[i] << 24 | rgb;
+    }
+    void *out = static_cast<uint8_t *>(dst.pixels) + (y + v) * dst.stride + (x + left) * dstBpp;
+    load(s_dstLine, out, count);
+    blendLine(s_dstLine, s_line, count, argb >> 24);
+    store(out, s_dstLine, count);
+  }
+  return true;
+}
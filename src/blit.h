@@ -0,0 +1,76 @@
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <stdint.h>
+
+#include "framebuffer.h"
+
+// Rotating, scaling, converting and blending blits on the CPU.
+//
+// A blit maps the whole source surface onto the destination rectangle
+// op.x, op.y, op.width x op.height: the source is scaled with
+// nearest-neighbour sampling to the rectangle's unrotated size (height x
+// width for Rot90 and Rot270), then rotated clockwise by op.rotation, the
+// order the PXP applies them in. Without op.blend the destination pixels are
+// replaced; with it the source is composited source-over with its own alpha
+// times op.opacity. RGB565 destinations have no alpha and stay opaque.
+//
+// The conversions and rounding are fixed, so tools/blit_bench.cpp can check
+// the kernel against a reference bit for bit:
+//   - 5/6/4-bit channels widen by bit replication, narrow by truncation;
+//   - every product of two 8-bit values is divided by 255 rounded to nearest:
+//       a   = div255(srcA * opacity)
+//       c   = div255(srcC * a + dstC * (255 - a))
+//       out = a + div255(dstA * (255 - a))
+//
+// The kernel works a line at a time: fetch (rotation and scaling become a
+// precomputed per-column offset table, so the inner loop is a branch-free
+// gather), blend and pack each run as a separate loop over plain uint32_t
+// arrays, which the compiler unrolls and, on hosts, vectorises. The line
+// buffers are static: call from one task only (the render thread).
+//
+// Source and destination must not overlap, and their pitches must be whole
+// pixels.
+
+#ifndef BLIT_MAX_LINE
+#define BLIT_MAX_LINE 1280
+#endif
+
+enum class BlitRotation : uint8_t { None, Rot90, Rot180, Rot270 };
+
+struct BlitSurface {
+  void *pixels;
+  uint32_t stride; // bytes
+  uint16_t width;
+  uint16_t height;
+  PixelFormat format;
+};
+
+struct BlitOp {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width; // destination size, after rotation
+  uint16_t height;
+  BlitRotation rotation;
+  bool blend;
+  uint8_t opacity;
+};
+
+uint32_t Blit_BytesPerPixel(PixelFormat format);
+
+// false if the destination rectangle is not inside dst, a surface is empty or
+// wider than BLIT_MAX_LINE.
+bool Blit_Valid(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op);
+
+// Returns false, touching nothing, if !Blit_Valid.
+bool Blit_Cpu(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op);
+
+// An 8-bit coverage mask (glyph alpha map) of width x height, pitch bytes
+// per line, at x, y in dst: argb is composited source-over with its alpha
+// times the coverage, by the same rules as a blended Blit_Cpu. The mask may
+// reach outside dst, the part inside is drawn. Returns false, touching
+// nothing, if no part is inside or dst is wider than BLIT_MAX_LINE.
+bool Blit_CpuMask(const BlitSurface &dst, const uint8_t *mask, uint32_t pitch, uint16_t width, uint16_t height,
+                  int32_t x, int32_t y, uint32_t argb);
+
+#endif // BLIT_H
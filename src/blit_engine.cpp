@@ -0,0 +1,291 @@
+#include "blit_engine.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+#if BLIT_USE_PXP
+#include <fsl_pxp.h>
+#endif
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+
+static std::atomic<bool> s_pxp{BLIT_USE_PXP != 0};
+
+// Render thread only; the console reads them under vTaskSuspendAll.
+static BlitPathStats s_pathStats[2];
+static uint32_t s_fallbacks[(int)BlitFallback::Count];
+
+static void record(BlitPath path, const BlitOp &op, uint32_t cycles) {
+  BlitPathStats &stats = s_pathStats[(int)path];
+  stats.blits++;
+  stats.pixels += (uint32_t)op.width * op.height;
+  stats.cycles += cycles;
+}
+
+#if BLIT_USE_PXP
+static TaskHandle_t s_waiter;
+static std::atomic<bool> s_done{false};
+
+static void setupPxp() {
+  PXP_Init(PXP);
+  PXP_EnableCsc1(PXP, false);
+  PXP_SetProcessSurfaceBackGroundColor(PXP, 0U);
+  PXP_ClearStatusFlags(PXP, kPXP_CompleteFlag);
+  PXP_EnableInterrupts(PXP, kPXP_CompleteInterruptEnable);
+}
+
+extern "C" void PXP_IRQHandler(void) {
+  PXP_ClearStatusFlags(PXP, kPXP_CompleteFlag);
+  s_done.store(true, std::memory_order_release);
+  BaseType_t woken = pdFALSE;
+  if (s_waiter != NULL) {
+    vTaskNotifyGiveIndexedFromISR(s_waiter, BLIT_NOTIFY_INDEX, &woken);
+  }
+  portYIELD_FROM_ISR(woken);
+  SDK_ISR_EXIT_BARRIER;
+}
+
+static pxp_ps_pixel_format_t psFormat(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::Rgb565:
+    return kPXP_PsPixelFormatRGB565;
+  case PixelFormat::Argb4444:
+    return kPXP_PsPixelFormatRGB444;
+  default:
+    return kPXP_PsPixelFormatRGB888;
+  }
+}
+
+static pxp_as_pixel_format_t asFormat(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::Rgb565:
+    return kPXP_AsPixelFormatRGB565;
+  case PixelFormat::Argb4444:
+    return kPXP_AsPixelFormatARGB4444;
+  default:
+    return kPXP_AsPixelFormatARGB8888;
+  }
+}
+
+static pxp_output_pixel_format_t outputFormat(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::Rgb565:
+    return kPXP_OutputPixelFormatRGB565;
+  case PixelFormat::Argb4444:
+    return kPXP_OutputPixelFormatARGB4444;
+  default:
+    return kPXP_OutputPixelFormatARGB8888;
+  }
+}
+
+static pxp_rotate_degree_t rotateDegree(BlitRotation rotation) {
+  switch (rotation) {
+  case BlitRotation::Rot90:
+    return kPXP_Rotate90;
+  case BlitRotation::Rot180:
+    return kPXP_Rotate180;
+  case BlitRotation::Rot270:
+    return kPXP_Rotate270;
+  default:
+    return kPXP_Rotate0;
+  }
+}
+
+static bool hasAlpha(PixelFormat format) { return format != PixelFormat::Rgb565; }
+
+// True if the PXP reproduces the blit, otherwise why not.
+static bool pxpEligible(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op, BlitFallback &reason) {
+  const bool swap = op.rotation == BlitRotation::Rot90 || op.rotation == BlitRotation::Rot270;
+  const uint32_t wr = swap ? op.height : op.width;
+  const uint32_t hr = swap ? op.width : op.height;
+  if (!s_pxp.load(std::memory_order_relaxed)) {
+    reason = BlitFallback::Disabled;
+  } else if (op.blend && (op.rotation != BlitRotation::None || src.width != op.width || src.height != op.height)) {
+    reason = BlitFallback::Transform;
+  } else if (op.blend ? dst.format != PixelFormat::Rgb565 : hasAlpha(src.format) && hasAlpha(dst.format)) {
+    reason = BlitFallback::Alpha;
+  } else if (src.width > wr * BLIT_PXP_MAX_DOWNSCALE || src.height > hr * BLIT_PXP_MAX_DOWNSCALE) {
+    reason = BlitFallback::Scale;
+  } else {
+    return true;
+  }
+  return false;
+}
+
+// Programs and runs one blit. False if it did not complete in time.
+static bool runPxp(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op) {
+  const uint32_t dstBpp = Blit_BytesPerPixel(dst.format);
+  uint8_t *out = static_cast<uint8_t *>(dst.pixels) + op.y * dst.stride + op.x * dstBpp;
+  const int32_t outBytes = (int32_t)((op.height - 1U) * dst.stride + op.width * dstBpp);
+  SCB_CleanDCache_by_Addr(src.pixels, (int32_t)(src.stride * src.height));
+  SCB_CleanInvalidateDCache_by_Addr(out, outBytes);
+
+  const bool swap = op.rotation == BlitRotation::Rot90 || op.rotation == BlitRotation::Rot270;
+  // The output rectangle is given before rotation.
+  const uint16_t wr = swap ? op.height : op.width;
+  const uint16_t hr = swap ? op.width : op.height;
+  pxp_output_buffer_config_t output = {};
+  output.pixelFormat = outputFormat(dst.format);
+  output.interlacedMode = kPXP_OutputProgressive;
+  output.buffer0Addr = (uint32_t)(uintptr_t)out;
+  output.pitchBytes = dst.stride;
+  output.width = wr;
+  output.height = hr;
+  PXP_SetOutputBufferConfig(PXP, &output);
+  // Copies come out opaque, as on the CPU, which widens RGB565 to alpha 255.
+  PXP->OUT_CTRL = (PXP->OUT_CTRL & ~PXP_OUT_CTRL_ALPHA_MASK) | PXP_OUT_CTRL_ALPHA_OUTPUT_MASK | PXP_OUT_CTRL_ALPHA(0xFFU);
+  PXP_SetRotateConfig(PXP, kPXP_RotateOutputBuffer, rotateDegree(op.rotation), kPXP_FlipDisable);
+
+  pxp_ps_buffer_config_t ps = {};
+  ps.swapByte = false;
+  if (op.blend) {
+    // Blend in place: the destination is the background.
+    ps.pixelFormat = psFormat(dst.format);
+    ps.bufferAddr = (uint32_t)(uintptr_t)out;
+    ps.pitchBytes = (uint16_t)dst.stride;
+    PXP_SetProcessSurfaceBufferConfig(PXP, &ps);
+    PXP_SetProcessSurfaceScaler(PXP, op.width, op.height, op.width, op.height);
+
+    pxp_as_buffer_config_t as = {};
+    as.pixelFormat = asFormat(src.format);
+    as.bufferAddr = (uint32_t)(uintptr_t)src.pixels;
+    as.pitchBytes = (uint16_t)src.stride;
+    PXP_SetAlphaSurfaceBufferConfig(PXP, &as);
+    pxp_as_blend_config_t blend = {};
+    blend.alpha = op.opacity;
+    blend.invertAlpha = false;
+    blend.alphaMode = op.opacity == 255U ? kPXP_AlphaEmbedded : kPXP_AlphaMultiply;
+    blend.ropMode = kPXP_RopMaskAs;
+    PXP_SetAlphaSurfaceBlendConfig(PXP, &blend);
+    PXP_SetAlphaSurfacePosition(PXP, 0U, 0U, op.width - 1U, op.height - 1U);
+  } else {
+    ps.pixelFormat = psFormat(src.format);
+    ps.bufferAddr = (uint32_t)(uintptr_t)src.pixels;
+    ps.pitchBytes = (uint16_t)src.stride;
+    PXP_SetProcessSurfaceBufferConfig(PXP, &ps);
+    PXP_SetProcessSurfaceScaler(PXP, src.width, src.height, wr, hr);
+    // Upper left after lower right disables the alpha surface.
+    PXP_SetAlphaSurfacePosition(PXP, 0xFFFFU, 0xFFFFU, 0U, 0U);
+  }
+  PXP_SetProcessSurfacePosition(PXP, 0U, 0U, wr - 1U, hr - 1U);
+
+  bool done;
+  s_done.store(false, std::memory_order_relaxed);
+  if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+    // Interrupts may still be masked: poll the flag as well.
+    s_waiter = NULL;
+    PXP_Start(PXP);
+    const uint32_t start = CycleCounter_Read();
+    const uint32_t limit = BLIT_PXP_TIMEOUT_MS * (SystemCoreClock / 1000U);
+    while (!(done = s_done.load(std::memory_order_acquire) ||
+                    (PXP_GetStatusFlags(PXP) & kPXP_CompleteFlag) != 0U) &&
+           CycleCounter_Read() - start < limit) {
+    }
+    PXP_ClearStatusFlags(PXP, kPXP_CompleteFlag);
+  } else {
+    s_waiter = xTaskGetCurrentTaskHandle();
+    (void)ulTaskNotifyTakeIndexed(BLIT_NOTIFY_INDEX, pdTRUE, 0);
+    PXP_Start(PXP);
+    done = ulTaskNotifyTakeIndexed(BLIT_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(BLIT_PXP_TIMEOUT_MS)) != 0U;
+    s_waiter = NULL;
+  }
+  if (!done) {
+    // Stop it before the CPU rewrites the same pixels.
+    setupPxp();
+  }
+  SCB_InvalidateDCache_by_Addr(out, outBytes);
+  return done;
+}
+#endif
+
+bool Blit_Run(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op, BlitPath *path) {
+  if (!Blit_Valid(dst, src, op)) {
+    return false;
+  }
+  const uint32_t start = CycleCounter_Read();
+#if BLIT_USE_PXP
+  BlitFallback reason;
+  if (pxpEligible(dst, src, op, reason)) {
+    if (runPxp(dst, src, op)) {
+      record(BlitPath::Pxp, op, CycleCounter_Read() - start);
+      if (path != nullptr) {
+        *path = BlitPath::Pxp;
+      }
+      return true;
+    }
+    reason = BlitFallback::Timeout;
+  }
+  s_fallbacks[(int)reason]++;
+#else
+  s_fallbacks[(int)BlitFallback::Disabled]++;
+#endif
+  (void)Blit_Cpu(dst, src, op);
+  record(BlitPath::Cpu, op, CycleCounter_Read() - start);
+  if (path != nullptr) {
+    *path = BlitPath::Cpu;
+  }
+  return true;
+}
+
+void Blit_SetPxp(bool on) { s_pxp.store(on && BLIT_USE_PXP != 0, std::memory_order_relaxed); }
+
+void Blit_GetStats(BlitStats &out) {
+  vTaskSuspendAll();
+  out.pxp = s_pathStats[(int)BlitPath::Pxp];
+  out.cpu = s_pathStats[(int)BlitPath::Cpu];
+  memcpy(out.fallbacks, s_fallbacks, sizeof(s_fallbacks));
+  (void)xTaskResumeAll();
+  out.pxpEnabled = s_pxp.load(std::memory_order_relaxed);
+}
+
+void Blit_ResetStats() {
+  vTaskSuspendAll();
+  memset(s_pathStats, 0, sizeof(s_pathStats));
+  memset(s_fallbacks, 0, sizeof(s_fallbacks));
+  (void)xTaskResumeAll();
+}
+
+static void printPath(const char *name, const BlitPathStats &stats) {
+  const uint64_t us = stats.cycles / (SystemCoreClock / 1000000U);
+  // Tenths of a megapixel per second.
+  const uint32_t rate = us != 0U ? (uint32_t)(stats.pixels * 10U / us) : 0U;
+  Qul::PlatformInterface::log("  %s %u blits, %u kpix, %u.%u Mpix/s\r\n", name, (unsigned)stats.blits,
+                              (unsigned)(stats.pixels / 1000U), (unsigned)(rate / 10U), (unsigned)(rate % 10U));
+}
+
+static void blitCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    Blit_ResetStats();
+  } else if (DebugConsole_ArgIs(args, "pxp")) {
+    bool on;
+    if (!DebugConsole_ArgOnOff(args, on)) {
+      Qul::PlatformInterface::log("usage: blit pxp on|off\r\n");
+      return;
+    }
+    Blit_SetPxp(on);
+    Blit_ResetStats();
+  }
+  BlitStats stats;
+  Blit_GetStats(stats);
+  Qul::PlatformInterface::log("Blit engine, PXP %s\r\n", stats.pxpEnabled ? "on" : "off");
+  printPath("PXP", stats.pxp);
+  printPath("CPU", stats.cpu);
+  Qul::PlatformInterface::log("  fallbacks: disabled %u, alpha %u, transform %u, scale %u, timeout %u\r\n",
+                              (unsigned)stats.fallbacks[(int)BlitFallback::Disabled],
+                              (unsigned)stats.fallbacks[(int)BlitFallback::Alpha],
+                              (unsigned)stats.fallbacks[(int)BlitFallback::Transform],
+                              (unsigned)stats.fallbacks[(int)BlitFallback::Scale],
+                              (unsigned)stats.fallbacks[(int)BlitFallback::Timeout]);
+}
+
+void Blit_Init() {
+#if BLIT_USE_PXP
+  setupPxp();
+  NVIC_SetPriority(PXP_IRQn, BLIT_PXP_IRQ_PRIORITY);
+  (void)EnableIRQ(PXP_IRQn);
+#endif
+  DebugConsole_Register("blit", "PXP/CPU blit statistics [reset|pxp on|pxp off]", blitCommand);
+}
@@ -0,0 +1,93 @@
+#ifndef BLIT_ENGINE_H
+#define BLIT_ENGINE_H
+
+#include <stdint.h>
+
+#include "blit.h"
+
+/*
+ * Blits on the PXP, with blit.h's CPU kernel as the fallback.
+ *
+ * Blit_Run() hands a blit to the PXP when the PXP can do the same operation,
+ * same geometry and formats, and runs Blit_Cpu() otherwise:
+ *
+ *  - Copies (no blend) go through the process surface, which scales to the
+ *    unrotated size and rotates on output, the order blit.h defines. The
+ *    process surface has no alpha channel, so a copy whose source and
+ *    destination both carry alpha stays on the CPU (Alpha).
+ *  - Blends put the destination on the process surface and the source on the
+ *    alpha surface, composited in place, with the source alpha multiplied by
+ *    the opacity. The alpha surface cannot scale or rotate (Transform), and
+ *    the PXP keeps the process surface's alpha rather than accumulating it,
+ *    so only RGB565 destinations blend on the PXP (Alpha).
+ *  - The scaler takes at most a BLIT_PXP_MAX_DOWNSCALE reduction (Scale).
+ *
+ * The result is not bit-identical: the PXP rounds its blends and filters its
+ * scaling a little differently from the CPU kernel, so scaled copies and
+ * blends can differ by a few levels per channel. The bit-exact definition
+ * in blit.h, which tools/blit_bench.cpp checks, is the CPU path's; "blit pxp
+ * off" renders with it alone.
+ *
+ * The PXP reads and writes memory behind the data cache: Blit_Run() cleans
+ * the source, cleans and invalidates the destination rows before the start
+ * and invalidates them again afterwards. The render thread waits for the
+ * completion interrupt on task notification index BLIT_NOTIFY_INDEX (polled
+ * before the scheduler starts); if none arrives within BLIT_PXP_TIMEOUT_MS
+ * the PXP is reset and the blit redone on the CPU.
+ *
+ * "blit" on the console prints blits, pixels and throughput per path and why
+ * blits fell back. "blit pxp off" sends everything to the CPU for
+ * comparison, "blit pxp on" back.
+ */
+
+#ifndef BLIT_USE_PXP
+#define BLIT_USE_PXP 1
+#endif
+
+#ifndef BLIT_NOTIFY_INDEX
+#define BLIT_NOTIFY_INDEX 3
+#endif
+
+#ifndef BLIT_PXP_TIMEOUT_MS
+#define BLIT_PXP_TIMEOUT_MS 20
+#endif
+
+/* Largest source:destination ratio per axis the PXP scaler accepts. */
+#ifndef BLIT_PXP_MAX_DOWNSCALE
+#define BLIT_PXP_MAX_DOWNSCALE 4
+#endif
+
+#ifndef BLIT_PXP_IRQ_PRIORITY
+#define BLIT_PXP_IRQ_PRIORITY (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1)
+#endif
+
+enum class BlitPath : uint8_t { Pxp, Cpu };
+
+// Why a blit did not run on the PXP.
+enum class BlitFallback : uint8_t { Disabled, Alpha, Transform, Scale, Timeout, Count };
+
+struct BlitPathStats {
+  uint32_t blits;
+  uint64_t pixels;
+  uint64_t cycles;
+};
+
+struct BlitStats {
+  BlitPathStats pxp;
+  BlitPathStats cpu;
+  uint32_t fallbacks[(int)BlitFallback::Count];
+  bool pxpEnabled;
+};
+
+// Sets up the PXP and registers the "blit" console command.
+void Blit_Init();
+
+// Render thread. Returns the path the blit ran on, or false (touching
+// nothing) if !Blit_Valid.
+bool Blit_Run(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op, BlitPath *path = nullptr);
+
+void Blit_SetPxp(bool on);
+void Blit_GetStats(BlitStats &out);
+void Blit_ResetStats();
+
+#endif // BLIT_ENGINE_H
@@ -0,0 +1,73 @@
+#include "boot_trace.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "runtime_stats.h"
+
+// Microseconds + 1 per mark, 0 while not reached.
+static std::atomic<uint32_t> s_marks[(int)BootMark::Count];
+
+static const char *const s_names[] = {"main", "scheduler", "Qul thread", "first frame", "preload done", "interactive"};
+static_assert(sizeof(s_names) / sizeof(s_names[0]) == (int)BootMark::Count, "one name per mark");
+
+static uint32_t nowUs() {
+  const uint32_t perUs = SystemCoreClock / 1000000U;
+  if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+    return CycleCounter_Read() / perUs;
+  }
+  return BootTrace_Us(BootMark::Scheduler) + (uint32_t)(RunTimeStats_ReadCounter() / perUs);
+}
+
+void BootTrace_Mark(BootMark mark) {
+  uint32_t unset = 0;
+  (void)s_marks[(int)mark].compare_exchange_strong(unset, nowUs() + 1U, std::memory_order_relaxed);
+}
+
+bool BootTrace_Reached(BootMark mark) { return s_marks[(int)mark].load(std::memory_order_relaxed) != 0U; }
+
+uint32_t BootTrace_Us(BootMark mark) {
+  const uint32_t value = s_marks[(int)mark].load(std::memory_order_relaxed);
+  return value != 0U ? value - 1U : 0U;
+}
+
+void BootTrace_FrameDone(bool preloaded) {
+  if (BootTrace_Reached(BootMark::Interactive)) {
+    return;
+  }
+  BootTrace_Mark(BootMark::FirstFrame);
+  if (preloaded) {
+    BootTrace_Mark(BootMark::Interactive);
+    const uint32_t us = BootTrace_Us(BootMark::Interactive);
+    Qul::PlatformInterface::log("First interactive frame after %u.%03u ms\r\n", (unsigned)(us / 1000U),
+                                (unsigned)(us % 1000U));
+  }
+}
+
+static void bootCommand(const char *args) {
+  (void)args;
+  Qul::PlatformInterface::log("Boot trace, ms since MemRegion_Init\r\n");
+  uint32_t previous = 0;
+  for (int i = 0; i < (int)BootMark::Count; i++) {
+    const BootMark mark = static_cast<BootMark>(i);
+    if (!BootTrace_Reached(mark)) {
+      Qul::PlatformInterface::log("  %-13s -\r\n", s_names[i]);
+      continue;
+    }
+    // The preloader can finish before the first frame: no negative steps.
+    const uint32_t us = BootTrace_Us(mark);
+    const uint32_t delta = us >= previous ? us - previous : 0U;
+    Qul::PlatformInterface::log("  %-13s %6u.%03u  +%u.%03u\r\n", s_names[i], (unsigned)(us / 1000U),
+                                (unsigned)(us % 1000U), (unsigned)(delta / 1000U), (unsigned)(delta % 1000U));
+    previous = us > previous ? us : previous;
+  }
+}
+
+void BootTrace_Init() {
+  BootTrace_Mark(BootMark::Main);
+  DebugConsole_Register("boot", "boot milestones up to the first interactive frame", bootCommand);
+}
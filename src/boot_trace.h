@@ -0,0 +1,39 @@
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Boot milestones, from main() to the first interactive frame.
+ *
+ * Each mark keeps the time it was first reached, in microseconds since
+ * MemRegion_Init() started the cycle counter, right after Qul's hardware and
+ * platform init (the boot ROM, the DCD and initHardware itself come before
+ * and are not covered). vTaskStartScheduler() restarts CYCCNT for the
+ * run-time stats, so marks after Scheduler are that mark plus the extended
+ * run-time counter.
+ *
+ * Interactive is the first frame that started after the preloader finished,
+ * i.e. the first one that shows the real UI instead of the splash screen;
+ * the application can also mark it itself. The time to it is logged once
+ * when it is reached, and "boot" on the console prints the whole trace.
+ */
+
+enum class BootMark : uint8_t { Main, Scheduler, QulThread, FirstFrame, PreloadDone, Interactive, Count };
+
+// Marks Main and registers the "boot" console command.
+void BootTrace_Init();
+
+// Any task. Only the first call per mark counts.
+void BootTrace_Mark(BootMark mark);
+
+bool BootTrace_Reached(BootMark mark);
+
+// Microseconds at which mark was reached, 0 if it has not been.
+uint32_t BootTrace_Us(BootMark mark);
+
+// Frame loop, after every frame. preloaded: the preloader had finished
+// before the frame started.
+void BootTrace_FrameDone(bool preloaded);
+
+#endif // BOOT_TRACE_H
@@ -17,20 +17,111 @@
 #include <platforminterface/log.h>
 #include <portable.h>
 #include <stdlib.h>
+#include <string.h>
 #include <task.h>
 
+#include "frame_arena.h"
+#include "heap_monitor.h"
+#include "mem_region.h"
+#include "pool_allocator.h"
+
+/* Part of the FreeRTOS heap reserved for small-object size classes. */
+#ifndef CPP_POOL_ARENA_SIZE
+#define CPP_POOL_ARENA_SIZE (2 * 1024 * 1024)
+#endif
+
 #define CPP_NO_HEAP_GET 1
+
+/*
+ * Small allocations (<= PoolAllocator::MaxBlockSize) are served in O(1) from
+ * per-size-class free lists. Everything else, and everything once the arena
+ * is used up, goes to heap_4 as before. The pool itself is not synchronized;
+ * every access masks interrupts for the few instructions it takes.
+ */
+static PoolAllocator s_smallPool;
+static bool s_smallPoolTried = false;
+
+static void initSmallPool(void) {
+  vTaskSuspendAll();
+  if (!s_smallPoolTried) {
+    s_smallPoolTried = true;
+    void *arena = pvPortMalloc(CPP_POOL_ARENA_SIZE);
+    if (arena != NULL) {
+      s_smallPool.init(arena, CPP_POOL_ARENA_SIZE);
+    }
+  }
+  (void)xTaskResumeAll();
+}
+
+static void *cppAlloc(size_t size, const void *site) {
+  if (FrameArena_Routing()) {
+    void *p = FrameArena_Alloc(size);
+    if (p != NULL) {
+      HeapMonitor_OnAlloc(site, size, HeapPath::Arena);
+      return p;
+    }
+    FrameArena_NoteOverflow();
+  }
+  if (!s_smallPoolTried) {
+    initSmallPool();
+  }
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  void *p = s_smallPool.allocate(size);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+  if (p != NULL) {
+    HeapMonitor_OnAlloc(site, size, HeapPath::Pool);
+    return p;
+  }
+  p = pvPortMalloc(size);
+  if (p != NULL) {
+    HeapMonitor_OnAlloc(site, size, HeapPath::Heap);
+  } else {
+    HeapMonitor_OnFailure(size);
+  }
+  return p;
+}
+
+static void cppFree(void *p) {
+  if (p == NULL) {
+    return;
+  }
+  if (FrameArena_Owns(p)) {
+    HeapMonitor_OnFree(HeapPath::Arena);
+    return; /* released wholesale by FrameArena_EndFrame() */
+  }
+  if (s_smallPool.owns(p)) {
+    const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    s_smallPool.deallocate(p);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+    HeapMonitor_OnFree(HeapPath::Pool);
+  } else if (!MemRegion_Free(p)) {
+    vPortFree(p);
+    HeapMonitor_OnFree(HeapPath::Heap);
+  }
+}
+
+size_t CppHeap_SmallPoolStats(PoolAllocator::Stats &out) {
+  if (!s_smallPool.ready()) {
+    memset(&out, 0, sizeof(out));
+    return 0;
+  }
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  s_smallPool.stats(out);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+  return CPP_POOL_ARENA_SIZE;
+}
+
 void *operator new(size_t size) {
-  return pvPortMalloc(size);
+  return cppAlloc(size, __builtin_return_address(0));
 }
 
 void *operator new[](size_t size) {
-  return pvPortMalloc(size);
+  return cppAlloc(size, __builtin_return_address(0));
 }
 
-void operator delete(void *p) { vPortFree(p); }
+void operator delete(void *p) { cppFree(p); }
 
-void operator delete[](void *p) { vPortFree(p); }
+void operator delete[](void *p) { cppFree(p); }
 
 extern "C" int __aeabi_atexit(void *object, void (*destructor)(void *),
                               void *dso_handle) {
@@ -0,0 +1,21 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "fsl_common.h"
+
+/* DWT cycle counter of the M7, usable from C and C++. */
+
+static inline void CycleCounter_Init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55U; /* unlock DWT on the M7 */
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t CycleCounter_Read(void) { return DWT->CYCCNT; }
+
+static inline uint32_t CycleCounter_ToUs(uint32_t cycles) {
+  return cycles / (SystemCoreClock / 1000000U);
+}
+
+#endif /* CYCLE_COUNTER_H */
@@ -0,0 +1,149 @@
+#include "debug_console.h"
+
+#include <board.h>
+#include <fsl_lpuart.h>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "spsc_ring.h"
+#include "static_alloc.h"
+
+struct ConsoleCommand {
+  const char *name;
+  const char *help;
+  DebugConsoleHandler handler;
+};
+
+static TaskStorage<1024> s_task APP_STATIC_STORAGE;
+static TaskHandle_t s_taskHandle;
+static SpscRing<uint8_t, DEBUG_CONSOLE_RX_DEPTH> s_rx; // ISR -> task
+static ConsoleCommand s_commands[DEBUG_CONSOLE_MAX_COMMANDS];
+static size_t s_commandCount;
+static char s_line[80];
+static size_t s_lineLength;
+
+static void helpCommand(const char *args) {
+  (void)args;
+  for (size_t i = 0; i < s_commandCount; i++) {
+    Qul::PlatformInterface::log("  %-10s %s\r\n", s_commands[i].name, s_commands[i].help);
+  }
+}
+
+bool DebugConsole_Register(const char *name, const char *help,
+                           DebugConsoleHandler handler) {
+  bool registered = false;
+  vTaskSuspendAll();
+  if (s_commandCount < DEBUG_CONSOLE_MAX_COMMANDS) {
+    s_commands[s_commandCount++] = ConsoleCommand{name, help, handler};
+    registered = true;
+  }
+  (void)xTaskResumeAll();
+  return registered;
+}
+
+bool DebugConsole_ArgIs(const char *args, const char *word) {
+  const size_t length = strlen(word);
+  return strncmp(args, word, length) == 0 &&
+         (args[length] == '\0' || args[length] == ' ');
+}
+
+bool DebugConsole_ArgOnOff(const char *args, bool &on) {
+  while (*args != '\0' && *args != ' ') {
+    args++;
+  }
+  while (*args == ' ') {
+    args++;
+  }
+  if (DebugConsole_ArgIs(args, "on") || DebugConsole_ArgIs(args, "off")) {
+    on = args[1] == 'n';
+    return true;
+  }
+  return false;
+}
+
+static void runLine(char *line) {
+  while (*line == ' ') {
+    line++;
+  }
+  if (*line == '\0') {
+    return;
+  }
+  char *args = strchr(line, ' ');
+  if (args != NULL) {
+    *args++ = '\0';
+    while (*args == ' ') {
+      args++;
+    }
+  } else {
+    args = line + strlen(line);
+  }
+  for (size_t i = 0; i < s_commandCount; i++) {
+    if (strcmp(line, s_commands[i].name) == 0) {
+      s_commands[i].handler(args);
+      return;
+    }
+  }
+  Qul::PlatformInterface::log("unknown command '%s', try 'help'\r\n", line);
+}
+
+static void handleChar(char c) {
+  if (c == '\r' || c == '\n') {
+    if (s_lineLength != 0) {
+      Qul::PlatformInterface::log("\r\n");
+      s_line[s_lineLength] = '\0';
+      s_lineLength = 0;
+      runLine(s_line);
+    }
+  } else if ((c == '\b' || c == 0x7F) && s_lineLength != 0) {
+    s_lineLength--;
+    Qul::PlatformInterface::log("\b \b");
+  } else if (c >= ' ' && s_lineLength < sizeof(s_line) - 1) {
+    s_line[s_lineLength++] = c;
+    Qul::PlatformInterface::log("%c", c);
+  }
+}
+
+// Moves everything received into s_rx and wakes the task. Bytes arriving
+// while the ring is full are dropped, as the receiver did before when
+// nobody read it.
+extern "C" void BOARD_UART_IRQ_HANDLER(void) {
+  LPUART_Type *uart = (LPUART_Type *)BOARD_DEBUG_UART_BASEADDR;
+  if (LPUART_GetStatusFlags(uart) & kLPUART_RxOverrunFlag) {
+    (void)LPUART_ClearStatusFlags(uart, kLPUART_RxOverrunFlag);
+  }
+  bool received = false;
+  while (LPUART_GetStatusFlags(uart) & kLPUART_RxDataRegFullFlag) {
+    (void)s_rx.push(LPUART_ReadByte(uart));
+    received = true;
+  }
+  if (received && s_taskHandle != NULL) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_taskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+  SDK_ISR_EXIT_BARRIER;
+}
+
+static void DebugConsole_Thread(void *argument) {
+  (void)argument;
+  while (true) {
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint8_t c;
+    while (s_rx.pop(c)) {
+      handleChar((char)c);
+    }
+  }
+}
+
+void DebugConsole_Start(UBaseType_t priority) {
+  DebugConsole_Register("help", "list commands", helpCommand);
+  if (s_task.create(DebugConsole_Thread, "DebugConsole", 0, priority, &s_taskHandle) != pdPASS) {
+    Qul::PlatformInterface::log("Task creation failed!.\r\n");
+    configASSERT(false);
+  }
+  LPUART_Type *uart = (LPUART_Type *)BOARD_DEBUG_UART_BASEADDR;
+  LPUART_EnableInterrupts(uart, kLPUART_RxDataRegFullInterruptEnable | kLPUART_RxOverrunInterruptEnable);
+  NVIC_SetPriority(BOARD_UART_IRQ, DEBUG_CONSOLE_IRQ_PRIORITY);
+  (void)EnableIRQ(BOARD_UART_IRQ);
+}
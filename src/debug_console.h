@@ -0,0 +1,45 @@
+#ifndef DEBUG_CONSOLE_H
+#define DEBUG_CONSOLE_H
+
+#include <FreeRTOS.h>
+
+// Line-based command console on the debug UART.
+//
+// The UART receive interrupt hands bytes to a low-priority task through a
+// small ring and a task notification, so the console costs nothing while no
+// one types. The task collects a line and runs the command whose name
+// matches its first word; the rest of the line is passed as args. Output
+// goes through Qul::PlatformInterface::log like all other diagnostics.
+// "help" lists the registered commands.
+
+#ifndef DEBUG_CONSOLE_MAX_COMMANDS
+#define DEBUG_CONSOLE_MAX_COMMANDS 24
+#endif
+
+/* Must be at or below the syscall ceiling. */
+#ifndef DEBUG_CONSOLE_IRQ_PRIORITY
+#define DEBUG_CONSOLE_IRQ_PRIORITY configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#endif
+
+/* Received bytes not yet taken by the task; must be a power of two. */
+#ifndef DEBUG_CONSOLE_RX_DEPTH
+#define DEBUG_CONSOLE_RX_DEPTH 64
+#endif
+
+typedef void (*DebugConsoleHandler)(const char *args);
+
+// May be called before or after DebugConsole_Start. name and help must
+// outlive the console (string literals).
+bool DebugConsole_Register(const char *name, const char *help,
+                           DebugConsoleHandler handler);
+
+void DebugConsole_Start(UBaseType_t priority);
+
+// Helpers for handlers: true if args starts with word.
+bool DebugConsole_ArgIs(const char *args, const char *word);
+
+// For "<word> on|off": true with on set from the word after the first, false
+// if that word is neither.
+bool DebugConsole_ArgOnOff(const char *args, bool &on);
+
+#endif // DEBUG_CONSOLE_H
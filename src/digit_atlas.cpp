@@ -0,0 +1,55 @@
+#include "digit_atlas.h"
+
+#if !APP_DIGIT_ATLAS
+// The generated tables replace these.
+extern const DigitAtlasSet DigitAtlas_Sets[1] = {};
+extern const uint32_t DigitAtlas_SetCount = 0;
+#endif
+
+const DigitAtlasSet *DigitAtlas_FindSet(uint16_t font, uint16_t size) {
+  for (uint32_t i = 0; i < DigitAtlas_SetCount; i++) {
+    if (DigitAtlas_Sets[i].font == font && DigitAtlas_Sets[i].size == size) {
+      return &DigitAtlas_Sets[i];
+    }
+  }
+  return nullptr;
+}
+
+const DigitAtlasGlyph *DigitAtlas_FindGlyph(const DigitAtlasSet &set, uint32_t glyph) {
+  uint32_t low = 0;
+  uint32_t high = set.glyphCount;
+  while (low < high) {
+    const uint32_t mid = (low + high) / 2U;
+    if (set.glyphs[mid].glyph < glyph) {
+      low = mid + 1U;
+    } else {
+      high = mid;
+    }
+  }
+  return low < set.glyphCount && set.glyphs[low].glyph == glyph ? &set.glyphs[low] : nullptr;
+}
+
+bool DigitAtlas_Covers(const DigitAtlasSet &set, const char *text) {
+  for (const char *c = text; *c != '\0'; c++) {
+    if (DigitAtlas_FindGlyph(set, (uint8_t)*c) == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int32_t DigitAtlas_Draw(const BlitSurface &dst, int32_t x, int32_t y, const DigitAtlasSet &set, const char *text,
+                        uint32_t argb) {
+  for (const char *c = text; *c != '\0'; c++) {
+    const DigitAtlasGlyph *g = DigitAtlas_FindGlyph(set, (uint8_t)*c);
+    if (g == nullptr) {
+      continue;
+    }
+    if (g->width != 0U) {
+      (void)Blit_CpuMask(dst, set.pixels + g->y * set.pitch + g->x, set.pitch, g->width, g->height, x + g->bearingX,
+                         y - g->bearingY, argb);
+    }
+    x += g->advance;
+  }
+  return x;
+}
@@ -0,0 +1,77 @@
+#ifndef DIGIT_ATLAS_H
+#define DIGIT_ATLAS_H
+
+#include <stdint.h>
+
+#include "blit.h"
+
+// Glyph sets rasterized at build time and kept in flash.
+//
+// Numeric readouts draw from a small, fixed set of glyphs per font and size.
+// With APP_DIGIT_ATLAS, tools/digit_atlas.py renders the sets listed in
+// APP_DIGIT_ATLAS_SETS (armgcc/CMakeLists.txt) with FreeType into one packed
+// A8 atlas per set, emitted as const tables that stay in XIP flash. Drawing
+// them involves no font engine and no SDRAM: GlyphCache_Get() hands them to
+// the platform glue straight from flash (glyph_cache.h), and
+// DigitAtlas_Draw() blends them on the CPU. GlyphCache_Get() uses a set only
+// while its metrics match the glue's rasterizer for the same font id and no
+// pixel differs by more than DIGIT_ATLAS_MAX_PIXEL_DIFF;
+// DigitAtlas_Draw() does not check, so readouts it draws lay out by FreeType's
+// metrics and should not be mixed with Qul text in one line.
+//
+// Every glyph has a transparent gutter of at least one pixel, lines are
+// padded to 16 bytes and atlases aligned to 64, so VGLite can sample a set as
+// one A8 buffer. Font ids are the glue's, as in glyph_cache.h; glyphs are
+// code points, sorted.
+//
+// tools/digit_atlas_check.cpp checks the generated atlas and
+// DigitAtlas_Draw() against FreeType on the host; "glyphs verify" on the
+// console compares it with the glue's rasterizer on the target.
+
+// Largest difference in coverage (0..255) between a flash glyph's pixel and
+// the rasterizer's at which GlyphCache_Get() still serves the set. Gamma and
+// anti-aliasing differences stay well below it; hinting that moves an edge
+// by a pixel shows up as differences near 255.
+#ifndef DIGIT_ATLAS_MAX_PIXEL_DIFF
+#define DIGIT_ATLAS_MAX_PIXEL_DIFF 32
+#endif
+
+struct DigitAtlasGlyph {
+  uint32_t glyph;
+  uint16_t x; // in the set's atlas
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+  int16_t bearingX; // pen to left edge
+  int16_t bearingY; // baseline to top edge, up
+  uint16_t advance;
+};
+
+struct DigitAtlasSet {
+  uint16_t font;
+  uint16_t size; // pixels
+  uint16_t width;
+  uint16_t height;
+  uint32_t pitch;
+  const uint8_t *pixels;
+  const DigitAtlasGlyph *glyphs;
+  uint32_t glyphCount;
+};
+
+// Generated, or empty without APP_DIGIT_ATLAS.
+extern const DigitAtlasSet DigitAtlas_Sets[];
+extern const uint32_t DigitAtlas_SetCount;
+
+const DigitAtlasSet *DigitAtlas_FindSet(uint16_t font, uint16_t size);
+const DigitAtlasGlyph *DigitAtlas_FindGlyph(const DigitAtlasSet &set, uint32_t glyph);
+
+// Whether every byte of text has a glyph in set.
+bool DigitAtlas_Covers(const DigitAtlasSet &set, const char *text);
+
+// Draws text, one glyph per byte, with its baseline at y, starting at pen
+// position x, in argb (Blit_CpuMask). Glyphs missing from the set are
+// skipped. Render thread only. Returns the pen position after the text.
+int32_t DigitAtlas_Draw(const BlitSurface &dst, int32_t x, int32_t y, const DigitAtlasSet &set, const char *text,
+                        uint32_t argb);
+
+#endif // DIGIT_ATLAS_H
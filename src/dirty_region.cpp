@@ -0,0 +1,236 @@
+#include "dirty_region.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "debug_console.h"
+
+static uint32_t rectArea(const DirtyRect &r) { return (uint32_t)r.w * (uint32_t)r.h; }
+
+static DirtyRect unite(const DirtyRect &a, const DirtyRect &b) {
+  const int x0 = a.x < b.x ? a.x : b.x;
+  const int y0 = a.y < b.y ? a.y : b.y;
+  const int x1 = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+  const int y1 = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+  return DirtyRect{(int16_t)x0, (int16_t)y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+}
+
+static bool contains(const DirtyRect &outer, const DirtyRect &inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w &&
+         inner.y + inner.h <= outer.y + outer.h;
+}
+
+static bool worthMerging(const DirtyRect &a, const DirtyRect &b) {
+  if (contains(a, b) || contains(b, a)) {
+    return true;
+  }
+  return rectArea(unite(a, b)) * 100U <= (rectArea(a) + rectArea(b)) * DIRTY_REGION_MERGE_PERCENT;
+}
+
+bool DirtyRegion::clip(int x, int y, int w, int h, DirtyRect &out) const {
+  int x0 = x < 0 ? 0 : x;
+  int y0 = y < 0 ? 0 : y;
+  int x1 = x + w > width_ ? width_ : x + w;
+  const int y1 = y + h > height_ ? height_ : y + h;
+  if (x1 <= x0 || y1 <= y0) {
+    return false;
+  }
+  x0 -= x0 % DIRTY_REGION_ALIGN_PX;
+  x1 += (DIRTY_REGION_ALIGN_PX - x1 % DIRTY_REGION_ALIGN_PX) % DIRTY_REGION_ALIGN_PX;
+  if (x1 > width_) {
+    x1 = width_;
+  }
+  out = DirtyRect{(int16_t)x0, (int16_t)y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+  return true;
+}
+
+void DirtyRegion::insert(DirtyRect rect) {
+  // A merge can make the result worth merging with another rectangle, so
+  // keep folding until nothing more qualifies.
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (uint32_t i = 0; i < count_; i++) {
+      if (worthMerging(rects_[i], rect)) {
+        rect = unite(rects_[i], rect);
+        rects_[i] = rects_[--count_];
+        merged = true;
+        break;
+      }
+    }
+    if (!merged && count_ == DIRTY_REGION_MAX_RECTS) {
+      // No room: merge whichever pair, the new rectangle included, adds the
+      // fewest pixels, then try again.
+      uint32_t bestA = 0;
+      uint32_t bestB = count_; // count_ stands for the new rectangle
+      int32_t bestWaste = INT32_MAX;
+      for (uint32_t i = 0; i < count_; i++) {
+        for (uint32_t j = i + 1; j <= count_; j++) {
+          const DirtyRect &other = j < count_ ? rects_[j] : rect;
+          const int32_t waste = (int32_t)rectArea(unite(rects_[i], other)) -
+                                (int32_t)rectArea(rects_[i]) - (int32_t)rectArea(other);
+          if (waste < bestWaste) {
+            bestWaste = waste;
+            bestA = i;
+            bestB = j;
+          }
+        }
+      }
+      if (bestB == count_) {
+        rect = unite(rects_[bestA], rect);
+        rects_[bestA] = rects_[--count_];
+      } else {
+        rects_[bestA] = unite(rects_[bestA], rects_[bestB]);
+        rects_[bestB] = rects_[--count_];
+      }
+      merged = true;
+    }
+  }
+  rects_[count_++] = rect;
+}
+
+void DirtyRegion::add(int x, int y, int w, int h) {
+  DirtyRect rect;
+  if (full_ || !clip(x, y, w, h, rect)) {
+    return;
+  }
+  insert(rect);
+  if (area() * 100U >= (uint32_t)width_ * (uint32_t)height_ * DIRTY_REGION_FULL_PERCENT) {
+    addAll();
+  }
+}
+
+void DirtyRegion::addAll() {
+  rects_[0] = DirtyRect{0, 0, width_, height_};
+  count_ = 1;
+  full_ = true;
+}
+
+void DirtyRegion::clear() {
+  count_ = 0;
+  full_ = false;
+}
+
+uint32_t DirtyRegion::area() const {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < count_; i++) {
+    total += rectArea(rects_[i]);
+  }
+  return total;
+}
+
+// Render thread only; the console reads the totals under vTaskSuspendAll.
+static DirtyRegion s_region(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+static std::atomic<bool> s_enabled{true};
+
+static struct {
+  uint32_t frames;
+  uint32_t fullFrames;
+  uint32_t lastPixels;
+  uint32_t maxPixels;
+  uint64_t pixels;
+  uint64_t rects;
+} s_totals;
+
+extern "C" void DirtyRegion_Mark(int x, int y, int w, int h) { s_region.add(x, y, w, h); }
+
+extern "C" void DirtyRegion_MarkAll(void) { s_region.addAll(); }
+
+extern "C" uint32_t DirtyRegion_EndFrame(DirtyRect *out, uint32_t max) {
+  if (!s_enabled.load(std::memory_order_relaxed) && !s_region.empty()) {
+    s_region.addAll();
+  }
+  uint32_t count = s_region.count();
+  if (count > max) {
+    // Caller can take fewer rectangles than we keep, give it the bounds.
+    s_region.addAll();
+    count = max != 0U ? 1U : 0U;
+  }
+  memcpy(out, s_region.rects(), count * sizeof(DirtyRect));
+
+  const uint32_t pixels = s_region.area();
+  s_totals.frames++;
+  s_totals.lastPixels = pixels;
+  s_totals.pixels += pixels;
+  s_totals.rects += count;
+  if (pixels > s_totals.maxPixels) {
+    s_totals.maxPixels = pixels;
+  }
+  if (s_region.isFull()) {
+    s_totals.fullFrames++;
+  }
+  s_region.clear();
+  return count;
+}
+
+extern "C" void DirtyRegion_CopyRects(void *dst, const void *src, const DirtyRect *rects,
+                                      uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    const DirtyRect &r = rects[i];
+    const uint32_t offset = (uint32_t)r.y * DISPLAY_STRIDE_BYTES + (uint32_t)r.x * DISPLAY_BYTES_PER_PIXEL;
+    const uint32_t bytes = (uint32_t)r.w * DISPLAY_BYTES_PER_PIXEL;
+    if (r.x == 0 && r.w == DISPLAY_WIDTH) {
+      // Full-width rows are contiguous.
+      memcpy(static_cast<uint8_t *>(dst) + offset, static_cast<const uint8_t *>(src) + offset,
+             bytes * (uint32_t)r.h);
+      continue;
+    }
+    for (int16_t row = 0; row < r.h; row++) {
+      const uint32_t line = offset + (uint32_t)row * DISPLAY_STRIDE_BYTES;
+      memcpy(static_cast<uint8_t *>(dst) + line, static_cast<const uint8_t *>(src) + line, bytes);
+    }
+  }
+}
+
+void DirtyRegion_GetStats(DirtyRegionStats &out) {
+  vTaskSuspendAll();
+  const uint32_t frames = s_totals.frames;
+  out.frames = frames;
+  out.fullFrames = s_totals.fullFrames;
+  out.lastPixels = s_totals.lastPixels;
+  out.maxPixels = s_totals.maxPixels;
+  out.avgPixels = frames != 0U ? (uint32_t)(s_totals.pixels / frames) : 0U;
+  out.avgRects = frames != 0U ? (uint32_t)(s_totals.rects / frames) : 0U;
+  out.bytesCopied = s_totals.pixels * DISPLAY_BYTES_PER_PIXEL;
+  out.bytesSaved = ((uint64_t)frames * DISPLAY_WIDTH * DISPLAY_HEIGHT - s_totals.pixels) * DISPLAY_BYTES_PER_PIXEL;
+  (void)xTaskResumeAll();
+  out.enabled = s_enabled.load(std::memory_order_relaxed);
+}
+
+void DirtyRegion_ResetStats() {
+  vTaskSuspendAll();
+  memset(&s_totals, 0, sizeof(s_totals));
+  (void)xTaskResumeAll();
+}
+
+void DirtyRegion_SetEnabled(bool on) { s_enabled.store(on, std::memory_order_relaxed); }
+
+static void dirtyCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    DirtyRegion_ResetStats();
+  } else if (DebugConsole_ArgIs(args, "off")) {
+    DirtyRegion_SetEnabled(false);
+  } else if (DebugConsole_ArgIs(args, "on")) {
+    DirtyRegion_SetEnabled(true);
+  }
+  DirtyRegionStats stats;
+  DirtyRegion_GetStats(stats);
+  const uint32_t screen = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+  Qul::PlatformInterface::log("partial updates %s, %u frames, %u full\r\n",
+                              stats.enabled ? "on" : "off", (unsigned)stats.frames,
+                              (unsigned)stats.fullFrames);
+  Qul::PlatformInterface::log("  pixels/frame avg %u (%u%%), max %u, last %u; %u rects/frame\r\n",
+                              (unsigned)stats.avgPixels, (unsigned)(stats.avgPixels * 100U / screen),
+                              (unsigned)stats.maxPixels, (unsigned)stats.lastPixels,
+                              (unsigned)stats.avgRects);
+  Qul::PlatformInterface::log("  copied %u KB, saved %u KB against full frames\r\n",
+                              (unsigned)(stats.bytesCopied / 1024U),
+                              (unsigned)(stats.bytesSaved / 1024U));
+}
+
+void DirtyRegion_Init() {
+  DebugConsole_Register("dirty", "partial refresh statistics [reset|on|off]", dirtyCommand);
+}
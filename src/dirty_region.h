@@ -0,0 +1,125 @@
+#ifndef DIRTY_REGION_H
+#define DIRTY_REGION_H
+
+#include <stdint.h>
+
+#include "display_config.h"
+
+/*
+ * Dirty-region accumulation for partial framebuffer updates.
+ *
+ * Everything that changes pixels during a frame reports its rectangle with
+ * DirtyRegion_Mark(): the platform glue (platform/ generated by
+ * qmlprojectexporter) from beginFrame with the area Qul is about to repaint,
+ * and any code that draws into the framebuffer behind Qul's back. At present
+ * time DirtyRegion_EndFrame() hands out the merged region. The glue copies
+ * exactly those rectangles into the other buffer of the swap chain
+ * (DirtyRegion_CopyRects) instead of the whole frame, so a gear digit that
+ * changes every 500 ms costs a few kilobytes of SDRAM traffic, not 3.5 MB.
+ *
+ * Rectangles are merged as they arrive, to keep the copy to a few long
+ * bursts:
+ *  - edges are widened to DIRTY_REGION_ALIGN_PX columns (one 32-byte cache
+ *    line at 32bpp), so no burst starts or ends mid-line;
+ *  - two rectangles merge when their bounding box is at most
+ *    DIRTY_REGION_MERGE_PERCENT of their combined area, or one contains the
+ *    other;
+ *  - at DIRTY_REGION_MAX_RECTS the pair (the new rectangle included) whose
+ *    bounding box adds the fewest pixels is merged;
+ *  - once the region covers DIRTY_REGION_FULL_PERCENT of the screen it
+ *    becomes the full screen, which copies faster than many pieces.
+ *
+ * "dirty" on the console reports pixels and bytes per frame against full
+ * refreshes; "dirty off" forces full frames for comparison.
+ */
+
+#ifndef DIRTY_REGION_MAX_RECTS
+#define DIRTY_REGION_MAX_RECTS 8
+#endif
+
+#ifndef DIRTY_REGION_ALIGN_PX
+#define DIRTY_REGION_ALIGN_PX 8
+#endif
+
+#ifndef DIRTY_REGION_MERGE_PERCENT
+#define DIRTY_REGION_MERGE_PERCENT 125
+#endif
+
+#ifndef DIRTY_REGION_FULL_PERCENT
+#define DIRTY_REGION_FULL_PERCENT 70
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+} DirtyRect;
+
+/* Render thread. Rectangles are clipped to the screen. */
+void DirtyRegion_Mark(int x, int y, int w, int h);
+void DirtyRegion_MarkAll(void);
+
+/* Render thread, at present: copies the merged region of the frame that just
+   finished into out (at most max rectangles, DIRTY_REGION_MAX_RECTS is always
+   enough) and starts an empty region for the next one. Returns the count. */
+uint32_t DirtyRegion_EndFrame(DirtyRect *out, uint32_t max);
+
+/* Copies rects between two framebuffers of DISPLAY_STRIDE_BYTES pitch. */
+void DirtyRegion_CopyRects(void *dst, const void *src, const DirtyRect *rects, uint32_t count);
+
+#ifdef __cplusplus
+}
+
+class DirtyRegion {
+public:
+  DirtyRegion(int16_t width, int16_t height) : width_(width), height_(height) {}
+
+  void add(int x, int y, int w, int h);
+  void addAll();
+  void clear();
+
+  bool empty() const { return count_ == 0; }
+  bool isFull() const { return full_; }
+  uint32_t count() const { return count_; }
+  const DirtyRect *rects() const { return rects_; }
+  uint32_t area() const; // sum over rectangles, overlaps count twice
+
+private:
+  bool clip(int x, int y, int w, int h, DirtyRect &out) const;
+  void insert(DirtyRect rect);
+
+  int16_t width_;
+  int16_t height_;
+  DirtyRect rects_[DIRTY_REGION_MAX_RECTS] = {};
+  uint32_t count_ = 0;
+  bool full_ = false;
+};
+
+struct DirtyRegionStats {
+  uint32_t frames;
+  uint32_t fullFrames;    // frames that copied the whole screen
+  uint32_t lastPixels;
+  uint32_t maxPixels;
+  uint32_t avgPixels;
+  uint32_t avgRects;
+  uint64_t bytesCopied;
+  uint64_t bytesSaved;    // against copying every frame in full
+  bool enabled;
+};
+
+// Registers the "dirty" console command.
+void DirtyRegion_Init();
+
+void DirtyRegion_GetStats(DirtyRegionStats &out);
+void DirtyRegion_ResetStats();
+
+// false turns every frame into a full-screen region.
+void DirtyRegion_SetEnabled(bool on);
+#endif
+
+#endif /* DIRTY_REGION_H */
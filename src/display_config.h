@@ -0,0 +1,23 @@
+#ifndef DISPLAY_CONFIG_H
+#define DISPLAY_CONFIG_H
+
+/* Geometry of the framebuffers the Qul platform renders into: the RK055 MIPI
+   panel of the MIMXRT1170-EVKB, portrait, with the 32bpp Qul platform
+   libraries (armgcc/qul.cmake). */
+
+#ifndef DISPLAY_WIDTH
+#define DISPLAY_WIDTH 720
+#endif
+
+#ifndef DISPLAY_HEIGHT
+#define DISPLAY_HEIGHT 1280
+#endif
+
+#ifndef DISPLAY_BYTES_PER_PIXEL
+#define DISPLAY_BYTES_PER_PIXEL 4
+#endif
+
+#define DISPLAY_STRIDE_BYTES (DISPLAY_WIDTH * DISPLAY_BYTES_PER_PIXEL)
+#define DISPLAY_FRAME_BYTES (DISPLAY_STRIDE_BYTES * DISPLAY_HEIGHT)
+
+#endif /* DISPLAY_CONFIG_H */
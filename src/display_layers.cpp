@@ -0,0 +1,204 @@
+#include "display_layers.h"
+
+#include <FreeRTOS.h>
+#include <fsl_lcdifv2.h>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "frame_loop.h"
+
+#define LAYER_COUNT static_cast<uint32_t>(DisplayLayer::Count)
+
+static_assert(DISPLAY_LAYERS_GAUGES_X + DISPLAY_LAYERS_GAUGES_WIDTH <= DISPLAY_WIDTH &&
+                  DISPLAY_LAYERS_GAUGES_Y + DISPLAY_LAYERS_GAUGES_HEIGHT <= DISPLAY_HEIGHT,
+              "gauge layer box is not on the panel");
+
+struct LayerSetup {
+  const char *name;
+  FramebufferLayerConfig config;
+  uint16_t x;
+  uint16_t y;
+  lcdifv2_alpha_mode_t alpha;
+  bool enabled;
+};
+
+static const LayerSetup s_setup[LAYER_COUNT] = {
+    {"background",
+     {DISPLAY_WIDTH, DISPLAY_HEIGHT, PixelFormat::Rgb565, 1, FramebufferPlacement::Sdram, 0},
+     0,
+     0,
+     kLCDIFV2_AlphaDisable,
+     true},
+    {"gauges",
+     {DISPLAY_LAYERS_GAUGES_WIDTH, DISPLAY_LAYERS_GAUGES_HEIGHT, PixelFormat::Argb8888, FRAMEBUFFER_COUNT,
+      FramebufferPlacement::Sdram, 1},
+     DISPLAY_LAYERS_GAUGES_X,
+     DISPLAY_LAYERS_GAUGES_Y,
+     kLCDIFV2_AlphaEmbedded,
+     true},
+    {"warning",
+     {DISPLAY_WIDTH, DISPLAY_LAYERS_WARNING_HEIGHT, PixelFormat::Argb4444, 2, FramebufferPlacement::Ocram, 0},
+     0,
+     DISPLAY_LAYERS_WARNING_Y,
+     kLCDIFV2_AlphaMultiply,
+     false},
+};
+
+// Render thread only; the console reads them under vTaskSuspendAll.
+static struct {
+  uint32_t updates;
+  uint32_t begin; // cycles at BeginUpdate
+  uint32_t renderMax;
+  uint64_t renderSum;
+  uint64_t pixels;
+} s_totals[LAYER_COUNT];
+
+static bool s_enabled[LAYER_COUNT];
+static TickType_t s_resetAt;
+
+static uint32_t bytesPerPixel(const FramebufferLayerConfig &config) {
+  return config.format == PixelFormat::Argb8888 ? 4U : 2U;
+}
+
+extern "C" void *DisplayLayers_BeginUpdate(uint32_t layer, uint32_t *age) {
+  void *pixels = Framebuffer_Acquire(layer, age);
+  if (layer < LAYER_COUNT) {
+    s_totals[layer].begin = CycleCounter_Read();
+  }
+  return pixels;
+}
+
+extern "C" void DisplayLayers_EndUpdate(uint32_t layer, const DirtyRect *rects, uint32_t count) {
+  DisplayLayers_EndUpdateBuffer(layer, Framebuffer_Hold(layer), rects, count);
+}
+
+extern "C" void DisplayLayers_EndUpdateBuffer(uint32_t layer, int32_t buffer, const DirtyRect *rects,
+                                              uint32_t count) {
+  if (layer < LAYER_COUNT) {
+    const FramebufferLayerConfig &config = s_setup[layer].config;
+    uint32_t pixels = (uint32_t)config.width * config.height;
+    if (count != 0U) {
+      pixels = 0;
+      for (uint32_t i = 0; i < count; i++) {
+        pixels += (uint32_t)rects[i].w * (uint32_t)rects[i].h;
+      }
+    }
+    const uint32_t cycles = CycleCounter_Read() - s_totals[layer].begin;
+    s_totals[layer].updates++;
+    s_totals[layer].renderSum += cycles;
+    s_totals[layer].renderMax = cycles > s_totals[layer].renderMax ? cycles : s_totals[layer].renderMax;
+    s_totals[layer].pixels += pixels;
+  }
+  Framebuffer_PresentBuffer(layer, buffer, rects, count);
+}
+
+static void program(uint32_t layer, bool enabled, uint8_t opacity) {
+  lcdifv2_blend_config_t blend = {};
+  blend.alphaMode = s_setup[layer].alpha;
+  blend.globalAlpha = opacity;
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  LCDIFV2_SetLayerOffset(LCDIFV2, (uint8_t)layer, s_setup[layer].x, s_setup[layer].y);
+  LCDIFV2_SetLayerBlendConfig(LCDIFV2, (uint8_t)layer, &blend);
+  LCDIFV2_EnableLayer(LCDIFV2, (uint8_t)layer, enabled);
+  LCDIFV2_TriggerLayerShadowLoad(LCDIFV2, (uint8_t)layer);
+  s_enabled[layer] = enabled;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void DisplayLayers_SetWarning(bool visible, uint8_t opacity) {
+  program(static_cast<uint32_t>(DisplayLayer::Warning), visible, opacity);
+}
+
+void DisplayLayers_GetStats(DisplayLayer layer, DisplayLayerStats &out) {
+  const uint32_t index = static_cast<uint32_t>(layer);
+  const FramebufferLayerConfig &config = s_setup[index].config;
+  vTaskSuspendAll();
+  const uint32_t updates = s_totals[index].updates;
+  out.updates = updates;
+  out.renderAvgUs = updates != 0U ? CycleCounter_ToUs((uint32_t)(s_totals[index].renderSum / updates)) : 0U;
+  out.renderMaxUs = CycleCounter_ToUs(s_totals[index].renderMax);
+  out.bytesWritten = s_totals[index].pixels * bytesPerPixel(config);
+  (void)xTaskResumeAll();
+  out.scanoutBytes = s_enabled[index] ? (uint32_t)config.width * config.height * bytesPerPixel(config) : 0U;
+}
+
+void DisplayLayers_ResetStats() {
+  vTaskSuspendAll();
+  for (uint32_t i = 0; i < LAYER_COUNT; i++) {
+    const uint32_t begin = s_totals[i].begin;
+    memset(&s_totals[i], 0, sizeof(s_totals[i]));
+    s_totals[i].begin = begin;
+  }
+  s_resetAt = xTaskGetTickCount();
+  (void)xTaskResumeAll();
+}
+
+static void layersCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    DisplayLayers_ResetStats();
+  }
+  DisplayLayerStats stats[LAYER_COUNT];
+  uint32_t scanout = 0;
+  for (uint32_t i = 0; i < LAYER_COUNT; i++) {
+    DisplayLayers_GetStats(static_cast<DisplayLayer>(i), stats[i]);
+    scanout += stats[i].scanoutBytes;
+    const uint32_t perUpdate = stats[i].updates != 0U ? (uint32_t)(stats[i].bytesWritten / stats[i].updates) : 0U;
+    Qul::PlatformInterface::log("%-10s %8u updates, render avg %u us max %u us, %u KB/update, %s\r\n",
+                                s_setup[i].name, (unsigned)stats[i].updates,
+                                (unsigned)stats[i].renderAvgUs, (unsigned)stats[i].renderMaxUs,
+                                (unsigned)(perUpdate / 1024U), s_enabled[i] ? "on" : "off");
+  }
+  const uint32_t flat = DISPLAY_WIDTH * DISPLAY_HEIGHT * 4U;
+  Qul::PlatformInterface::log("scanout %u KB/refresh (%u MB/s), one 32bpp framebuffer %u KB (%u MB/s)\r\n",
+                              (unsigned)(scanout / 1024U),
+                              (unsigned)(scanout / 1024U * FRAME_LOOP_PANEL_HZ / 1024U),
+                              (unsigned)(flat / 1024U), (unsigned)(flat / 1024U * FRAME_LOOP_PANEL_HZ / 1024U));
+
+  // In one framebuffer every dynamic update first repaints the background
+  // under it: 4 bytes read from the artwork and 4 written per pixel, at the
+  // per-pixel cost the one background render measured.
+  const DisplayLayerStats &background = stats[static_cast<uint32_t>(DisplayLayer::Background)];
+  const uint32_t screen = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+  uint64_t dynamicPixels = 0;
+  uint32_t dynamicUpdates = 0;
+  for (uint32_t i = static_cast<uint32_t>(DisplayLayer::Gauges); i < LAYER_COUNT; i++) {
+    dynamicPixels += stats[i].bytesWritten / bytesPerPixel(s_setup[i].config);
+    dynamicUpdates += stats[i].updates;
+  }
+  if (dynamicUpdates == 0U) {
+    return;
+  }
+  const uint32_t pixelsPerUpdate = (uint32_t)(dynamicPixels / dynamicUpdates);
+  Qul::PlatformInterface::log("avoided per dynamic update: %u KB background traffic, ~%u us background render\r\n",
+                              (unsigned)(pixelsPerUpdate * 8U / 1024U),
+                              (unsigned)((uint64_t)background.renderAvgUs * pixelsPerUpdate / screen));
+
+  // The layers cost scanout on every refresh and save background traffic
+  // only per update; the net is what SDRAM sees.
+  const uint32_t elapsedMs = (uint32_t)((xTaskGetTickCount() - s_resetAt) * portTICK_PERIOD_MS);
+  if (elapsedMs == 0U) {
+    return;
+  }
+  const int32_t scanoutKBps = ((int32_t)scanout - (int32_t)flat) / 1024 * FRAME_LOOP_PANEL_HZ;
+  const int32_t savedKBps = (int32_t)(dynamicPixels * 8U / 1024U * 1000U / elapsedMs);
+  Qul::PlatformInterface::log("net against one framebuffer: scanout %+d KB/s, background %+d KB/s, total %+d KB/s\r\n",
+                              (int)scanoutKBps, (int)-savedKBps, (int)(scanoutKBps - savedKBps));
+}
+
+bool DisplayLayers_Init() {
+  bool ok = true;
+  for (uint32_t i = 0; i < LAYER_COUNT; i++) {
+    if (!Framebuffer_ConfigureLayer(i, s_setup[i].config)) {
+      Qul::PlatformInterface::log("Layer %s allocation failed!.\r\n", s_setup[i].name);
+      ok = false;
+      continue;
+    }
+    program(i, s_setup[i].enabled, 0xFF);
+  }
+  s_resetAt = xTaskGetTickCount();
+  DebugConsole_Register("layers", "hardware layer composition statistics [reset]", layersCommand);
+  return ok;
+}
@@ -0,0 +1,114 @@
+#ifndef DISPLAY_LAYERS_H
+#define DISPLAY_LAYERS_H
+
+#include <stdint.h>
+
+#include "dirty_region.h"
+#include "framebuffer.h"
+
+/*
+ * Cluster screen composed from three LCDIFv2 hardware layers instead of one
+ * 32bpp framebuffer:
+ *
+ *  - Background: the static dial artwork, RGB565, one buffer. Drawn once;
+ *    the controller blends everything else over it on every scanout, so it
+ *    is never rendered again.
+ *  - Gauges: needles and readouts, ARGB8888 with per-pixel alpha, double or
+ *    triple buffered (FRAMEBUFFER_COUNT). The only layer redrawn while the
+ *    car is moving, and only where its dirty region says. It covers the
+ *    DISPLAY_LAYERS_GAUGES_* box, which must match the gauge ItemLayer's
+ *    geometry; scanout reads it on every refresh, so the full-screen default
+ *    costs 50% more scanout than one 32bpp framebuffer and only pays off
+ *    where the box is smaller or the background traffic saved is larger.
+ *  - Warning: a DISPLAY_LAYERS_WARNING_HEIGHT strip for telltales, ARGB4444
+ *    in OCRAM, blended with per-pixel alpha times an opacity for fading. It
+ *    is disabled while hidden and costs no bandwidth then.
+ *
+ * Items are assigned to layers in the QML project (not part of this tree)
+ * with Qt Quick Ultralite's layer items, in this z order:
+ *
+ *   Screen {
+ *     ImageLayer { source: "background.png" }                 // Background
+ *     ItemLayer { depth: ItemLayer.Bpp32Alpha; ... gauges }   // Gauges
+ *     ItemLayer { depth: ItemLayer.Bpp16Alpha; ... warnings } // Warning
+ *   }
+ *
+ * The platform's layer engine (platform/ generated by qmlprojectexporter)
+ * maps them to DisplayLayer in that order and brackets every layer update
+ * with DisplayLayers_BeginUpdate/EndUpdate, which time the render and count
+ * the bytes written per layer.
+ *
+ * "layers" on the console reports per-layer updates, render time and bytes
+ * written, the scanout bandwidth of the enabled layers, what the same
+ * updates would have cost on a single 32bpp framebuffer, and the net SDRAM
+ * traffic per second against it: extra scanout minus background traffic
+ * saved.
+ */
+
+/* Gauge layer box on the panel, the bounding box of the needles and
+   readouts. */
+#ifndef DISPLAY_LAYERS_GAUGES_X
+#define DISPLAY_LAYERS_GAUGES_X 0
+#endif
+
+#ifndef DISPLAY_LAYERS_GAUGES_Y
+#define DISPLAY_LAYERS_GAUGES_Y 0
+#endif
+
+#ifndef DISPLAY_LAYERS_GAUGES_WIDTH
+#define DISPLAY_LAYERS_GAUGES_WIDTH DISPLAY_WIDTH
+#endif
+
+#ifndef DISPLAY_LAYERS_GAUGES_HEIGHT
+#define DISPLAY_LAYERS_GAUGES_HEIGHT DISPLAY_HEIGHT
+#endif
+
+#ifndef DISPLAY_LAYERS_WARNING_HEIGHT
+#define DISPLAY_LAYERS_WARNING_HEIGHT 80
+#endif
+
+#ifndef DISPLAY_LAYERS_WARNING_Y
+#define DISPLAY_LAYERS_WARNING_Y 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Render thread. Framebuffer_Acquire() for the layer, starting its render
+   timer. */
+void *DisplayLayers_BeginUpdate(uint32_t layer, uint32_t *age);
+
+/* Render thread. Framebuffer_Present() for the layer; rects as there. */
+void DisplayLayers_EndUpdate(uint32_t layer, const DirtyRect *rects, uint32_t count);
+
+/* Render thread. DisplayLayers_EndUpdate() through
+   Framebuffer_PresentBuffer(), for a present deferred by gpu_pipeline.h. */
+void DisplayLayers_EndUpdateBuffer(uint32_t layer, int32_t buffer, const DirtyRect *rects, uint32_t count);
+
+#ifdef __cplusplus
+}
+
+enum class DisplayLayer : uint8_t { Background, Gauges, Warning, Count };
+
+struct DisplayLayerStats {
+  uint32_t updates;
+  uint32_t renderAvgUs;
+  uint32_t renderMaxUs;
+  uint64_t bytesWritten;
+  uint32_t scanoutBytes; // per refresh, 0 while the layer is disabled
+};
+
+// Allocates and programs the three layers and registers the "layers" console
+// command. Call from main() before the scheduler starts; returns false if a
+// layer did not fit its pool.
+bool DisplayLayers_Init();
+
+// Any task. Shows the warning strip at opacity (255 opaque) or disables it.
+void DisplayLayers_SetWarning(bool visible, uint8_t opacity);
+
+void DisplayLayers_GetStats(DisplayLayer layer, DisplayLayerStats &out);
+void DisplayLayers_ResetStats();
+#endif
+
+#endif /* DISPLAY_LAYERS_H */
@@ -0,0 +1,90 @@
+#include "frame_arena.h"
+
+#include <FreeRTOS.h>
+#include <platforminterface/log.h>
+#include <portable.h>
+#include <task.h>
+
+#include "debug_console.h"
+
+static uint8_t *s_halves[2];
+static uint8_t s_current;
+static size_t s_used;
+static TaskHandle_t s_owner;
+static uint32_t s_scopeDepth;
+
+static uint32_t s_frameAllocs;
+static uint32_t s_frameOverflows;
+static FrameArenaStats s_stats;
+
+static void arenaCommand(const char *args) {
+  (void)args;
+  FrameArena_Report();
+}
+
+void FrameArena_Init() {
+  DebugConsole_Register("arena", "per-frame arena usage", arenaCommand);
+  uint8_t *block = static_cast<uint8_t *>(pvPortMalloc(2 * FRAME_ARENA_SIZE));
+  configASSERT(block != NULL);
+  s_halves[0] = block;
+  s_halves[1] = block + FRAME_ARENA_SIZE;
+  s_current = 0;
+  s_used = 0;
+  s_owner = xTaskGetCurrentTaskHandle();
+}
+
+void *FrameArena_Alloc(size_t size) {
+  const size_t aligned = (size + 7) & ~static_cast<size_t>(7);
+  if (s_halves[0] == NULL || FRAME_ARENA_SIZE - s_used < aligned) {
+    return NULL;
+  }
+  void *p = s_halves[s_current] + s_used;
+  s_used += aligned;
+  s_frameAllocs++;
+  return p;
+}
+
+bool FrameArena_Owns(const void *p) {
+  return s_halves[0] != NULL && p >= s_halves[0] &&
+         p < s_halves[0] + 2 * FRAME_ARENA_SIZE;
+}
+
+void FrameArena_EndFrame() {
+  s_stats.allocs = s_frameAllocs;
+  s_stats.bytes = s_used;
+  s_stats.overflows += s_frameOverflows;
+  if (s_used > s_stats.peakBytes) {
+    s_stats.peakBytes = s_used;
+  }
+  s_stats.frames++;
+  s_frameAllocs = 0;
+  s_frameOverflows = 0;
+
+  s_current ^= 1;
+  s_used = 0;
+}
+
+bool FrameArena_IsOwner() { return s_owner != NULL && xTaskGetCurrentTaskHandle() == s_owner; }
+
+bool FrameArena_Routing() { return s_scopeDepth != 0 && FrameArena_IsOwner(); }
+
+void FrameArena_NoteOverflow() { s_frameOverflows++; }
+
+void FrameArena_GetStats(FrameArenaStats &out) { out = s_stats; }
+
+void FrameArena_Report() {
+  Qul::PlatformInterface::log("frame arena: %u allocs/frame (%u bytes), peak %u/%u bytes, %u overflows\r\n",
+                              (unsigned)s_stats.allocs, (unsigned)s_stats.bytes,
+                              (unsigned)s_stats.peakBytes, (unsigned)FRAME_ARENA_SIZE,
+                              (unsigned)s_stats.overflows);
+  if (s_stats.peakBytes == 0U && s_stats.overflows == 0U) {
+    Qul::PlatformInterface::log("  nothing routed yet: no FrameArenaScope or FrameAllocator in use\r\n");
+  }
+}
+
+FrameArenaScope::FrameArenaScope() {
+  configASSERT(xTaskGetCurrentTaskHandle() == s_owner);
+  s_scopeDepth++;
+}
+
+FrameArenaScope::~FrameArenaScope() { s_scopeDepth--; }
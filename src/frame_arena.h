@@ -0,0 +1,121 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef QUL_STD_STRING_SUPPORT
+#include <string>
+#endif
+
+// Linear arena for allocations that do not outlive the frame they were made
+// in, owned by the UI thread.
+//
+// The arena is double-buffered: FrameArena_EndFrame() switches to the other
+// half and rewinds it. Memory handed out therefore stays valid until the end
+// of the *next* frame, which makes the reset safe no matter where in the
+// update cycle it runs. Freeing arena memory is a no-op.
+//
+// Allocations reach the arena in two ways:
+//  - FrameArenaScope: while one is alive on the owner task, plain new/new[]
+//    are served from the arena. Only wrap code whose objects die by the end
+//    of the frame; anything stored in a Qul property must not be created in
+//    a scope.
+//  - FrameAllocator<T>: an allocator for containers and strings that are
+//    transient by type, e.g. FrameString. On any task but the owner it is a
+//    plain heap allocator.
+// When the arena runs out, both fall back to the regular heap.
+//
+// Nothing in src allocates per frame, so nothing here opens a scope or uses
+// FrameAllocator: the transient allocations are in the UI glue (generated
+// code, Msg_SendToUI handlers), and the arena only takes load off the heap
+// once that code adopts it. Until then it stays empty and "arena" reports 0
+// allocations per frame.
+
+#ifndef FRAME_ARENA_SIZE
+#define FRAME_ARENA_SIZE (64 * 1024) /* per half */
+#endif
+
+struct FrameArenaStats {
+  uint32_t allocs;    // served by the arena in the last completed frame
+  uint32_t bytes;     // bytes handed out in the last completed frame
+  uint32_t overflows; // requests that went to the heap instead
+  uint32_t peakBytes; // largest single-frame usage seen
+  uint32_t frames;
+};
+
+// Call once from the owner (UI) task before using the arena.
+void FrameArena_Init();
+
+// Owner task only. nullptr when the current half is exhausted.
+void *FrameArena_Alloc(size_t size);
+
+bool FrameArena_Owns(const void *p);
+
+// True on the owner task, once FrameArena_Init() has run.
+bool FrameArena_IsOwner();
+
+// Owner task only, once per frame.
+void FrameArena_EndFrame();
+
+// True while a FrameArenaScope is alive on the calling task; used by the
+// global operator new.
+bool FrameArena_Routing();
+
+// Counts a routed request the arena could not satisfy.
+void FrameArena_NoteOverflow();
+
+void FrameArena_GetStats(FrameArenaStats &out);
+void FrameArena_Report();
+
+class FrameArenaScope {
+public:
+  FrameArenaScope();
+  ~FrameArenaScope();
+  FrameArenaScope(const FrameArenaScope &) = delete;
+  FrameArenaScope &operator=(const FrameArenaScope &) = delete;
+};
+
+template <typename T> struct FrameAllocator {
+  using value_type = T;
+
+  FrameAllocator() = default;
+  template <typename U> FrameAllocator(const FrameAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    if (!FrameArena_IsOwner()) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void *p = FrameArena_Alloc(n * sizeof(T));
+    if (p == nullptr) {
+      // Inside a FrameArenaScope, operator new tries the arena again and
+      // counts the overflow itself.
+      if (!FrameArena_Routing()) {
+        FrameArena_NoteOverflow();
+      }
+      p = ::operator new(n * sizeof(T));
+    }
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, size_t) {
+    if (!FrameArena_Owns(p)) {
+      ::operator delete(p);
+    }
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &) {
+  return false;
+}
+
+#ifdef QUL_STD_STRING_SUPPORT
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+#endif
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,241 @@
+#include "frame_loop.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <qul/application.h>
+#include <stdlib.h>
+#include <task.h>
+
+#include "boot_trace.h"
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "frame_arena.h"
+#include "frame_timing.h"
+#include "glyph_cache.h"
+#include "preload.h"
+#include "profiler.h"
+#include "signal_bridge.h"
+#include "touch_gt911.h"
+
+static TaskHandle_t s_task;
+static std::atomic<uint32_t> s_targetFps{FRAME_LOOP_TARGET_FPS};
+static std::atomic<uint32_t> s_vsyncs{0};
+static std::atomic<bool> s_idle{false};
+static std::atomic<bool> s_eventDriven{true};
+
+// Loop task only; the console reads them without locking.
+static FrameLoopStats s_stats;
+static uint32_t s_shed = 1; // frame period multiplier under load
+static uint32_t s_overruns;
+static uint32_t s_relaxed;
+
+extern "C" void FrameLoop_NotifyVsync(void) {
+  FrameTiming_MarkVsync();
+  s_vsyncs.fetch_add(1, std::memory_order_relaxed);
+  if (s_task != NULL && !s_idle.load(std::memory_order_relaxed)) {
+    BaseType_t woken = pdFALSE;
+    (void)xTaskNotifyFromISR(s_task, FRAME_LOOP_EVENT_VSYNC, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+static uint32_t currentFps() {
+  const uint32_t target = s_targetFps.load(std::memory_order_relaxed);
+  const uint32_t floor = target < FRAME_LOOP_MIN_FPS ? target : FRAME_LOOP_MIN_FPS;
+  const uint32_t fps = target / s_shed;
+  return fps < floor ? floor : fps;
+}
+
+static TickType_t ticksFor(uint64_t us) {
+  const uint64_t ticks = (us * configTICK_RATE_HZ + 999999U) / 1000000U;
+  return ticks != 0 ? (TickType_t)ticks : 1;
+}
+
+static uint64_t elapsedUs(TickType_t since) {
+  return (uint64_t)(xTaskGetTickCount() - since) * (1000000U / configTICK_RATE_HZ);
+}
+
+// Same time base as the timestamps Application::update() returns on the
+// FreeRTOS platform.
+static uint64_t nowMs() { return (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS; }
+
+// Sleeps while nothing is animating and no producer has published anything,
+// until Qul's next scheduled update, a bridge notification or touch input.
+// Returns false
+// if it woke for neither, e.g. on a stray vsync bit.
+static bool sleepUntilNeeded(uint64_t nextUpdateMs) {
+  const uint64_t now = nowMs();
+  uint64_t waitMs = nextUpdateMs - now;
+  if (waitMs > FRAME_LOOP_IDLE_MAX_MS) {
+    waitMs = FRAME_LOOP_IDLE_MAX_MS;
+  }
+  uint32_t events = 0;
+  s_idle.store(true, std::memory_order_relaxed);
+  (void)xTaskNotifyWait(0, UINT32_MAX, &events, ticksFor(waitMs * 1000U));
+  s_idle.store(false, std::memory_order_relaxed);
+  if ((events & (FRAME_LOOP_EVENT_SIGNAL | FRAME_LOOP_EVENT_INPUT)) == 0 && nowMs() < nextUpdateMs &&
+      nowMs() - now < FRAME_LOOP_IDLE_MAX_MS) {
+    return false;
+  }
+  s_stats.idleWakes++;
+  return true;
+}
+
+// Doubles the frame period after a run of overruns and halves it again once
+// frames comfortably fit the shorter period.
+static void adaptLoad(uint32_t frameUs, uint32_t periodUs) {
+  if (frameUs > periodUs) {
+    s_relaxed = 0;
+    if (++s_overruns >= FRAME_LOOP_OVERLOAD_FRAMES && currentFps() > FRAME_LOOP_MIN_FPS) {
+      s_shed *= 2;
+      s_overruns = 0;
+    }
+    return;
+  }
+  s_overruns = 0;
+  if (s_shed > 1 && frameUs < periodUs / 2) {
+    if (++s_relaxed >= FRAME_LOOP_RECOVER_FRAMES) {
+      s_shed /= 2;
+      s_relaxed = 0;
+    }
+  } else {
+    s_relaxed = 0;
+  }
+}
+
+static uint32_t renderFrame(Qul::Application &app, uint64_t &nextUpdateMs, uint32_t periodUs) {
+  PROFILE_ZONE("frame");
+  const uint32_t start = CycleCounter_Read();
+  const bool preloaded = Preload_Finished();
+  FrameTiming_MarkUpdate();
+  // Input read now is seen once this frame is rendered and scanned out,
+  // about one and a half frame periods later.
+  Touch_Dispatch(periodUs + periodUs / 2U);
+  SignalBridge_Drain();
+  nextUpdateMs = app.update();
+  FrameArena_EndFrame();
+  GlyphCache_EndFrame();
+  FrameTiming_MarkDone();
+  BootTrace_FrameDone(preloaded);
+  s_stats.frames++;
+  return CycleCounter_ToUs(CycleCounter_Read() - start);
+}
+
+void FrameLoop_Run(Qul::Application &app) {
+  s_task = xTaskGetCurrentTaskHandle();
+  SignalBridge_SetWakeTarget(s_task, FRAME_LOOP_EVENT_SIGNAL);
+  Touch_SetWakeTarget(s_task, FRAME_LOOP_EVENT_INPUT);
+  const TickType_t start = xTaskGetTickCount();
+  TickType_t lastPublish = start;
+  uint64_t deadlineUs = 0;
+  uint64_t nextUpdateMs = 0;
+  uint32_t lastVsync = 0;
+
+  while (true) {
+    const uint32_t periodUs = 1000000U / currentFps();
+    uint32_t events = 0;
+    if (s_eventDriven.load(std::memory_order_relaxed) &&
+        nextUpdateMs > nowMs() + periodUs / 1000U) {
+      if (!sleepUntilNeeded(nextUpdateMs)) {
+        continue;
+      }
+      // Render right away and restart pacing from here.
+      deadlineUs = elapsedUs(start);
+      lastVsync = s_vsyncs.load(std::memory_order_relaxed);
+    } else if (s_stats.vsyncPaced) {
+      if (xTaskNotifyWait(0, UINT32_MAX, &events, ticksFor(2U * periodUs)) != pdTRUE) {
+        // Vsync stopped coming, fall back to the timer.
+        s_stats.vsyncPaced = false;
+        deadlineUs = elapsedUs(start);
+        continue;
+      }
+      const uint32_t vsyncs = s_vsyncs.load(std::memory_order_relaxed);
+      uint32_t divider = FRAME_LOOP_PANEL_HZ / currentFps();
+      divider = divider != 0 ? divider : 1;
+      if (vsyncs - lastVsync < divider) {
+        continue;
+      }
+      s_stats.skipped += (vsyncs - lastVsync) / divider - 1U;
+      lastVsync = vsyncs;
+    } else {
+      const uint64_t now = elapsedUs(start);
+      if (deadlineUs > now) {
+        (void)xTaskNotifyWait(0, UINT32_MAX, &events, ticksFor(deadlineUs - now));
+      }
+      if (events & FRAME_LOOP_EVENT_VSYNC) {
+        s_stats.vsyncPaced = true;
+        lastVsync = s_vsyncs.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (elapsedUs(start) < deadlineUs) {
+        continue;
+      }
+    }
+
+    const uint32_t frameUs = renderFrame(app, nextUpdateMs, periodUs);
+    adaptLoad(frameUs, periodUs);
+
+    if (!s_stats.vsyncPaced) {
+      // Drop the slots an overrun ate instead of rendering them back to back.
+      deadlineUs += periodUs;
+      const uint64_t now = elapsedUs(start);
+      if (now > deadlineUs) {
+        const uint32_t missed = (uint32_t)((now - deadlineUs + periodUs - 1U) / periodUs);
+        deadlineUs += (uint64_t)missed * periodUs;
+        s_stats.skipped += missed;
+      }
+    }
+
+    if (xTaskGetTickCount() - lastPublish >= pdMS_TO_TICKS(1000)) {
+      lastPublish = xTaskGetTickCount();
+      FrameTiming_PublishOverlay();
+    }
+  }
+}
+
+void FrameLoop_SetTargetFps(uint32_t fps) {
+  if (fps < 1) {
+    fps = 1;
+  } else if (fps > FRAME_LOOP_PANEL_HZ) {
+    fps = FRAME_LOOP_PANEL_HZ;
+  }
+  s_targetFps.store(fps, std::memory_order_relaxed);
+}
+
+void FrameLoop_SetEventDriven(bool on) { s_eventDriven.store(on, std::memory_order_relaxed); }
+
+void FrameLoop_GetStats(FrameLoopStats &out) {
+  out = s_stats;
+  out.eventDriven = s_eventDriven.load(std::memory_order_relaxed);
+  out.targetFps = s_targetFps.load(std::memory_order_relaxed);
+  out.currentFps = currentFps();
+}
+
+static void fpsCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "poll")) {
+    FrameLoop_SetEventDriven(false);
+  } else if (DebugConsole_ArgIs(args, "event")) {
+    FrameLoop_SetEventDriven(true);
+  } else if (DebugConsole_ArgIs(args, "reset")) {
+    SignalBridge_ResetWakeStats();
+  } else if (*args != '\0') {
+    FrameLoop_SetTargetFps((uint32_t)strtoul(args, NULL, 10));
+  }
+  FrameLoopStats stats;
+  FrameLoop_GetStats(stats);
+  SignalWakeStats wake;
+  SignalBridge_GetWakeStats(wake);
+  Qul::PlatformInterface::log("target %u fps, running %u fps, %s paced, %u frames, %u skipped\r\n",
+                              (unsigned)stats.targetFps, (unsigned)stats.currentFps,
+                              stats.vsyncPaced ? "vsync" : "timer", (unsigned)stats.frames,
+                              (unsigned)stats.skipped);
+  Qul::PlatformInterface::log("%s, %u idle wakes; update to UI avg %u us, max %u us over %u\r\n",
+                              stats.eventDriven ? "event driven" : "polling",
+                              (unsigned)stats.idleWakes, (unsigned)wake.avgUs,
+                              (unsigned)wake.maxUs, (unsigned)wake.wakes);
+}
+
+void FrameLoop_Init() {
+  DebugConsole_Register("fps", "frame pacing and wakeups [<fps>|poll|event|reset]", fpsCommand);
+}
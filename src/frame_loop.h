@@ -0,0 +1,109 @@
+#ifndef FRAME_LOOP_H
+#define FRAME_LOOP_H
+
+#include <stdint.h>
+
+/*
+ * Frame-paced replacement for Qul::Application::exec().
+ *
+ * Every frame runs, in this order: Touch_Dispatch and SignalBridge_Drain
+ * (input and producer updates land at a fixed phase, touch predicted 1.5
+ * frame periods ahead), Application::update(), FrameArena_EndFrame. Frames
+ * are paced in one of two ways:
+ *
+ *  - vsync: once FrameLoop_NotifyVsync() is called from the display
+ *    controller interrupt, the loop renders on every Nth vsync, where N is
+ *    FRAME_LOOP_PANEL_HZ / target fps.
+ *  - timer: without vsync notifications (or when they stop for two frame
+ *    periods), the loop sleeps until the next frame deadline. Deadlines are
+ *    kept in microseconds, so 60 fps averages out exactly even though each
+ *    sleep is whole ticks.
+ *
+ * When Application::update() reports that nothing is scheduled before the
+ * next frame and no producer has published anything, the loop does not
+ * render at all: it sleeps until Qul's next timer, or until the signal bridge
+ * notifies it about the first update after a drain (FRAME_LOOP_EVENT_SIGNAL),
+ * or touch input arrives (FRAME_LOOP_EVENT_INPUT), and then renders
+ * immediately. Vsync notifications are suppressed while it
+ * sleeps. "fps poll" switches back to rendering every frame regardless, for
+ * comparing wake latency ("fps") and CPU use ("cpu") between the two.
+ *
+ * Under load the loop skips frames instead of bursting to catch up: a frame
+ * that overruns moves the next deadline past "now". After
+ * FRAME_LOOP_OVERLOAD_FRAMES overruns in a row the frame period is doubled
+ * (never below FRAME_LOOP_MIN_FPS), and it is halved again after
+ * FRAME_LOOP_RECOVER_FRAMES frames that used less than half of their budget.
+ *
+ * "fps" on the console shows the pacing state; "fps <n>" sets the target.
+ * Both the pacing and the idle check assume the FreeRTOS platform's
+ * timestamps are the tick count in milliseconds.
+ */
+
+#ifndef FRAME_LOOP_TARGET_FPS
+#define FRAME_LOOP_TARGET_FPS 60
+#endif
+
+#ifndef FRAME_LOOP_PANEL_HZ
+#define FRAME_LOOP_PANEL_HZ 60
+#endif
+
+#ifndef FRAME_LOOP_MIN_FPS
+#define FRAME_LOOP_MIN_FPS 15
+#endif
+
+/* Longest idle sleep, keeps housekeeping in update() ticking over. */
+#ifndef FRAME_LOOP_IDLE_MAX_MS
+#define FRAME_LOOP_IDLE_MAX_MS 100
+#endif
+
+#ifndef FRAME_LOOP_OVERLOAD_FRAMES
+#define FRAME_LOOP_OVERLOAD_FRAMES 4
+#endif
+
+#ifndef FRAME_LOOP_RECOVER_FRAMES
+#define FRAME_LOOP_RECOVER_FRAMES 60
+#endif
+
+/* Task notification bits understood by the loop. */
+#define FRAME_LOOP_EVENT_VSYNC (1U << 0)
+#define FRAME_LOOP_EVENT_SIGNAL (1U << 1)
+#define FRAME_LOOP_EVENT_INPUT (1U << 2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Display controller ISR, once per refresh. */
+void FrameLoop_NotifyVsync(void);
+
+#ifdef __cplusplus
+}
+
+namespace Qul {
+class Application;
+}
+
+struct FrameLoopStats {
+  uint32_t frames;
+  uint32_t skipped;    // frame slots dropped because a frame overran
+  uint32_t targetFps;
+  uint32_t currentFps; // target after load shedding
+  uint32_t idleWakes;  // renders that ended an idle sleep
+  bool vsyncPaced;
+  bool eventDriven;
+};
+
+// Registers the "fps" console command. Call before the scheduler starts.
+void FrameLoop_Init();
+
+// Runs the application on the calling task; never returns.
+void FrameLoop_Run(Qul::Application &app);
+
+void FrameLoop_SetTargetFps(uint32_t fps);
+
+// false renders every frame like the old fixed-interval polling did.
+void FrameLoop_SetEventDriven(bool on);
+void FrameLoop_GetStats(FrameLoopStats &out);
+#endif
+
+#endif /* FRAME_LOOP_H */
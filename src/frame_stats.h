@@ -0,0 +1,26 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <qul/property.h>
+#include <qul/singleton.h>
+
+// Frame timing exposed to QML for the debug overlay. List this header under
+// InterfaceFiles in the .qmlproject and bind an overlay Item to it:
+//
+//   Text {
+//     visible: FrameStats.visible
+//     text: FrameStats.fps + " fps  p95 " + FrameStats.p95Us + " us"
+//   }
+//
+// Updated on the Qul thread by FrameTiming_PublishOverlay(); toggled with
+// "frames overlay on|off" on the debug console.
+struct FrameStats : public Qul::Singleton<FrameStats> {
+  Qul::Property<bool> visible;
+  Qul::Property<int> fps;
+  Qul::Property<int> p50Us;
+  Qul::Property<int> p95Us;
+  Qul::Property<int> p99Us;
+  Qul::Property<int> deadlineMisses;
+};
+
+#endif // FRAME_STATS_H
@@ -0,0 +1,203 @@
+#include "frame_timing.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "frame_stats.h"
+#include "profiler.h"
+
+struct FrameHistogram {
+  uint32_t buckets[FRAME_TIMING_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+
+  void add(uint32_t us) {
+    uint32_t bucket = us / FRAME_TIMING_BUCKET_US;
+    if (bucket >= FRAME_TIMING_BUCKETS) {
+      bucket = FRAME_TIMING_BUCKETS - 1;
+    }
+    buckets[bucket]++;
+    count++;
+    sumUs += us;
+    if (us > maxUs) {
+      maxUs = us;
+    }
+  }
+
+  // Upper edge of the bucket holding the given rank, capped at the largest
+  // sample so the overflow bucket still reports something real.
+  uint32_t percentile(uint32_t permille) const {
+    if (count == 0) {
+      return 0;
+    }
+    const uint32_t rank = (uint32_t)(((uint64_t)count * permille + 999U) / 1000U);
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < FRAME_TIMING_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        const uint32_t edge = (i + 1) * FRAME_TIMING_BUCKET_US;
+        return edge < maxUs ? edge : maxUs;
+      }
+    }
+    return maxUs;
+  }
+};
+
+enum FrameMark : uint8_t { MarkUpdate, MarkRender, MarkFlush, MarkDone, MarkCount };
+
+struct FrameTimingState {
+  FrameHistogram phases[static_cast<int>(FramePhase::Count)];
+  uint32_t deadlineMisses;
+  uint32_t missedVsyncs;
+};
+
+// Written by the render thread inside short critical sections.
+static FrameTimingState s_state;
+static uint32_t s_marks[MarkCount];
+static uint8_t s_seen; // bit per FrameMark in the current frame
+static uint32_t s_vsyncAtLastFrame;
+static uint32_t s_fpsWindowStart;
+static uint32_t s_fpsFrames;
+static uint32_t s_fps;
+
+static std::atomic<uint32_t> s_vsyncs{0};
+static std::atomic<bool> s_overlay{false};
+
+static const char *const s_phaseNames[] = {"update", "render", "flush", "total"};
+
+static void mark(FrameMark which) {
+  s_marks[which] = CycleCounter_Read();
+  s_seen |= (uint8_t)(1U << which);
+}
+
+static bool seen(FrameMark which) { return (s_seen & (1U << which)) != 0; }
+
+static void recordPhase(FramePhase phase, FrameMark from, FrameMark to) {
+  if (!seen(from) || !seen(to)) {
+    return;
+  }
+  s_state.phases[static_cast<int>(phase)].add(CycleCounter_ToUs(s_marks[to] - s_marks[from]));
+  if (Profiler_Recording()) {
+    Profiler_Record(s_phaseNames[static_cast<int>(phase)], s_marks[from], s_marks[to]);
+  }
+}
+
+extern "C" void FrameTiming_MarkUpdate(void) {
+  s_seen = 0;
+  mark(MarkUpdate);
+}
+
+extern "C" void FrameTiming_MarkRender(void) { mark(MarkRender); }
+
+extern "C" void FrameTiming_MarkFlush(void) { mark(MarkFlush); }
+
+extern "C" void FrameTiming_MarkDone(void) {
+  mark(MarkDone);
+
+  taskENTER_CRITICAL();
+  recordPhase(FramePhase::Update, MarkUpdate, seen(MarkRender) ? MarkRender : MarkDone);
+  recordPhase(FramePhase::Render, MarkRender, seen(MarkFlush) ? MarkFlush : MarkDone);
+  recordPhase(FramePhase::Flush, MarkFlush, MarkDone);
+  recordPhase(FramePhase::Total, MarkUpdate, MarkDone);
+  if (seen(MarkUpdate) &&
+      CycleCounter_ToUs(s_marks[MarkDone] - s_marks[MarkUpdate]) > FRAME_TIMING_DEADLINE_US) {
+    s_state.deadlineMisses++;
+  }
+  const uint32_t vsyncs = s_vsyncs.load(std::memory_order_relaxed);
+  if (vsyncs - s_vsyncAtLastFrame > 1U && s_vsyncAtLastFrame != 0U) {
+    s_state.missedVsyncs += vsyncs - s_vsyncAtLastFrame - 1U;
+  }
+  s_vsyncAtLastFrame = vsyncs;
+  taskEXIT_CRITICAL();
+
+  s_fpsFrames++;
+  if (s_marks[MarkDone] - s_fpsWindowStart >= SystemCoreClock) {
+    s_fps = s_fpsFrames;
+    s_fpsFrames = 0;
+    s_fpsWindowStart = s_marks[MarkDone];
+  }
+  s_seen = 0;
+}
+
+extern "C" void FrameTiming_MarkVsync(void) {
+  s_vsyncs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameTiming_Summarize(FrameTimingSummary &out) {
+  // The marks run on a task, so suspending the scheduler is enough to read a
+  // consistent state without masking interrupts for the percentile walk.
+  vTaskSuspendAll();
+  for (int i = 0; i < static_cast<int>(FramePhase::Count); i++) {
+    const FrameHistogram &histogram = s_state.phases[i];
+    FramePercentiles &p = out.phase[i];
+    p.frames = histogram.count;
+    p.p50Us = histogram.percentile(500);
+    p.p95Us = histogram.percentile(950);
+    p.p99Us = histogram.percentile(990);
+    p.maxUs = histogram.maxUs;
+    p.avgUs = histogram.count != 0 ? (uint32_t)(histogram.sumUs / histogram.count) : 0;
+  }
+  out.deadlineMisses = s_state.deadlineMisses;
+  out.missedVsyncs = s_state.missedVsyncs;
+  out.fps = s_fps;
+  (void)xTaskResumeAll();
+}
+
+void FrameTiming_Report() {
+  FrameTimingSummary summary;
+  FrameTiming_Summarize(summary);
+  Qul::PlatformInterface::log("phase     frames      avg      p50      p95      p99      max (us)\r\n");
+  for (int i = 0; i < static_cast<int>(FramePhase::Count); i++) {
+    const FramePercentiles &p = summary.phase[i];
+    Qul::PlatformInterface::log("%-8s %7u %8u %8u %8u %8u %8u\r\n", s_phaseNames[i],
+                                (unsigned)p.frames, (unsigned)p.avgUs, (unsigned)p.p50Us,
+                                (unsigned)p.p95Us, (unsigned)p.p99Us, (unsigned)p.maxUs);
+  }
+  Qul::PlatformInterface::log("%u fps, %u over %u us, %u missed vsyncs\r\n",
+                              (unsigned)summary.fps, (unsigned)summary.deadlineMisses,
+                              (unsigned)FRAME_TIMING_DEADLINE_US, (unsigned)summary.missedVsyncs);
+}
+
+void FrameTiming_Reset() {
+  taskENTER_CRITICAL();
+  memset(&s_state, 0, sizeof(s_state));
+  taskEXIT_CRITICAL();
+}
+
+void FrameTiming_PublishOverlay() {
+  FrameStats &stats = FrameStats::instance();
+  const bool visible = s_overlay.load(std::memory_order_relaxed);
+  stats.visible.setValue(visible);
+  if (!visible) {
+    return;
+  }
+  FrameTimingSummary summary;
+  FrameTiming_Summarize(summary);
+  const FramePercentiles &total = summary.phase[static_cast<int>(FramePhase::Total)];
+  stats.fps.setValue((int)summary.fps);
+  stats.p50Us.setValue((int)total.p50Us);
+  stats.p95Us.setValue((int)total.p95Us);
+  stats.p99Us.setValue((int)total.p99Us);
+  stats.deadlineMisses.setValue((int)summary.deadlineMisses);
+}
+
+static void framesCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    FrameTiming_Reset();
+  } else if (DebugConsole_ArgIs(args, "overlay")) {
+    s_overlay.store(strstr(args, "on") != NULL, std::memory_order_relaxed);
+  } else {
+    FrameTiming_Report();
+  }
+}
+
+void FrameTiming_Init() {
+  DebugConsole_Register("frames", "frame time percentiles [reset|overlay on|overlay off]",
+                        framesCommand);
+}
@@ -0,0 +1,89 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <stdint.h>
+
+/*
+ * Per-frame timing of the Qul render loop.
+ *
+ * The phases are marked from where they actually happen. The frame loop
+ * (frame_loop.h) marks update and done around Application::update(); render
+ * and flush are marked from the platform glue (platform/ generated by
+ * qmlprojectexporter, around beginFrame/endFrame and presentFrame). Each
+ * frame is
+ *
+ *   MarkUpdate --update-- MarkRender --render-- MarkFlush --flush-- MarkDone
+ *
+ * Every phase and the whole frame go into a fixed-size histogram of
+ * FRAME_TIMING_BUCKET_US wide buckets, from which p50/p95/p99 are read. A
+ * frame longer than FRAME_TIMING_DEADLINE_US counts as a deadline miss;
+ * if MarkVsync is called from the LCDIFv2 vsync interrupt, vsyncs that went by
+ * without a finished frame are counted as missed vsyncs too. A phase whose
+ * mark is never called is simply not recorded.
+ *
+ * The "frames" console command prints the table and toggles the on-screen
+ * overlay (the FrameStats singleton in frame_stats.h). While the profiler is
+ * recording, the phases are also emitted as profiler zones so they line up
+ * with everything else in the trace.
+ */
+
+#ifndef FRAME_TIMING_BUCKET_US
+#define FRAME_TIMING_BUCKET_US 250
+#endif
+
+/* The last bucket collects everything above (BUCKETS - 1) * BUCKET_US. */
+#ifndef FRAME_TIMING_BUCKETS
+#define FRAME_TIMING_BUCKETS 128
+#endif
+
+#ifndef FRAME_TIMING_DEADLINE_US
+#define FRAME_TIMING_DEADLINE_US 16667 /* one 60 Hz refresh */
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Render thread. */
+void FrameTiming_MarkUpdate(void);
+void FrameTiming_MarkRender(void);
+void FrameTiming_MarkFlush(void);
+void FrameTiming_MarkDone(void);
+
+/* Any context, usually the display controller ISR. */
+void FrameTiming_MarkVsync(void);
+
+#ifdef __cplusplus
+}
+
+enum class FramePhase : uint8_t { Update, Render, Flush, Total, Count };
+
+struct FramePercentiles {
+  uint32_t frames;
+  uint32_t p50Us;
+  uint32_t p95Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+  uint32_t avgUs;
+};
+
+struct FrameTimingSummary {
+  FramePercentiles phase[static_cast<int>(FramePhase::Count)];
+  uint32_t deadlineMisses;
+  uint32_t missedVsyncs;
+  uint32_t fps; // frames completed in the last second
+};
+
+// Registers the "frames" console command.
+void FrameTiming_Init();
+
+void FrameTiming_Summarize(FrameTimingSummary &out);
+void FrameTiming_Report();
+void FrameTiming_Reset();
+
+// Render thread, about once a second: pushes the summary into the overlay
+// singleton when the overlay is on.
+void FrameTiming_PublishOverlay();
+#endif
+
+#endif /* FRAME_TIMING_H */
@@ -0,0 +1,409 @@
+#include "framebuffer.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <fsl_lcdifv2.h>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "swap_chain.h"
+
+// Pool windows reserved in armgcc/mem_regions.ld.
+extern "C" uint8_t __fb_sdram_start[];
+extern "C" uint8_t __fb_ocram_start[];
+
+struct Pool {
+  uint8_t *base;
+  uint32_t size;
+  uint32_t used;
+};
+
+struct Layer {
+  SwapChain chain;
+  FramebufferLayerConfig config;
+  uint8_t *buffers[SWAP_CHAIN_MAX_BUFFERS];
+  uint32_t stride;
+  uint32_t bytesPerPixel;
+  int8_t current; // acquired, not yet presented
+  bool held;      // current waits for a deferred present
+  int8_t front;   // most recently presented
+  TaskHandle_t waiter;
+  bool configured;
+  uint32_t flipTimeouts;
+  uint32_t waits;
+  uint32_t waitMax;
+  uint64_t waitSum;
+  uint16_t tearLineLast;
+  uint16_t tearLineMin;
+  uint16_t tearLineMax;
+};
+
+static Pool s_sdram = {__fb_sdram_start, FRAMEBUFFER_SDRAM_POOL_SIZE, 0};
+static Pool s_ocram = {__fb_ocram_start, FRAMEBUFFER_OCRAM_POOL_SIZE, 0};
+
+// Shared with the vsync ISR; touched only with interrupts masked.
+static Layer s_layers[FRAMEBUFFER_MAX_LAYERS];
+static struct {
+  uint32_t count;
+  uint32_t last;   // cycles
+  uint32_t period; // cycles between the last two
+} s_vsync;
+
+static std::atomic<bool> s_tearing{false};
+
+static uint32_t alignUp(uint32_t value, uint32_t align) { return (value + align - 1U) / align * align; }
+
+// Carves bytes out of pool. Sdram buffers start bank pages into a whole bank
+// rotation, so consecutive buffers of a layer sit in different banks.
+static uint8_t *take(Pool &pool, uint32_t bytes, FramebufferPlacement placement, uint32_t bank) {
+  uint32_t offset = alignUp(pool.used, FRAMEBUFFER_ALIGN);
+  if (placement == FramebufferPlacement::Sdram) {
+    offset = alignUp(offset, FRAMEBUFFER_SDRAM_PAGE_BYTES * FRAMEBUFFER_SDRAM_BANKS) +
+             (bank % FRAMEBUFFER_SDRAM_BANKS) * FRAMEBUFFER_SDRAM_PAGE_BYTES;
+  }
+  if (offset > pool.size || bytes > pool.size - offset) {
+    return nullptr;
+  }
+  pool.used = offset + bytes;
+  return pool.base + offset;
+}
+
+static Layer *findLayer(uint32_t layer) {
+  return layer < FRAMEBUFFER_MAX_LAYERS && s_layers[layer].configured ? &s_layers[layer] : nullptr;
+}
+
+// The controller clears SHADOW_LOAD_EN once it has latched the registers at
+// a vertical blank.
+static bool shadowLoaded(uint32_t layer) {
+  return (LCDIFV2->LAYER[layer].CTRLDESCL5 & LCDIFV2_CTRLDESCL5_SHADOW_LOAD_EN_MASK) == 0U;
+}
+
+// Interrupts masked. Catches up with a flip the hardware has made but the
+// vsync ISR has not handled yet.
+static void catchUp(uint32_t index, Layer &layer, uint32_t now) {
+  if (layer.chain.queued() >= 0 && shadowLoaded(index)) {
+    (void)layer.chain.flip(now);
+  }
+}
+
+// Estimated scan line at now, from the time since the last vsync.
+static uint16_t scanLine(const Layer &layer, uint32_t now) {
+  if (s_vsync.period == 0U) {
+    return 0;
+  }
+  const uint64_t line = (uint64_t)(now - s_vsync.last) * layer.config.height / s_vsync.period;
+  return line < layer.config.height ? (uint16_t)line : (uint16_t)(layer.config.height - 1U);
+}
+
+extern "C" void *Framebuffer_Acquire(uint32_t layer, uint32_t *age) {
+  Layer *l = findLayer(layer);
+  if (l == nullptr) {
+    return NULL;
+  }
+  // The previous frame's present is still deferred: its buffer would be
+  // handed out again and drawn over (GpuPipeline_BeginFrame() comes first).
+  configASSERT(!l->held);
+  if (l->current >= 0) {
+    // Acquired twice without a present: still the same frame.
+    if (age != NULL) {
+      *age = 0;
+    }
+    return l->buffers[l->current];
+  }
+  const bool tear = s_tearing.load(std::memory_order_relaxed);
+  const bool scheduler = xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+  const uint32_t start = CycleCounter_Read();
+  bool waited = false;
+  uint32_t bufferAge = 0;
+  int index;
+  while (true) {
+    const uint32_t now = CycleCounter_Read();
+    const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    catchUp(layer, *l, now);
+    index = l->chain.acquire(tear, bufferAge);
+    if (index >= 0 && l->chain.state(index) == BufferState::Scanout && l->chain.count() > 1U) {
+      const uint16_t line = scanLine(*l, now);
+      l->tearLineLast = line;
+      l->tearLineMin = line < l->tearLineMin ? line : l->tearLineMin;
+      l->tearLineMax = line > l->tearLineMax ? line : l->tearLineMax;
+    }
+    if (index < 0 && !scheduler) {
+      // Nothing is on screen yet that a flip could tear.
+      (void)l->chain.flip(now);
+      index = l->chain.acquire(tear, bufferAge);
+    }
+    l->waiter = index < 0 ? xTaskGetCurrentTaskHandle() : NULL;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    if (index >= 0) {
+      break;
+    }
+    waited = true;
+    if (ulTaskNotifyTakeIndexed(FRAMEBUFFER_NOTIFY_INDEX, pdTRUE,
+                                pdMS_TO_TICKS(FRAMEBUFFER_FLIP_TIMEOUT_MS)) == 0U) {
+      // No vsync hook, or the display stopped: take the flip as done.
+      const UBaseType_t timeoutMask = taskENTER_CRITICAL_FROM_ISR();
+      if (l->chain.flip(CycleCounter_Read())) {
+        l->flipTimeouts++;
+      }
+      taskEXIT_CRITICAL_FROM_ISR(timeoutMask);
+    }
+  }
+  if (waited) {
+    const uint32_t cycles = CycleCounter_Read() - start;
+    l->waits++;
+    l->waitSum += cycles;
+    l->waitMax = cycles > l->waitMax ? cycles : l->waitMax;
+  }
+  l->current = (int8_t)index;
+  if (age != NULL) {
+    *age = bufferAge;
+  }
+  return l->buffers[index];
+}
+
+// Writes the CPU-drawn pixels back to memory before the LCDIF reads them.
+static void cleanRects(const Layer &layer, uint8_t *buffer, const DirtyRect *rects, uint32_t count) {
+  const uint32_t height = layer.config.height;
+  if (count == 0U) {
+    SCB_CleanDCache_by_Addr(buffer, (int32_t)(layer.stride * height));
+    return;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    const DirtyRect &r = rects[i];
+    const uint32_t x = (uint32_t)r.x;
+    const uint32_t y = (uint32_t)r.y;
+    if (x >= layer.config.width || y >= height) {
+      continue;
+    }
+    const uint32_t w = x + (uint32_t)r.w > layer.config.width ? layer.config.width - x : (uint32_t)r.w;
+    const uint32_t h = y + (uint32_t)r.h > height ? height - y : (uint32_t)r.h;
+    uint8_t *first = buffer + y * layer.stride + x * layer.bytesPerPixel;
+    if (x == 0U && w == layer.config.width) {
+      SCB_CleanDCache_by_Addr(first, (int32_t)(h * layer.stride));
+      continue;
+    }
+    for (uint32_t row = 0; row < h; row++) {
+      SCB_CleanDCache_by_Addr(first + row * layer.stride, (int32_t)(w * layer.bytesPerPixel));
+    }
+  }
+}
+
+extern "C" void Framebuffer_Present(uint32_t layer, const DirtyRect *rects, uint32_t count) {
+  const Layer *l = findLayer(layer);
+  if (l != nullptr) {
+    Framebuffer_PresentBuffer(layer, l->current, rects, count);
+  }
+}
+
+extern "C" int32_t Framebuffer_Hold(uint32_t layer) {
+  Layer *l = findLayer(layer);
+  if (l == nullptr || l->current < 0) {
+    return -1;
+  }
+  l->held = true;
+  return l->current;
+}
+
+extern "C" void Framebuffer_PresentBuffer(uint32_t layer, int32_t buffer, const DirtyRect *rects, uint32_t count) {
+  Layer *l = findLayer(layer);
+  if (l == nullptr || buffer < 0 || buffer != l->current) {
+    return;
+  }
+  const int index = l->current;
+  l->held = false;
+  cleanRects(*l, l->buffers[index], rects, count);
+  __DSB();
+
+  const uint32_t now = CycleCounter_Read();
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  // A flip latched between here and the register write below is missed and
+  // its buffer counted as replaced; the window is a few cycles per frame.
+  catchUp(layer, *l, now);
+  (void)l->chain.present(now);
+  if (l->chain.queued() == index) {
+    LCDIFV2_SetLayerBufferAddr(LCDIFV2, (uint8_t)layer, (uint32_t)(uintptr_t)l->buffers[index]);
+    LCDIFV2_TriggerLayerShadowLoad(LCDIFV2, (uint8_t)layer);
+  }
+  l->front = (int8_t)index;
+  l->current = -1;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+extern "C" const void *Framebuffer_Front(uint32_t layer) {
+  const Layer *l = findLayer(layer);
+  return l != nullptr ? l->buffers[l->front] : NULL;
+}
+
+extern "C" void Framebuffer_OnVsync(void) {
+  const uint32_t now = CycleCounter_Read();
+  BaseType_t woken = pdFALSE;
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if (s_vsync.count != 0U) {
+    s_vsync.period = now - s_vsync.last;
+  }
+  s_vsync.last = now;
+  s_vsync.count++;
+  for (uint32_t i = 0; i < FRAMEBUFFER_MAX_LAYERS; i++) {
+    Layer &layer = s_layers[i];
+    if (!layer.configured || !shadowLoaded(i) || !layer.chain.flip(now)) {
+      continue;
+    }
+    if (layer.waiter != NULL) {
+      vTaskNotifyGiveIndexedFromISR(layer.waiter, FRAMEBUFFER_NOTIFY_INDEX, &woken);
+      layer.waiter = NULL;
+    }
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  portYIELD_FROM_ISR(woken);
+}
+
+bool Framebuffer_ConfigureLayer(uint32_t layer, const FramebufferLayerConfig &config) {
+  if (layer >= FRAMEBUFFER_MAX_LAYERS || s_layers[layer].configured || config.buffers == 0U ||
+      config.buffers > SWAP_CHAIN_MAX_BUFFERS || config.width == 0U || config.height == 0U) {
+    return false;
+  }
+  Layer &l = s_layers[layer];
+  Pool &pool = config.placement == FramebufferPlacement::Ocram ? s_ocram : s_sdram;
+  const uint32_t used = pool.used;
+  l.bytesPerPixel = config.format == PixelFormat::Argb8888 ? 4U : 2U;
+  l.stride = alignUp(config.width * l.bytesPerPixel, FRAMEBUFFER_ALIGN);
+  const uint32_t bytes = l.stride * config.height;
+  for (uint32_t i = 0; i < config.buffers; i++) {
+    l.buffers[i] = take(pool, bytes, config.placement, config.sdramBank + i);
+    if (l.buffers[i] == nullptr) {
+      pool.used = used;
+      return false;
+    }
+    memset(l.buffers[i], 0, bytes);
+    SCB_CleanDCache_by_Addr(l.buffers[i], (int32_t)bytes);
+  }
+  l.config = config;
+  l.chain.reset(config.buffers);
+  l.current = -1;
+  l.held = false;
+  l.front = 0;
+  l.tearLineMin = UINT16_MAX;
+
+  lcdifv2_buffer_config_t buffer = {};
+  buffer.strideBytes = (uint16_t)l.stride;
+  buffer.pixelFormat = config.format == PixelFormat::Rgb565     ? kLCDIFV2_PixelFormatRGB565
+                       : config.format == PixelFormat::Argb4444 ? kLCDIFV2_PixelFormatARGB4444
+                                                                : kLCDIFV2_PixelFormatARGB8888;
+  LCDIFV2_SetLayerBufferConfig(LCDIFV2, (uint8_t)layer, &buffer);
+  LCDIFV2_SetLayerSize(LCDIFV2, (uint8_t)layer, config.width, config.height);
+  LCDIFV2_SetLayerBufferAddr(LCDIFV2, (uint8_t)layer, (uint32_t)(uintptr_t)l.buffers[0]);
+  LCDIFV2_TriggerLayerShadowLoad(LCDIFV2, (uint8_t)layer);
+
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  l.configured = true;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return true;
+}
+
+uint32_t Framebuffer_Stride(uint32_t layer) {
+  const Layer *l = findLayer(layer);
+  return l != nullptr ? l->stride : 0U;
+}
+
+void Framebuffer_GetStats(uint32_t layer, FramebufferStats &out) {
+  memset(&out, 0, sizeof(out));
+  Layer *l = findLayer(layer);
+  if (l == nullptr) {
+    return;
+  }
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  const SwapChainStats chain = l->chain.stats();
+  out.flipTimeouts = l->flipTimeouts;
+  out.vsyncs = s_vsync.count;
+  out.vsyncPeriodUs = CycleCounter_ToUs(s_vsync.period);
+  out.waits = l->waits;
+  out.waitAvgUs = l->waits != 0U ? CycleCounter_ToUs((uint32_t)(l->waitSum / l->waits)) : 0U;
+  out.waitMaxUs = CycleCounter_ToUs(l->waitMax);
+  out.tearLineLast = l->tearLineLast;
+  out.tearLineMin = chain.tears != 0U ? l->tearLineMin : 0U;
+  out.tearLineMax = l->tearLineMax;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  out.presents = chain.presents;
+  out.flips = chain.flips;
+  out.replaced = chain.replaced;
+  out.tears = chain.tears;
+  out.latencyAvgUs = chain.flips != 0U ? CycleCounter_ToUs((uint32_t)(chain.latencySum / chain.flips)) : 0U;
+  out.latencyMaxUs = CycleCounter_ToUs(chain.latencyMax);
+}
+
+void Framebuffer_ResetStats() {
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  for (Layer &l : s_layers) {
+    l.chain.resetStats();
+    l.flipTimeouts = 0;
+    l.waits = 0;
+    l.waitMax = 0;
+    l.waitSum = 0;
+    l.tearLineLast = 0;
+    l.tearLineMin = UINT16_MAX;
+    l.tearLineMax = 0;
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void Framebuffer_SetTearing(bool on) { s_tearing.store(on, std::memory_order_relaxed); }
+
+static void fbCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    Framebuffer_ResetStats();
+  } else if (DebugConsole_ArgIs(args, "tear")) {
+    bool on;
+    if (!DebugConsole_ArgOnOff(args, on)) {
+      Qul::PlatformInterface::log("usage: fb tear on|off\r\n");
+      return;
+    }
+    Framebuffer_SetTearing(on);
+    Framebuffer_ResetStats();
+  }
+  Qul::PlatformInterface::log("flips %s\r\n",
+                              s_tearing.load(std::memory_order_relaxed) ? "unsynchronised (tear test)" : "on vsync");
+  for (uint32_t i = 0; i < FRAMEBUFFER_MAX_LAYERS; i++) {
+    const Layer *l = findLayer(i);
+    if (l == nullptr) {
+      continue;
+    }
+    FramebufferStats stats;
+    Framebuffer_GetStats(i, stats);
+    Qul::PlatformInterface::log("layer %u: %ux%u %ubpp x%u in %s at %p, pitch %u\r\n", (unsigned)i,
+                                (unsigned)l->config.width, (unsigned)l->config.height,
+                                (unsigned)(l->bytesPerPixel * 8U), (unsigned)l->config.buffers,
+                                l->config.placement == FramebufferPlacement::Ocram ? "OCRAM" : "SDRAM",
+                                l->buffers[0], (unsigned)l->stride);
+    Qul::PlatformInterface::log("  %u presents, %u flips, %u replaced, %u flip timeouts; %u vsyncs every %u us\r\n",
+                                (unsigned)stats.presents, (unsigned)stats.flips,
+                                (unsigned)stats.replaced, (unsigned)stats.flipTimeouts,
+                                (unsigned)stats.vsyncs, (unsigned)stats.vsyncPeriodUs);
+    Qul::PlatformInterface::log("  present->flip avg %u us, max %u us; %u waits for a buffer, avg %u us, max %u us\r\n",
+                                (unsigned)stats.latencyAvgUs, (unsigned)stats.latencyMaxUs,
+                                (unsigned)stats.waits, (unsigned)stats.waitAvgUs,
+                                (unsigned)stats.waitMaxUs);
+    if (stats.tears != 0U) {
+      Qul::PlatformInterface::log("  %u torn frames, drawing started at line %u..%u (last %u)\r\n",
+                                  (unsigned)stats.tears, (unsigned)stats.tearLineMin,
+                                  (unsigned)stats.tearLineMax, (unsigned)stats.tearLineLast);
+    }
+  }
+}
+
+void Framebuffer_Init() {
+#if APP_FRAMEBUFFER && !APP_DISPLAY_LAYERS
+  FramebufferLayerConfig config = {};
+  config.width = DISPLAY_WIDTH;
+  config.height = DISPLAY_HEIGHT;
+  config.format = DISPLAY_BYTES_PER_PIXEL == 2 ? PixelFormat::Rgb565 : PixelFormat::Argb8888;
+  config.buffers = FRAMEBUFFER_COUNT;
+  config.placement = FramebufferPlacement::Sdram;
+  if (!Framebuffer_ConfigureLayer(0, config)) {
+    Qul::PlatformInterface::log("Framebuffer allocation failed!.\r\n");
+  }
+#endif
+  DebugConsole_Register("fb", "framebuffer flips and latency [reset|tear on|tear off]", fbCommand);
+}
@@ -0,0 +1,178 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+
+#include "dirty_region.h"
+#include "display_config.h"
+
+/*
+ * Framebuffer manager for the LCDIFv2 layers.
+ *
+ * Each layer gets one to three buffers (swap_chain.h) in its own pixel format
+ * (RGB565, ARGB4444 or ARGB8888), carved at boot from one of two pools:
+ *
+ *  - Sdram: a NOLOAD window in cached SDRAM (armgcc/mem_regions.ld).
+ *    Every buffer starts on a FRAMEBUFFER_ALIGN boundary and lines are padded
+ *    to it, so the LCDIF and VGLite always issue whole 64-byte bursts and no
+ *    cache line is shared between two lines. Successive buffers of a layer
+ *    also start one SDRAM page further into the bank rotation than the
+ *    previous one: SEMC puts the bank bits right above the column bits, so
+ *    without the offset the scanout of one buffer and the rendering into the
+ *    next hit the same bank at the same position and keep closing each
+ *    other's rows.
+ *  - Ocram: a NOLOAD window in SRAM_OC1 for small overlays (a few hundred
+ *    lines at 16bpp), which then cost no SDRAM bandwidth at all.
+ *
+ * A single buffer suits a static layer that is drawn in place once.
+ *
+ * The platform glue (platform/ generated by qmlprojectexporter) draws into
+ * Framebuffer_Acquire() instead of its own buffers and hands finished frames
+ * to Framebuffer_Present(). Present cleans the dirty rectangles out of the
+ * data cache, programs the layer address and arms the LCDIFv2 shadow load,
+ * which the controller latches at the next vertical blank, so a flip never
+ * lands mid-scan. Framebuffer_OnVsync(), called from the LCDIFv2 vertical
+ * blank interrupt, retires the buffer that just went off screen and wakes a
+ * renderer waiting for it on task notification index
+ * FRAMEBUFFER_NOTIFY_INDEX. If no vsync arrives for FRAMEBUFFER_FLIP_TIMEOUT_MS
+ * the flip is assumed to have happened, so a missing hook costs tearing, not a
+ * hang.
+ *
+ * Acquire reports the buffer age like EGL_EXT_buffer_age: 2 with double
+ * buffering means copying the previous frame's dirty region from
+ * Framebuffer_Front() (DirtyRegion_CopyRects) brings it up to date; any other
+ * value needs a full repaint.
+ *
+ * "fb" on the console prints flips, present->flip latency and how long the
+ * renderer waited for a buffer. "fb tear on" lets the renderer draw into the
+ * buffer being scanned out whenever none is free, the single-buffer
+ * behaviour, and reports the scan line it started at; "fb tear off" goes back
+ * to synchronised flips.
+ */
+
+#ifndef FRAMEBUFFER_MAX_LAYERS
+#define FRAMEBUFFER_MAX_LAYERS 4
+#endif
+
+/* Buffers of the panel layer, 2 or 3. */
+#ifndef FRAMEBUFFER_COUNT
+#define FRAMEBUFFER_COUNT 2
+#endif
+
+/* Buffer start and line pitch alignment: LCDIF burst, VGLite requirement. */
+#ifndef FRAMEBUFFER_ALIGN
+#define FRAMEBUFFER_ALIGN 64U
+#endif
+
+/* Must match armgcc/mem_regions.ld. */
+#ifndef FRAMEBUFFER_SDRAM_POOL_SIZE
+#define FRAMEBUFFER_SDRAM_POOL_SIZE (16 * 1024 * 1024)
+#endif
+
+#ifndef FRAMEBUFFER_OCRAM_POOL_SIZE
+#define FRAMEBUFFER_OCRAM_POOL_SIZE (256 * 1024)
+#endif
+
+/* SDRAM row size (512 columns x 16 bit) and bank count. */
+#ifndef FRAMEBUFFER_SDRAM_PAGE_BYTES
+#define FRAMEBUFFER_SDRAM_PAGE_BYTES 1024U
+#endif
+
+#ifndef FRAMEBUFFER_SDRAM_BANKS
+#define FRAMEBUFFER_SDRAM_BANKS 4U
+#endif
+
+/* Free task notification slot (I2C_BUS_NOTIFY_INDEX is 1). */
+#ifndef FRAMEBUFFER_NOTIFY_INDEX
+#define FRAMEBUFFER_NOTIFY_INDEX 2
+#endif
+
+#ifndef FRAMEBUFFER_FLIP_TIMEOUT_MS
+#define FRAMEBUFFER_FLIP_TIMEOUT_MS 50
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Render thread. Returns the buffer to draw the next frame of layer into and
+   its age (see above), or NULL if the layer is not configured. Blocks while
+   no buffer is free. */
+void *Framebuffer_Acquire(uint32_t layer, uint32_t *age);
+
+/* Render thread. Queues the acquired buffer for the next vsync; rects are the
+   pixels drawn by the CPU this frame (count 0 cleans the whole buffer). */
+void Framebuffer_Present(uint32_t layer, const DirtyRect *rects, uint32_t count);
+
+/* Render thread. Hands the acquired buffer of layer to a present that runs
+   later (gpu_pipeline.h) and returns its index, -1 if none is acquired.
+   Until Framebuffer_PresentBuffer() has presented it, acquiring the layer
+   again is an error (configASSERT). */
+int32_t Framebuffer_Hold(uint32_t layer);
+
+/* Render thread. Framebuffer_Present() of buffer, as returned by
+   Framebuffer_Hold(); does nothing if it is no longer the acquired one. */
+void Framebuffer_PresentBuffer(uint32_t layer, int32_t buffer, const DirtyRect *rects, uint32_t count);
+
+/* The buffer most recently presented, the source for partial copies. */
+const void *Framebuffer_Front(uint32_t layer);
+
+/* LCDIFv2 vertical blank ISR, at or below the syscall interrupt priority,
+   before FrameLoop_NotifyVsync(). */
+void Framebuffer_OnVsync(void);
+
+#ifdef __cplusplus
+}
+
+enum class PixelFormat : uint8_t { Rgb565, Argb4444, Argb8888 };
+
+enum class FramebufferPlacement : uint8_t { Sdram, Ocram };
+
+struct FramebufferLayerConfig {
+  uint16_t width;
+  uint16_t height;
+  PixelFormat format;
+  uint8_t buffers; // 1 (static, drawn in place) to 3
+  FramebufferPlacement placement;
+  uint8_t sdramBank; // bank rotation of the first buffer, Sdram only
+};
+
+struct FramebufferStats {
+  uint32_t presents;
+  uint32_t flips;
+  uint32_t replaced;      // triple buffering: frames superseded before a flip
+  uint32_t flipTimeouts;  // flips assumed without a vsync
+  uint32_t vsyncs;
+  uint32_t vsyncPeriodUs;
+  uint32_t latencyAvgUs;  // present -> latched at vsync
+  uint32_t latencyMaxUs;
+  uint32_t waits;         // acquires that had to wait for a flip
+  uint32_t waitAvgUs;
+  uint32_t waitMaxUs;
+  uint32_t tears;         // frames drawn into the scanned-out buffer
+  uint16_t tearLineLast;
+  uint16_t tearLineMin;
+  uint16_t tearLineMax;
+};
+
+// Configures layer 0 as the panel-sized FRAMEBUFFER_COUNT buffer chain in
+// SDRAM, unless display_layers.h composes the screen, and registers the
+// "fb" console command. Call from main() before the scheduler starts.
+void Framebuffer_Init();
+
+// Allocates the buffers of a layer and programs its pitch, format and first
+// buffer into the LCDIFv2. Layers are configured once; returns false if the
+// layer already is, or the pool has no room.
+bool Framebuffer_ConfigureLayer(uint32_t layer, const FramebufferLayerConfig &config);
+
+// Line pitch in bytes, 0 for a layer that is not configured.
+uint32_t Framebuffer_Stride(uint32_t layer);
+
+void Framebuffer_GetStats(uint32_t layer, FramebufferStats &out);
+void Framebuffer_ResetStats();
+
+// true lets the renderer draw into the displayed buffer instead of waiting.
+void Framebuffer_SetTearing(bool on);
+#endif
+
+#endif /* FRAMEBUFFER_H */
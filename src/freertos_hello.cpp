@@ -10,24 +10,81 @@
 #include <string>
 #include <task.h>
 
+#include "asset_manifest.h"
+#include "blit_engine.h"
+#include "boot_trace.h"
 #include "bredge/messager.h"
+#include "debug_console.h"
+#include "dirty_region.h"
+#include "display_layers.h"
+#include "frame_arena.h"
+#include "frame_loop.h"
+#include "frame_timing.h"
+#include "framebuffer.h"
+#include "glyph_cache.h"
+#include "gpu_pipeline.h"
+#include "heap_monitor.h"
+#include "i2c_bus.h"
+#include "image_cache.h"
+#include "mem_region.h"
+#include "preload.h"
+#include "profiler.h"
+#include "runtime_stats.h"
+#include "signal_bridge.h"
+#include "static_alloc.h"
+#include "tickless_idle.h"
+#include "touch_gt911.h"
 #include <board.h>
 
 static void Qul_Thread(void *argument);
 static void TestApp_Thread(void *argument);
+static void Preload_Thread(void *argument);
+
+// With APP_STATIC_ALLOCATION the task stacks take 160 KB of DTCM, the DTCM
+// heap arena another 64 KB; mem_regions.ld checks the total against 256 KB.
+static TaskStorage<32768> s_qulTask APP_STATIC_STORAGE;
+static TaskStorage<4096> s_testAppTask APP_STATIC_STORAGE;
+static TaskStorage<PRELOAD_STACK_DEPTH> s_preloadTask APP_STATIC_STORAGE;
 
 int main() {
   Qul::initHardware();
   Qul::initPlatform();
-  if (xTaskCreate(Qul_Thread, "Qul_Thread", 32768, 0, 4, 0) != pdPASS) {
+  MemRegion_Init();
+  BootTrace_Init();
+  TicklessIdle_Init();
+  I2cBus_Init();
+  if (s_qulTask.create(Qul_Thread, "Qul_Thread", 0, 4) != pdPASS) {
     Qul::PlatformInterface::log("Task creation failed!.\r\n");
     configASSERT(false);
   }
 
-  if (xTaskCreate(TestApp_Thread, "TestApp_Thread", 4096, 0, 3, 0) != pdPASS) {
+  if (s_testAppTask.create(TestApp_Thread, "TestApp_Thread", 0, 3) != pdPASS) {
     Qul::PlatformInterface::log("Task creation failed!.\r\n");
     configASSERT(false);
   };
+
+  if (s_preloadTask.create(Preload_Thread, "Preload_Thread", 0, PRELOAD_TASK_PRIORITY) != pdPASS) {
+    Qul::PlatformInterface::log("Task creation failed!.\r\n");
+    configASSERT(false);
+  }
+  DebugConsole_Start(1);
+  HeapMonitor_Start(1);
+  RunTimeStats_Start(1);
+  Profiler_Init();
+  FrameTiming_Init();
+  DirtyRegion_Init();
+  Framebuffer_Init();
+#if APP_DISPLAY_LAYERS
+  (void)DisplayLayers_Init();
+#endif
+  GpuPipeline_Init();
+  Blit_Init();
+  ImageCache_Init();
+  GlyphCache_Init();
+  AssetManifest_Register();
+  Preload_Init();
+  FrameLoop_Init();
+  BootTrace_Mark(BootMark::Scheduler);
   vTaskStartScheduler();
 
   // Should not reach this point
@@ -37,23 +94,35 @@ static void TestApp_Thread(void *argument) {
   static uint8_t i = 0;
   while (true) {
     i++;
-    Msg_SendToUI(Message::GEAR, i);
+    SignalBridge_Publish(Message::GEAR, i);
     vTaskDelay(500);
   }
 }
+static void Preload_Thread(void *argument) {
+  (void)argument;
+  Preload_Run();
+  vTaskDelete(NULL);
+}
 static void Qul_Thread(void *argument) {
   (void)argument;
+  BootTrace_Mark(BootMark::QulThread);
+  FrameArena_Init();
   Qul::Application _qul_app;
   static struct ::MCUCluser _qul_item;
   _qul_app.setRootItem(&_qul_item);
+  ImageCache_Register(_qul_app);
 #ifdef APP_DEFAULT_UILANGUAGE
   _qul_app.settings().uiLanguage.setValue(APP_DEFAULT_UILANGUAGE);
 #endif
-  _qul_app.exec();
-  // while (true) {
-  //   _qul_app.update();
-  //   vTaskDelay(10);
-  // }
+#if APP_TOUCH_IRQ
+  if (!Touch_Init()) {
+    Qul::PlatformInterface::log("Touch init failed!.\r\n");
+  }
+#endif
+  // Producers never touch the UI directly; the frame loop picks up their
+  // updates once per frame on this thread and retires the previous frame's
+  // transient allocations.
+  FrameLoop_Run(_qul_app);
 }
 
 extern "C" {
@@ -0,0 +1,213 @@
+#include "glyph_atlas.h"
+
+#include <string.h>
+
+static_assert(GLYPH_ATLAS_MAX_GLYPHS <= 32767, "chains are int16_t");
+static_assert(GLYPH_ATLAS_MAX_SHELVES <= 255, "shelves are uint8_t");
+
+void GlyphAtlas::init(uint8_t *pixels, uint16_t width, uint16_t height, uint32_t pitch) {
+  *this = GlyphAtlas();
+  pixels_ = pixels;
+  width_ = width;
+  height_ = height;
+  pitch_ = pitch;
+  memset(buckets_, 0xFF, sizeof(buckets_));
+  for (uint16_t y = 0; y < height; y++) {
+    memset(pixels + y * pitch, 0, width);
+  }
+}
+
+uint32_t GlyphAtlas::hash(const GlyphKey &key) {
+  const uint32_t h = ((uint32_t)key.font << 16 | key.size) * 0x9E3779B1U ^ key.glyph * 0x85EBCA6BU;
+  return (h ^ h >> 16) % Buckets;
+}
+
+int GlyphAtlas::lookup(const GlyphKey &key) const {
+  for (int i = buckets_[hash(key)]; i >= 0; i = entries_[i].next) {
+    const GlyphKey &k = entries_[i].key;
+    if (k.glyph == key.glyph && k.font == key.font && k.size == key.size) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const GlyphSlot *GlyphAtlas::find(const GlyphKey &key) {
+  const int i = lookup(key);
+  if (i < 0) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  shelves_[entries_[i].shelf].lastUse = frame_;
+  return &entries_[i].slot;
+}
+
+bool GlyphAtlas::evictable(const Shelf &shelf) const { return !shelf.pinned && shelf.lastUse + 1U < frame_; }
+
+void GlyphAtlas::unlinkEntry(int index) {
+  Entry &e = entries_[index];
+  int16_t *link = &buckets_[hash(e.key)];
+  while (*link != index) {
+    link = &entries_[*link].next;
+  }
+  *link = e.next;
+  e.used = false;
+  glyphs_--;
+  glyphPixels_ -= (uint32_t)e.slot.width * e.slot.height;
+}
+
+void GlyphAtlas::emptyShelf(int shelf) {
+  Shelf &s = shelves_[shelf];
+  if (s.glyphs != 0U) {
+    for (int i = 0; i < GLYPH_ATLAS_MAX_GLYPHS; i++) {
+      if (entries_[i].used && entries_[i].shelf == shelf) {
+        unlinkEntry(i);
+        evictedGlyphs_++;
+      }
+    }
+    for (uint16_t y = 0; y < s.height; y++) {
+      memset(pixels_ + (s.y + y) * pitch_, 0, s.used);
+    }
+  }
+  s.used = 0;
+  s.glyphs = 0;
+}
+
+// Shelf with room for a width-wide glyph of class height, or -1.
+int GlyphAtlas::takeShelf(uint16_t height, uint16_t width, bool pinned) {
+  // A shelf of this class with room left.
+  for (uint32_t i = 0; i < shelfCount_; i++) {
+    const Shelf &s = shelves_[i];
+    if (s.height == height && s.pinned == pinned && s.glyphs != 0U && s.used + width <= width_) {
+      return (int)i;
+    }
+  }
+  // Unclaimed space.
+  if (shelfCount_ < GLYPH_ATLAS_MAX_SHELVES && nextY_ + height <= height_) {
+    Shelf &s = shelves_[shelfCount_];
+    s = Shelf();
+    s.y = nextY_;
+    s.height = height;
+    nextY_ += height;
+    return (int)shelfCount_++;
+  }
+  // An empty shelf, or else the least recently used one, at least as tall;
+  // among equals the one that wastes the fewest rows.
+  int best = -1;
+  for (uint32_t i = 0; i < shelfCount_; i++) {
+    const Shelf &s = shelves_[i];
+    if (s.height < height || (s.glyphs != 0U && !evictable(s))) {
+      continue;
+    }
+    if (best < 0) {
+      best = (int)i;
+      continue;
+    }
+    const Shelf &b = shelves_[best];
+    const bool emptier = (s.glyphs == 0U) != (b.glyphs == 0U) ? s.glyphs == 0U : false;
+    const bool older = s.glyphs != 0U && b.glyphs != 0U && s.lastUse < b.lastUse;
+    const bool tighter = (s.glyphs == 0U) == (b.glyphs == 0U) && s.lastUse == b.lastUse && s.height < b.height;
+    if (emptier || older || tighter) {
+      best = (int)i;
+    }
+  }
+  if (best >= 0) {
+    if (shelves_[best].glyphs != 0U) {
+      evictedShelves_++;
+    }
+    emptyShelf(best);
+  }
+  return best;
+}
+
+const GlyphSlot *GlyphAtlas::insert(const GlyphKey &key, const uint8_t *alpha, uint32_t pitch, const GlyphSlot &metrics,
+                                    bool pinned) {
+  const uint32_t width = metrics.width + GLYPH_ATLAS_GUTTER;
+  const uint32_t rows = metrics.height + GLYPH_ATLAS_GUTTER;
+  const uint32_t height = (rows + GLYPH_ATLAS_SHELF_STEP - 1U) / GLYPH_ATLAS_SHELF_STEP * GLYPH_ATLAS_SHELF_STEP;
+  int index = -1;
+  for (int i = 0; i < GLYPH_ATLAS_MAX_GLYPHS; i++) {
+    if (!entries_[i].used) {
+      index = i;
+      break;
+    }
+  }
+  const int shelf = index >= 0 && width + GLYPH_ATLAS_GUTTER <= width_ && height <= height_
+                        ? takeShelf((uint16_t)height, (uint16_t)width, pinned)
+                        : -1;
+  if (shelf < 0) {
+    rejected_++;
+    return nullptr;
+  }
+
+  Shelf &s = shelves_[shelf];
+  s.pinned = pinned;
+  s.lastUse = frame_;
+  Entry &e = entries_[index];
+  e.key = key;
+  e.slot = metrics;
+  // The gutter sits above and left of every glyph; the shelf's first column
+  // and row stay clear.
+  e.slot.x = (uint16_t)(s.used + GLYPH_ATLAS_GUTTER);
+  e.slot.y = (uint16_t)(s.y + GLYPH_ATLAS_GUTTER);
+  e.shelf = (uint8_t)shelf;
+  e.used = true;
+  const uint32_t bucket = hash(key);
+  e.next = buckets_[bucket];
+  buckets_[bucket] = (int16_t)index;
+  for (uint32_t y = 0; y < metrics.height; y++) {
+    memcpy(pixels_ + (e.slot.y + y) * pitch_ + e.slot.x, alpha + y * pitch, metrics.width);
+  }
+  s.used = (uint16_t)(s.used + width);
+  s.glyphs++;
+  glyphs_++;
+  glyphPixels_ += (uint32_t)metrics.width * metrics.height;
+  inserts_++;
+  return &e.slot;
+}
+
+void GlyphAtlas::clear(bool pinnedToo) {
+  for (uint32_t i = 0; i < shelfCount_; i++) {
+    Shelf &s = shelves_[i];
+    if (s.glyphs != 0U && (pinnedToo ? s.lastUse + 1U < frame_ : evictable(s))) {
+      evictedShelves_++;
+      emptyShelf((int)i);
+      s.pinned = false;
+    }
+  }
+}
+
+void GlyphAtlas::stats(GlyphAtlasStats &out) const {
+  out = GlyphAtlasStats();
+  out.hits = hits_;
+  out.misses = misses_;
+  out.inserts = inserts_;
+  out.rejected = rejected_;
+  out.evictedShelves = evictedShelves_;
+  out.evictedGlyphs = evictedGlyphs_;
+  out.glyphs = glyphs_;
+  out.glyphPixels = glyphPixels_;
+  out.totalPixels = (uint32_t)width_ * height_;
+  for (uint32_t i = 0; i < shelfCount_; i++) {
+    const Shelf &s = shelves_[i];
+    if (s.glyphs == 0U) {
+      continue;
+    }
+    out.shelves++;
+    out.shelfPixels += (uint32_t)width_ * s.height;
+    if (s.pinned) {
+      out.pinnedShelves++;
+      out.pinnedGlyphs += s.glyphs;
+    }
+  }
+}
+
+void GlyphAtlas::resetStats() {
+  hits_ = 0;
+  misses_ = 0;
+  inserts_ = 0;
+  rejected_ = 0;
+  evictedShelves_ = 0;
+  evictedGlyphs_ = 0;
+}
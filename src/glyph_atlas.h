@@ -0,0 +1,146 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <stdint.h>
+
+// Glyph alpha maps packed into one A8 texture.
+//
+// The atlas is cut into horizontal shelves, each as tall as the glyphs it
+// holds rounded up to GLYPH_ATLAS_SHELF_STEP rows, and glyphs are placed left
+// to right along a shelf with a GLYPH_ATLAS_GUTTER of transparent pixels
+// around them, so filtered sampling never bleeds between neighbours.
+// Eviction works on whole shelves, least recently used first: a shelf is
+// cleared and reused for any glyph class that fits in it. Pinned glyphs get
+// shelves of their own, which are never evicted.
+//
+// The renderer may still be reading the previous frame's glyphs (one frame in
+// flight, gpu_pipeline.h), so shelves used in the current or the previous
+// frame (tick()) are not evicted either; an insert that would need one fails
+// and the caller draws that glyph uncached.
+//
+// Not thread safe; portable, so it builds on the host as well.
+
+#ifndef GLYPH_ATLAS_MAX_GLYPHS
+#define GLYPH_ATLAS_MAX_GLYPHS 512
+#endif
+
+#ifndef GLYPH_ATLAS_MAX_SHELVES
+#define GLYPH_ATLAS_MAX_SHELVES 64
+#endif
+
+#ifndef GLYPH_ATLAS_SHELF_STEP
+#define GLYPH_ATLAS_SHELF_STEP 4
+#endif
+
+#ifndef GLYPH_ATLAS_GUTTER
+#define GLYPH_ATLAS_GUTTER 1
+#endif
+
+struct GlyphKey {
+  uint16_t font;
+  uint16_t size; // pixels
+  uint32_t glyph;
+};
+
+struct GlyphSlot {
+  uint16_t x; // in the atlas
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+  int16_t bearingX;
+  int16_t bearingY;
+  uint16_t advance;
+};
+
+struct GlyphAtlasStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t inserts;
+  uint32_t rejected;
+  uint32_t evictedShelves;
+  uint32_t evictedGlyphs;
+  uint32_t glyphs;
+  uint32_t pinnedGlyphs;
+  uint32_t shelves;
+  uint32_t pinnedShelves;
+  uint32_t glyphPixels;  // covered by glyphs
+  uint32_t shelfPixels;  // handed out to shelves
+  uint32_t totalPixels;
+};
+
+class GlyphAtlas {
+public:
+  // pixels: width x height A8, pitch bytes per row; cleared here.
+  void init(uint8_t *pixels, uint16_t width, uint16_t height, uint32_t pitch);
+
+  // Slot of key, or nullptr. Counts a hit or a miss.
+  const GlyphSlot *find(const GlyphKey &key);
+
+  // Whether key is in the atlas; neither counted nor a use.
+  bool contains(const GlyphKey &key) const { return lookup(key) >= 0; }
+
+  // Copies a width x height alpha map (metrics.x and .y are ignored) into
+  // the atlas. nullptr if there is no room it may take.
+  const GlyphSlot *insert(const GlyphKey &key, const uint8_t *alpha, uint32_t pitch, const GlyphSlot &metrics,
+                          bool pinned);
+
+  // Once per frame, after the frame's last find().
+  void tick() { frame_++; }
+
+  // Empties every shelf that may be evicted now, or only pinned ones too.
+  void clear(bool pinnedToo);
+
+  const uint8_t *pixels() const { return pixels_; }
+  uint32_t pitch() const { return pitch_; }
+
+  void stats(GlyphAtlasStats &out) const;
+  void resetStats();
+
+private:
+  struct Shelf {
+    uint16_t y;
+    uint16_t height;
+    uint16_t used; // x of the next glyph
+    uint16_t glyphs;
+    uint32_t lastUse;
+    bool pinned;
+  };
+
+  struct Entry {
+    GlyphKey key;
+    GlyphSlot slot;
+    int16_t next; // hash chain
+    uint8_t shelf;
+    bool used;
+  };
+
+  static const uint32_t Buckets = 256;
+
+  static uint32_t hash(const GlyphKey &key);
+  int lookup(const GlyphKey &key) const;
+  bool evictable(const Shelf &shelf) const;
+  int takeShelf(uint16_t height, uint16_t width, bool pinned);
+  void emptyShelf(int shelf);
+  void unlinkEntry(int index);
+
+  uint8_t *pixels_ = nullptr;
+  uint32_t pitch_ = 0;
+  uint16_t width_ = 0;
+  uint16_t height_ = 0;
+  uint16_t nextY_ = 0; // top of the space no shelf has claimed yet
+  uint32_t frame_ = 2;
+  Shelf shelves_[GLYPH_ATLAS_MAX_SHELVES] = {};
+  uint32_t shelfCount_ = 0;
+  Entry entries_[GLYPH_ATLAS_MAX_GLYPHS] = {};
+  int16_t buckets_[Buckets] = {};
+  uint32_t glyphs_ = 0;
+  uint32_t glyphPixels_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t inserts_ = 0;
+  uint32_t rejected_ = 0;
+  uint32_t evictedShelves_ = 0;
+  uint32_t evictedGlyphs_ = 0;
+};
+
+#endif // GLYPH_ATLAS_H
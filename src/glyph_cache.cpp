@@ -0,0 +1,336 @@
+#include "glyph_cache.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "digit_atlas.h"
+#include "glyph_atlas.h"
+
+static_assert(GLYPH_CACHE_ATLAS_WIDTH * GLYPH_CACHE_ATLAS_HEIGHT <= GLYPH_CACHE_POOL_SIZE,
+              "atlas does not fit into its window");
+
+// Atlas window reserved in armgcc/mem_regions.ld.
+extern "C" uint8_t __glyph_atlas_start[];
+
+struct PrewarmRequest {
+  uint16_t font;
+  uint16_t size;
+  const char *text;
+  bool pin;
+};
+
+// Qul thread only; the console reads the counters under vTaskSuspendAll.
+static GlyphAtlas s_atlas;
+static GlyphRasterFn s_raster;
+static PrewarmRequest s_pending[GLYPH_CACHE_MAX_PREWARM];
+static uint32_t s_pendingCount;
+static struct {
+  uint32_t flashHits;
+  uint32_t uncached;
+  uint32_t prewarmed;
+  uint32_t rasterizes;
+  uint64_t cycles;
+  uint32_t cyclesMax;
+  uint32_t churn;
+  uint32_t churnMax;
+  uint32_t windowEvicted; // evicted glyphs when the churn window opened
+  TickType_t windowStart;
+} s_totals;
+
+static std::atomic<bool> s_clear{false};
+static std::atomic<bool> s_verify{false};
+
+// Bit i: DigitAtlas_Sets[i] has the rasterizer's metrics for every glyph and
+// its pixels within DIGIT_ATLAS_MAX_PIXEL_DIFF, so it can stand in for it. Set by verifyFlash(); sets past the 32nd are never
+// drawn from flash.
+static uint32_t s_flashVerified;
+
+static bool rasterize(const GlyphKey &key, GlyphBitmap &out) {
+  const uint32_t start = CycleCounter_Read();
+  const bool ok = s_raster(key.font, key.size, key.glyph, &out);
+  const uint32_t cycles = CycleCounter_Read() - start;
+  s_totals.rasterizes++;
+  s_totals.cycles += cycles;
+  s_totals.cyclesMax = cycles > s_totals.cyclesMax ? cycles : s_totals.cyclesMax;
+  return ok;
+}
+
+static void fromSlot(const GlyphSlot &slot, GlyphBitmap &out) {
+  out.alpha = s_atlas.pixels() + slot.y * s_atlas.pitch() + slot.x;
+  out.pitch = s_atlas.pitch();
+  out.width = slot.width;
+  out.height = slot.height;
+  out.bearingX = slot.bearingX;
+  out.bearingY = slot.bearingY;
+  out.advance = slot.advance;
+  out.x = slot.x;
+  out.y = slot.y;
+  out.cached = true;
+  out.flash = false;
+}
+
+// Rasterizes key into the atlas; out is the atlas copy, or the rasterizer's
+// bitmap if it did not fit.
+static bool load(const GlyphKey &key, bool pin, GlyphBitmap &out) {
+  if (!rasterize(key, out)) {
+    return false;
+  }
+  GlyphSlot metrics = {};
+  metrics.width = out.width;
+  metrics.height = out.height;
+  metrics.bearingX = out.bearingX;
+  metrics.bearingY = out.bearingY;
+  metrics.advance = out.advance;
+  const GlyphSlot *slot = s_atlas.insert(key, out.alpha, out.pitch, metrics, pin);
+  if (slot == nullptr) {
+    s_totals.uncached++;
+    out.cached = false;
+    out.flash = false;
+    return true;
+  }
+  // VGLite reads behind the data cache; the rows include the gutter, which
+  // an eviction may just have cleared.
+  const uint32_t top = slot->y >= GLYPH_ATLAS_GUTTER ? slot->y - GLYPH_ATLAS_GUTTER : 0U;
+  SCB_CleanDCache_by_Addr(__glyph_atlas_start + top * s_atlas.pitch(),
+                          (int32_t)((slot->y + slot->height - top) * s_atlas.pitch()));
+  fromSlot(*slot, out);
+  return true;
+}
+
+static bool fromFlash(uint16_t font, uint16_t size, uint32_t glyph, GlyphBitmap &out) {
+  const DigitAtlasSet *set = DigitAtlas_FindSet(font, size);
+  const uint32_t index = set != nullptr ? (uint32_t)(set - DigitAtlas_Sets) : 32U;
+  if (index >= 32U || (s_flashVerified & (1U << index)) == 0U) {
+    return false;
+  }
+  const DigitAtlasGlyph *g = DigitAtlas_FindGlyph(*set, glyph);
+  if (g == nullptr) {
+    return false;
+  }
+  out.alpha = set->pixels + g->y * set->pitch + g->x;
+  out.pitch = set->pitch;
+  out.width = g->width;
+  out.height = g->height;
+  out.bearingX = g->bearingX;
+  out.bearingY = g->bearingY;
+  out.advance = g->advance;
+  out.x = g->x;
+  out.y = g->y;
+  out.cached = false;
+  out.flash = true;
+  return true;
+}
+
+extern "C" bool GlyphCache_Get(uint16_t font, uint16_t size, uint32_t glyph, GlyphBitmap *out) {
+  if (s_flashVerified != 0U && fromFlash(font, size, glyph, *out)) {
+    s_totals.flashHits++;
+    return true;
+  }
+  const GlyphKey key = {font, size, glyph};
+  const GlyphSlot *slot = s_atlas.find(key);
+  if (slot != nullptr) {
+    fromSlot(*slot, *out);
+    return true;
+  }
+  return s_raster != nullptr && load(key, false, *out);
+}
+
+extern "C" const uint8_t *GlyphCache_Atlas(uint32_t *pitch) {
+  *pitch = s_atlas.pitch();
+  return s_atlas.pixels();
+}
+
+static bool prewarm(const PrewarmRequest &request) {
+  bool ok = true;
+  for (const char *c = request.text; *c != '\0'; c++) {
+    const GlyphKey key = {request.font, request.size, (uint8_t)*c};
+    GlyphBitmap bitmap;
+    if (s_atlas.contains(key) || fromFlash(key.font, key.size, key.glyph, bitmap)) {
+      continue;
+    }
+    if (!load(key, request.pin, bitmap) || !bitmap.cached) {
+      ok = false;
+      continue;
+    }
+    s_totals.prewarmed++;
+  }
+  return ok;
+}
+
+// Compares every flash glyph with what the rasterizer makes of it and lets
+// GlyphCache_Get() serve a set only if all of its metrics match and its
+// pixels are within DIGIT_ATLAS_MAX_PIXEL_DIFF.
+static void verifyFlash() {
+  if (s_raster == nullptr) {
+    Qul::PlatformInterface::log("No rasterizer to verify against\r\n");
+    return;
+  }
+  s_flashVerified = 0;
+  for (uint32_t i = 0; i < DigitAtlas_SetCount; i++) {
+    const DigitAtlasSet &set = DigitAtlas_Sets[i];
+    uint32_t sameMetrics = 0;
+    uint32_t differing = 0;
+    uint32_t compared = 0;
+    uint32_t maxDiff = 0;
+    for (uint32_t j = 0; j < set.glyphCount; j++) {
+      const DigitAtlasGlyph &g = set.glyphs[j];
+      GlyphBitmap bitmap;
+      if (!s_raster(set.font, set.size, g.glyph, &bitmap) || bitmap.width != g.width ||
+          bitmap.height != g.height || bitmap.bearingX != g.bearingX || bitmap.bearingY != g.bearingY ||
+          bitmap.advance != g.advance) {
+        continue;
+      }
+      sameMetrics++;
+      for (uint32_t y = 0; y < g.height; y++) {
+        const uint8_t *flash = set.pixels + (g.y + y) * set.pitch + g.x;
+        const uint8_t *raster = bitmap.alpha + y * bitmap.pitch;
+        for (uint32_t x = 0; x < g.width; x++) {
+          const uint32_t diff = flash[x] > raster[x] ? flash[x] - raster[x] : raster[x] - flash[x];
+          differing += diff != 0U ? 1U : 0U;
+          maxDiff = diff > maxDiff ? diff : maxDiff;
+        }
+      }
+      compared += (uint32_t)g.width * g.height;
+    }
+    const bool match = sameMetrics == set.glyphCount && maxDiff <= DIGIT_ATLAS_MAX_PIXEL_DIFF && i < 32U;
+    if (match) {
+      s_flashVerified |= 1U << i;
+    }
+    Qul::PlatformInterface::log("Font %u, %u px: %u of %u glyphs with the same metrics, %u%% of their pixels "
+                                "differ, by up to %u; %s\r\n",
+                                (unsigned)set.font, (unsigned)set.size, (unsigned)sameMetrics,
+                                (unsigned)set.glyphCount,
+                                compared != 0U ? (unsigned)(differing * 100ULL / compared) : 0U, (unsigned)maxDiff,
+                                match ? "drawn from flash" : "not used");
+  }
+}
+
+extern "C" void GlyphCache_SetRasterizer(GlyphRasterFn raster) {
+  s_raster = raster;
+  if (DigitAtlas_SetCount != 0U) {
+    verifyFlash();
+  }
+  for (uint32_t i = 0; i < s_pendingCount; i++) {
+    if (!prewarm(s_pending[i])) {
+      Qul::PlatformInterface::log("Prewarming \"%s\" at %u px did not fit\r\n", s_pending[i].text,
+                                  (unsigned)s_pending[i].size);
+    }
+  }
+  s_pendingCount = 0;
+}
+
+bool GlyphCache_Prewarm(uint16_t font, uint16_t size, const char *text, bool pin) {
+  const PrewarmRequest request = {font, size, text, pin};
+  if (s_raster != nullptr) {
+    return prewarm(request);
+  }
+  if (s_pendingCount == GLYPH_CACHE_MAX_PREWARM) {
+    return false;
+  }
+  s_pending[s_pendingCount++] = request;
+  return true;
+}
+
+void GlyphCache_EndFrame() {
+  if (s_clear.exchange(false, std::memory_order_relaxed)) {
+    s_atlas.clear(false);
+  }
+  if (s_verify.exchange(false, std::memory_order_relaxed)) {
+    verifyFlash();
+  }
+  s_atlas.tick();
+
+  const TickType_t now = xTaskGetTickCount();
+  if (now - s_totals.windowStart >= pdMS_TO_TICKS(1000)) {
+    GlyphAtlasStats stats;
+    s_atlas.stats(stats);
+    s_totals.churn = stats.evictedGlyphs - s_totals.windowEvicted;
+    s_totals.churnMax = s_totals.churn > s_totals.churnMax ? s_totals.churn : s_totals.churnMax;
+    s_totals.windowEvicted = stats.evictedGlyphs;
+    s_totals.windowStart = now;
+  }
+}
+
+void GlyphCache_GetStats(GlyphCacheStats &out) {
+  GlyphAtlasStats atlas;
+  vTaskSuspendAll();
+  s_atlas.stats(atlas);
+  out.flashHits = s_totals.flashHits;
+  out.uncached = s_totals.uncached;
+  out.prewarmed = s_totals.prewarmed;
+  out.churnPerSec = s_totals.churn;
+  out.churnMaxPerSec = s_totals.churnMax;
+  const uint32_t rasterizes = s_totals.rasterizes;
+  const uint64_t cycles = s_totals.cycles;
+  const uint32_t cyclesMax = s_totals.cyclesMax;
+  (void)xTaskResumeAll();
+
+  out.hits = atlas.hits;
+  out.misses = atlas.misses;
+  out.evictedGlyphs = atlas.evictedGlyphs;
+  out.evictedShelves = atlas.evictedShelves;
+  out.glyphs = atlas.glyphs;
+  out.pinnedGlyphs = atlas.pinnedGlyphs;
+  out.shelves = atlas.shelves;
+  out.occupancyPercent = (uint32_t)(atlas.glyphPixels * 100ULL / atlas.totalPixels);
+  out.shelfPercent = (uint32_t)(atlas.shelfPixels * 100ULL / atlas.totalPixels);
+  out.rasterizeAvgUs = rasterizes != 0U ? CycleCounter_ToUs((uint32_t)(cycles / rasterizes)) : 0U;
+  out.rasterizeMaxUs = CycleCounter_ToUs(cyclesMax);
+}
+
+void GlyphCache_ResetStats() {
+  vTaskSuspendAll();
+  s_atlas.resetStats();
+  GlyphAtlasStats atlas;
+  s_atlas.stats(atlas);
+  s_totals.flashHits = 0;
+  s_totals.uncached = 0;
+  s_totals.rasterizes = 0;
+  s_totals.cycles = 0;
+  s_totals.cyclesMax = 0;
+  s_totals.churn = 0;
+  s_totals.churnMax = 0;
+  s_totals.windowEvicted = atlas.evictedGlyphs;
+  (void)xTaskResumeAll();
+}
+
+static void glyphsCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    GlyphCache_ResetStats();
+  } else if (DebugConsole_ArgIs(args, "clear")) {
+    s_clear.store(true, std::memory_order_relaxed);
+  } else if (DebugConsole_ArgIs(args, "verify")) {
+    s_verify.store(true, std::memory_order_relaxed);
+  }
+  GlyphCacheStats stats;
+  GlyphCache_GetStats(stats);
+  const uint32_t lookups = stats.hits + stats.misses;
+  Qul::PlatformInterface::log("Glyph atlas %ux%u: %u%% covered by glyphs, %u%% claimed by %u shelves\r\n",
+                              (unsigned)GLYPH_CACHE_ATLAS_WIDTH, (unsigned)GLYPH_CACHE_ATLAS_HEIGHT,
+                              (unsigned)stats.occupancyPercent, (unsigned)stats.shelfPercent,
+                              (unsigned)stats.shelves);
+  Qul::PlatformInterface::log("  %u glyphs, %u pinned, %u prewarmed%s\r\n", (unsigned)stats.glyphs,
+                              (unsigned)stats.pinnedGlyphs, (unsigned)stats.prewarmed,
+                              s_raster == nullptr ? ", no rasterizer registered" : "");
+  Qul::PlatformInterface::log("  hits %u, misses %u (%u%% hit), drawn uncached %u\r\n", (unsigned)stats.hits,
+                              (unsigned)stats.misses, lookups != 0U ? (unsigned)(stats.hits * 100ULL / lookups) : 0U,
+                              (unsigned)stats.uncached);
+  Qul::PlatformInterface::log("  %u flash sets, %u verified, %u glyphs drawn from flash\r\n",
+                              (unsigned)DigitAtlas_SetCount, (unsigned)__builtin_popcount(s_flashVerified),
+                              (unsigned)stats.flashHits);
+  Qul::PlatformInterface::log("  evicted %u glyphs in %u shelves; churn %u/s, max %u/s\r\n",
+                              (unsigned)stats.evictedGlyphs, (unsigned)stats.evictedShelves,
+                              (unsigned)stats.churnPerSec, (unsigned)stats.churnMaxPerSec);
+  Qul::PlatformInterface::log("  rasterize avg %u us, max %u us\r\n", (unsigned)stats.rasterizeAvgUs,
+                              (unsigned)stats.rasterizeMaxUs);
+}
+
+void GlyphCache_Init() {
+  s_atlas.init(__glyph_atlas_start, GLYPH_CACHE_ATLAS_WIDTH, GLYPH_CACHE_ATLAS_HEIGHT, GLYPH_CACHE_ATLAS_WIDTH);
+  SCB_CleanDCache_by_Addr(__glyph_atlas_start, GLYPH_CACHE_ATLAS_WIDTH * GLYPH_CACHE_ATLAS_HEIGHT);
+  DebugConsole_Register("glyphs", "glyph atlas occupancy and churn [reset|clear|verify]", glyphsCommand);
+}
@@ -0,0 +1,137 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Persistent glyph atlas in SDRAM.
+ *
+ * Qt for MCUs rasterizes text through the Monotype engine into alpha maps
+ * that the platform glue (platform/ generated by qmlprojectexporter) blends
+ * with DrawingEngine::blendAlphaMap(). Qul's own caching is bounded by
+ * QUL_PREPROCESS_CACHE_SIZE, which images share, so the speed and rpm digits,
+ * whose text changes every frame, keep being rasterized and uploaded again.
+ *
+ * This cache holds glyphs in one A8 texture of GLYPH_CACHE_ATLAS_WIDTH x
+ * GLYPH_CACHE_ATLAS_HEIGHT in a NOLOAD SDRAM window of its own
+ * (armgcc/mem_regions.ld), keyed by font, pixel size and glyph
+ * (glyph_atlas.h). The glue registers its Monotype rasterizer with
+ * GlyphCache_SetRasterizer() and asks GlyphCache_Get() for each glyph it
+ * draws: a hit is a rectangle of the atlas, which VGLite samples as a single
+ * source buffer; a miss is rasterized once and copied in. Font ids are
+ * whatever the glue uses to tell Qul's fonts apart, glyphs are code points.
+ *
+ * Glyph sets known at build time come from flash instead (digit_atlas.h):
+ * GlyphCache_Get() returns them with flash set, relative to the set's own
+ * atlas, and never rasterizes them. They are FreeType's rendering, not
+ * Monotype's, so a set is only served once it has been verified against the
+ * registered rasterizer: GlyphCache_SetRasterizer() and "glyphs verify"
+ * compare every glyph, and a set with any glyph whose size, bearing or
+ * advance differs, or any pixel off by more than DIGIT_ATLAS_MAX_PIXEL_DIFF,
+ * is left to the rasterizer. Sets known only at run time, such as
+ * "0123456789" at the sizes of the speed and rpm readouts when
+ * APP_DIGIT_ATLAS is off, are rasterized up front with GlyphCache_Prewarm()
+ * and pinned by default. Monotype is not thread safe, so that happens on the
+ * Qul thread: requests made before the glue registers its rasterizer wait
+ * for it, unlike the preloader's items (preload.h).
+ *
+ * Everything but the console runs on the Qul thread; GlyphCache_EndFrame()
+ * ages the atlas once per frame, from the frame loop.
+ *
+ * "glyphs" on the console prints occupancy, hit rate and eviction churn;
+ * "glyphs reset" clears the counters, "glyphs clear" empties the unpinned
+ * shelves at the end of the next frame and "glyphs verify" compares the
+ * flash glyphs with the rasterizer's output there, which also decides again
+ * which sets are drawn from flash.
+ */
+
+/* Must match armgcc/mem_regions.ld. */
+#ifndef GLYPH_CACHE_POOL_SIZE
+#define GLYPH_CACHE_POOL_SIZE (1024 * 1024)
+#endif
+
+#ifndef GLYPH_CACHE_ATLAS_WIDTH
+#define GLYPH_CACHE_ATLAS_WIDTH 1024
+#endif
+
+#ifndef GLYPH_CACHE_ATLAS_HEIGHT
+#define GLYPH_CACHE_ATLAS_HEIGHT 512
+#endif
+
+#ifndef GLYPH_CACHE_MAX_PREWARM
+#define GLYPH_CACHE_MAX_PREWARM 8
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  const uint8_t *alpha; /* first pixel */
+  uint32_t pitch;       /* bytes per line */
+  uint16_t width;
+  uint16_t height;
+  int16_t bearingX;
+  int16_t bearingY;
+  uint16_t advance;
+  uint16_t x; /* in the atlas, when cached or flash */
+  uint16_t y;
+  bool cached;
+  bool flash; /* from DigitAtlas_FindSet(font, size) */
+} GlyphBitmap;
+
+/* Qul thread. Fills out with an alpha map that stays valid until the next
+   call; x, y, cached and flash are ignored. false if there is no such glyph. */
+typedef bool (*GlyphRasterFn)(uint16_t font, uint16_t size, uint32_t glyph, GlyphBitmap *out);
+
+/* Qul thread, from the glue's initialisation. Runs the pending prewarms. */
+void GlyphCache_SetRasterizer(GlyphRasterFn raster);
+
+/* Qul thread. The glyph from the atlas, or straight from the rasterizer
+   (cached false) when there is no room for it this frame. false if the
+   glyph cannot be rasterized. */
+bool GlyphCache_Get(uint16_t font, uint16_t size, uint32_t glyph, GlyphBitmap *out);
+
+/* The atlas, for wrapping it as an A8 source buffer once. */
+const uint8_t *GlyphCache_Atlas(uint32_t *pitch);
+
+#ifdef __cplusplus
+}
+
+struct GlyphCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t flashHits;
+  uint32_t uncached;       // drawn without a slot
+  uint32_t evictedGlyphs;
+  uint32_t evictedShelves;
+  uint32_t glyphs;
+  uint32_t pinnedGlyphs;
+  uint32_t shelves;
+  uint32_t occupancyPercent; // atlas area covered by glyphs
+  uint32_t shelfPercent;     // atlas area claimed by shelves
+  uint32_t churnPerSec;      // glyphs evicted during the last second
+  uint32_t churnMaxPerSec;
+  uint32_t prewarmed;
+  uint32_t rasterizeAvgUs;
+  uint32_t rasterizeMaxUs;
+};
+
+// Registers the "glyphs" console command. Call before the scheduler starts.
+void GlyphCache_Init();
+
+// Rasterizes one glyph per byte of text into the atlas. Before the
+// scheduler starts or on the Qul thread; queued until the rasterizer is
+// registered. false if the request could not be queued or a glyph did not
+// fit.
+bool GlyphCache_Prewarm(uint16_t font, uint16_t size, const char *text, bool pin = true);
+
+// Qul thread, once per frame after Application::update().
+void GlyphCache_EndFrame();
+
+void GlyphCache_GetStats(GlyphCacheStats &out);
+void GlyphCache_ResetStats();
+#endif
+
+#endif /* GLYPH_CACHE_H */
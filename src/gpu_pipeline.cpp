@@ -0,0 +1,214 @@
+#include "gpu_pipeline.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+#include <vg_lite.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+
+struct PendingPresent {
+  uint32_t layer;
+  int32_t buffer; // Framebuffer_Hold()
+  GpuPresentFn present;
+  uint32_t count;
+  DirtyRect rects[DIRTY_REGION_MAX_RECTS];
+};
+
+struct PresentList {
+  PendingPresent entries[FRAMEBUFFER_MAX_LAYERS];
+  uint32_t count;
+};
+
+// Render thread only, except where atomic; the console reads the totals
+// under vTaskSuspendAll.
+static PresentList s_lists[2];
+static PresentList *s_recording = &s_lists[0];
+static PresentList *s_inFlight = &s_lists[1];
+static GpuFence s_submitted;
+static GpuFence s_completed;
+static uint32_t s_submitAt; // cycles
+static uint32_t s_ops;
+
+static std::atomic<bool> s_batching{true};
+static std::atomic<uint32_t> s_interrupts{0};
+static std::atomic<uint32_t> s_interruptAt{0};
+
+static struct {
+  uint32_t frames;
+  uint64_t ops;
+  uint64_t busy;
+  uint64_t overlap;
+  uint64_t stall;
+  uint32_t stallMax;
+  TickType_t resetAt;
+} s_totals;
+
+static void runPresents(PresentList &list) {
+  for (uint32_t i = 0; i < list.count; i++) {
+    const PendingPresent &entry = list.entries[i];
+    entry.present(entry.layer, entry.buffer, entry.count != 0U ? entry.rects : NULL, entry.count);
+  }
+  list.count = 0;
+}
+
+static void recordStall(uint32_t cycles) {
+  s_totals.stall += cycles;
+  s_totals.stallMax = cycles > s_totals.stallMax ? cycles : s_totals.stallMax;
+}
+
+GpuFence GpuPipeline_LastFence() { return s_submitted; }
+
+bool GpuPipeline_Signalled(GpuFence fence) { return (int32_t)(s_completed - fence) >= 0; }
+
+void GpuPipeline_Wait(GpuFence fence) {
+  if (GpuPipeline_Signalled(fence)) {
+    return;
+  }
+  const uint32_t waitFrom = CycleCounter_Read();
+  (void)vg_lite_finish();
+  const uint32_t now = CycleCounter_Read();
+  s_completed = s_submitted;
+
+  // The newest interrupt is the end of the last command buffer, since
+  // vg_lite_finish() returns only after it has been handled.
+  uint32_t doneAt = now;
+  const uint32_t interruptAt = s_interruptAt.load(std::memory_order_relaxed);
+  if (s_interrupts.load(std::memory_order_relaxed) != 0U && (int32_t)(interruptAt - s_submitAt) > 0) {
+    doneAt = interruptAt;
+  }
+  const uint32_t overlapEnd = (int32_t)(doneAt - waitFrom) < 0 ? doneAt : waitFrom;
+  s_totals.busy += doneAt - s_submitAt;
+  s_totals.overlap += overlapEnd - s_submitAt;
+  recordStall(now - waitFrom);
+}
+
+extern "C" void GpuPipeline_Sync(void) {
+  GpuPipeline_Wait(s_submitted);
+  if (s_ops == 0U || !s_batching.load(std::memory_order_relaxed)) {
+    return;
+  }
+  // The frame being recorded is not submitted yet; vg_lite_finish() submits
+  // it as well.
+  const uint32_t start = CycleCounter_Read();
+  (void)vg_lite_finish();
+  recordStall(CycleCounter_Read() - start);
+}
+
+extern "C" void GpuPipeline_BeginFrame(void) {
+  GpuPipeline_Wait(s_submitted);
+  runPresents(*s_inFlight);
+}
+
+extern "C" void GpuPipeline_AfterDraw(void) {
+  s_ops++;
+  if (!s_batching.load(std::memory_order_relaxed)) {
+    const uint32_t start = CycleCounter_Read();
+    (void)vg_lite_finish();
+    const uint32_t cycles = CycleCounter_Read() - start;
+    s_totals.busy += cycles;
+    recordStall(cycles);
+  }
+}
+
+extern "C" void GpuPipeline_Present(uint32_t layer, const DirtyRect *rects, uint32_t count,
+                                    GpuPresentFn present) {
+  const int32_t buffer = Framebuffer_Hold(layer);
+  if (s_recording->count == FRAMEBUFFER_MAX_LAYERS || count > DIRTY_REGION_MAX_RECTS) {
+    // Cannot hold it back: finish this frame's commands so far and present.
+    GpuPipeline_Sync();
+    present(layer, buffer, rects, count);
+    return;
+  }
+  PendingPresent &entry = s_recording->entries[s_recording->count++];
+  entry.layer = layer;
+  entry.buffer = buffer;
+  entry.present = present;
+  entry.count = count;
+  memcpy(entry.rects, rects, count * sizeof(DirtyRect));
+}
+
+extern "C" void GpuPipeline_EndFrame(void) {
+  // Called without BeginFrame: retire the previous frame first.
+  GpuPipeline_BeginFrame();
+
+  s_totals.frames++;
+  s_totals.ops += s_ops;
+  s_ops = 0;
+  if (!s_batching.load(std::memory_order_relaxed)) {
+    runPresents(*s_recording);
+    return;
+  }
+  s_submitAt = CycleCounter_Read();
+  if (vg_lite_flush() != VG_LITE_SUCCESS) {
+    (void)vg_lite_finish();
+  }
+  s_submitted++;
+  PresentList *submitted = s_recording;
+  s_recording = s_inFlight;
+  s_inFlight = submitted;
+}
+
+extern "C" void GpuPipeline_OnInterrupt(void) {
+  s_interruptAt.store(CycleCounter_Read(), std::memory_order_relaxed);
+  s_interrupts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GpuPipeline_SetBatching(bool on) { s_batching.store(on, std::memory_order_relaxed); }
+
+void GpuPipeline_GetStats(GpuPipelineStats &out) {
+  vTaskSuspendAll();
+  const uint32_t frames = s_totals.frames;
+  const uint64_t wallUs = (uint64_t)(xTaskGetTickCount() - s_totals.resetAt) * (1000000U / configTICK_RATE_HZ);
+  const uint64_t busyUs = s_totals.busy / (SystemCoreClock / 1000000U);
+  out.frames = frames;
+  out.opsPerFrame = frames != 0U ? (uint32_t)(s_totals.ops / frames) : 0U;
+  out.busyAvgUs = frames != 0U ? CycleCounter_ToUs((uint32_t)(s_totals.busy / frames)) : 0U;
+  out.idlePercent = wallUs != 0U && busyUs < wallUs ? (uint32_t)(100U - busyUs * 100U / wallUs) : 0U;
+  out.overlapAvgUs = frames != 0U ? CycleCounter_ToUs((uint32_t)(s_totals.overlap / frames)) : 0U;
+  out.stallAvgUs = frames != 0U ? CycleCounter_ToUs((uint32_t)(s_totals.stall / frames)) : 0U;
+  out.stallMaxUs = CycleCounter_ToUs(s_totals.stallMax);
+  (void)xTaskResumeAll();
+  out.batching = s_batching.load(std::memory_order_relaxed);
+  out.exactCompletion = s_interrupts.load(std::memory_order_relaxed) != 0U;
+}
+
+void GpuPipeline_ResetStats() {
+  vTaskSuspendAll();
+  memset(&s_totals, 0, sizeof(s_totals));
+  s_totals.resetAt = xTaskGetTickCount();
+  (void)xTaskResumeAll();
+}
+
+static void gpuCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    GpuPipeline_ResetStats();
+  } else if (DebugConsole_ArgIs(args, "batch")) {
+    bool on;
+    if (!DebugConsole_ArgOnOff(args, on)) {
+      Qul::PlatformInterface::log("usage: gpu batch on|off\r\n");
+      return;
+    }
+    GpuPipeline_SetBatching(on);
+    GpuPipeline_ResetStats();
+  }
+  GpuPipelineStats stats;
+  GpuPipeline_GetStats(stats);
+  Qul::PlatformInterface::log("VGLite %s, %u frames, %u ops/frame\r\n",
+                              stats.batching ? "batched per frame" : "finished per op",
+                              (unsigned)stats.frames, (unsigned)stats.opsPerFrame);
+  Qul::PlatformInterface::log("  GPU busy %s%u us/frame, idle %u%%\r\n",
+                              stats.exactCompletion ? "" : "<= ", (unsigned)stats.busyAvgUs,
+                              (unsigned)stats.idlePercent);
+  Qul::PlatformInterface::log("  CPU overlapped %u us/frame, stalled avg %u us max %u us\r\n",
+                              (unsigned)stats.overlapAvgUs, (unsigned)stats.stallAvgUs,
+                              (unsigned)stats.stallMaxUs);
+}
+
+void GpuPipeline_Init() {
+  GpuPipeline_ResetStats();
+  DebugConsole_Register("gpu", "VGLite pipelining statistics [reset|batch on|batch off]", gpuCommand);
+}
@@ -0,0 +1,110 @@
+#ifndef GPU_PIPELINE_H
+#define GPU_PIPELINE_H
+
+#include <stdint.h>
+
+#include "dirty_region.h"
+#include "framebuffer.h"
+
+/*
+ * Batched VGLite submission with one frame in flight.
+ *
+ * The platform glue (platform/ generated by qmlprojectexporter) used to end
+ * every VGLite blit and fill with vg_lite_finish(), so the CPU sat idle while
+ * the GC355 drew and the GC355 sat idle while the CPU prepared the next
+ * operation. In batch mode the glue calls GpuPipeline_AfterDraw() there
+ * instead, which records nothing but a count: the operations of a whole frame
+ * collect in VGLite's command buffer and GpuPipeline_EndFrame() submits them
+ * with vg_lite_flush(), which does not wait.
+ *
+ * The frame's presents (GpuPipeline_Present) are held back until its fence
+ * has signalled. That happens at GpuPipeline_BeginFrame() of the next frame,
+ * just before it records its first command, so the CPU runs input, the
+ * signal bridge and Qul's update for frame N+1 while the GPU finishes frame
+ * N. Waiting there with vg_lite_finish() is exact, since nothing newer has
+ * been submitted yet. Frame N+1 draws into another buffer; with double
+ * buffering it then waits for frame N's flip, so FRAMEBUFFER_COUNT 3 is what
+ * makes the overlap pay off.
+ *
+ * GpuPipeline_Present() takes the acquired buffer with Framebuffer_Hold(),
+ * and the deferred present passes that index back, so it shows exactly the
+ * buffer frame N drew. The buffer stays acquired until then: the glue must
+ * call GpuPipeline_BeginFrame() before every Framebuffer_Acquire() (or
+ * DisplayLayers_BeginUpdate()) of a frame, and Framebuffer_Acquire()
+ * asserts that no present of the layer is still held back.
+ *
+ * CPU code that reads or writes a buffer the GPU may still be drawing calls
+ * GpuPipeline_Sync() first.
+ *
+ * If the glue also calls GpuPipeline_OnInterrupt() from GPU2D_IRQHandler
+ * after vg_lite_IRQHandler(), completion is timestamped in the interrupt and
+ * the busy/idle split is exact; without it a frame counts as busy until the
+ * fence wait returned, an upper bound.
+ *
+ * "gpu" on the console prints operations per frame, GPU busy and idle time,
+ * how long the CPU overlapped with the GPU and how long it still stalled on
+ * a fence. "gpu batch off" restores a vg_lite_finish() after every
+ * operation for comparison.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*GpuPresentFn)(uint32_t layer, int32_t buffer, const DirtyRect *rects, uint32_t count);
+
+/* Render thread, before the first VGLite command and the first
+   Framebuffer_Acquire() of a frame. Waits for the previous frame and runs its
+   presents. */
+void GpuPipeline_BeginFrame(void);
+
+/* Render thread, where each VGLite operation used to be finished. */
+void GpuPipeline_AfterDraw(void);
+
+/* Render thread. Presents the buffer acquired for layer through present
+   (Framebuffer_PresentBuffer or DisplayLayers_EndUpdateBuffer) once the GPU
+   has finished this frame. At most FRAMEBUFFER_MAX_LAYERS per frame. */
+void GpuPipeline_Present(uint32_t layer, const DirtyRect *rects, uint32_t count, GpuPresentFn present);
+
+/* Render thread, after the last VGLite command of a frame. */
+void GpuPipeline_EndFrame(void);
+
+/* Render thread. Waits until every command recorded so far, including those
+   of the frame in progress, has executed. */
+void GpuPipeline_Sync(void);
+
+/* GPU2D interrupt, after vg_lite_IRQHandler(). */
+void GpuPipeline_OnInterrupt(void);
+
+#ifdef __cplusplus
+}
+
+// A submitted frame, completed once the GPU has executed it.
+typedef uint32_t GpuFence;
+
+struct GpuPipelineStats {
+  uint32_t frames;
+  uint32_t opsPerFrame;   // average
+  uint32_t busyAvgUs;     // submit -> GPU done
+  uint32_t idlePercent;   // of wall time since the stats were reset
+  uint32_t overlapAvgUs;  // CPU work between submit and the fence wait
+  uint32_t stallAvgUs;    // CPU blocked in the fence wait
+  uint32_t stallMaxUs;
+  bool batching;
+  bool exactCompletion;   // GpuPipeline_OnInterrupt is wired
+};
+
+// Registers the "gpu" console command.
+void GpuPipeline_Init();
+
+// Fence of the most recent GpuPipeline_EndFrame().
+GpuFence GpuPipeline_LastFence();
+bool GpuPipeline_Signalled(GpuFence fence);
+void GpuPipeline_Wait(GpuFence fence);
+
+void GpuPipeline_SetBatching(bool on);
+void GpuPipeline_GetStats(GpuPipelineStats &out);
+void GpuPipeline_ResetStats();
+#endif
+
+#endif /* GPU_PIPELINE_H */
@@ -0,0 +1,201 @@
+#include "heap_monitor.h"
+
+#include <atomic>
+#include <platforminterface/log.h>
+#include <portable.h>
+#include <string.h>
+#include <task.h>
+
+#include "debug_console.h"
+#include "static_alloc.h"
+
+struct CallSite {
+  const void *site;
+  uint32_t count;
+  uint32_t bytes;
+};
+
+static TaskStorage<512> s_task APP_STATIC_STORAGE;
+
+static const char *const s_pathNames[3] = {"pool", "heap", "arena"};
+
+static std::atomic<uint32_t> s_allocs[3];
+static std::atomic<uint32_t> s_frees[3];
+static std::atomic<uint32_t> s_failures;
+static std::atomic<bool> s_traceSites{false};
+
+static CallSite s_sites[HEAP_MONITOR_CALL_SITES];
+static uint32_t s_siteOverflows;
+static uint32_t s_sizeBuckets[16]; // log2 size histogram, last bucket open
+
+static uint32_t s_worstFragmentation;
+static size_t s_smallestLargestFree = (size_t)-1;
+static bool s_lowWarned;
+
+static void traceSite(const void *site, size_t size) {
+  const uint32_t hash = ((uint32_t)(uintptr_t)site >> 1) * 2654435761U;
+  uint32_t index = hash & (HEAP_MONITOR_CALL_SITES - 1);
+
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  const uint32_t bucket = size == 0 ? 0 : 32 - __builtin_clz((uint32_t)size);
+  s_sizeBuckets[bucket < 15 ? bucket : 15]++;
+  for (uint32_t probe = 0; probe < HEAP_MONITOR_CALL_SITES; probe++) {
+    CallSite &entry = s_sites[index];
+    if (entry.site == site || entry.site == NULL) {
+      entry.site = site;
+      entry.count++;
+      entry.bytes += size;
+      portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+      return;
+    }
+    index = (index + 1) & (HEAP_MONITOR_CALL_SITES - 1);
+  }
+  s_siteOverflows++;
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+void HeapMonitor_OnAlloc(const void *site, size_t size, HeapPath path) {
+  s_allocs[(int)path].fetch_add(1, std::memory_order_relaxed);
+  if (s_traceSites.load(std::memory_order_relaxed)) {
+    traceSite(site, size);
+  }
+}
+
+void HeapMonitor_OnFree(HeapPath path) {
+  s_frees[(int)path].fetch_add(1, std::memory_order_relaxed);
+}
+
+void HeapMonitor_OnFailure(size_t size) {
+  // First failure only; the sampler keeps the counter for later ones.
+  if (s_failures.fetch_add(1, std::memory_order_relaxed) == 0) {
+    Qul::PlatformInterface::log("heap: allocation of %u bytes failed, %u bytes free\r\n",
+                                (unsigned)size, (unsigned)xPortGetFreeHeapSize());
+  }
+}
+
+void HeapMonitor_Sample(HeapSnapshot &out) {
+  HeapStats_t stats;
+  vPortGetHeapStats(&stats);
+
+  const size_t poolArena = CppHeap_SmallPoolStats(out.pool);
+
+  // heap_4 counts the whole pool arena as allocated; replace it with what
+  // the pools actually hand out. The high water adds the two peaks, which
+  // need not have coincided, so it is an upper bound.
+  out.bytesInUse = configTOTAL_HEAP_SIZE - stats.xAvailableHeapSpaceInBytes - poolArena + out.pool.bytesInUse;
+  out.highWaterBytes = configTOTAL_HEAP_SIZE - stats.xMinimumEverFreeBytesRemaining - poolArena + out.pool.peakBytes;
+  out.freeBytes = stats.xAvailableHeapSpaceInBytes;
+  out.largestFreeBlock = stats.xSizeOfLargestFreeBlockInBytes;
+  out.freeBlocks = stats.xNumberOfFreeBlocks;
+  out.fragmentationPermille =
+      out.freeBytes == 0 ? 0 : 1000U - (uint32_t)((uint64_t)out.largestFreeBlock * 1000U / out.freeBytes);
+  for (int i = 0; i < 3; i++) {
+    out.allocs[i] = s_allocs[i].load(std::memory_order_relaxed);
+    out.frees[i] = s_frees[i].load(std::memory_order_relaxed);
+  }
+  out.failures = s_failures.load(std::memory_order_relaxed);
+}
+
+void HeapMonitor_Report() {
+  HeapSnapshot snap;
+  HeapMonitor_Sample(snap);
+  Qul::PlatformInterface::log("heap: %u in use, high water %u, free %u in %u blocks\r\n",
+                              (unsigned)snap.bytesInUse, (unsigned)snap.highWaterBytes,
+                              (unsigned)snap.freeBytes, (unsigned)snap.freeBlocks);
+  Qul::PlatformInterface::log("heap: largest free %u (lowest seen %u), fragmentation %u.%u%% (worst %u.%u%%)\r\n",
+                              (unsigned)snap.largestFreeBlock, (unsigned)s_smallestLargestFree,
+                              (unsigned)(snap.fragmentationPermille / 10), (unsigned)(snap.fragmentationPermille % 10),
+                              (unsigned)(s_worstFragmentation / 10), (unsigned)(s_worstFragmentation % 10));
+  for (int i = 0; i < 3; i++) {
+    Qul::PlatformInterface::log("heap: %-5s %u allocs, %u frees\r\n", s_pathNames[i],
+                                (unsigned)snap.allocs[i], (unsigned)snap.frees[i]);
+  }
+  Qul::PlatformInterface::log("heap: pool pages %u/%u, %u failed allocations\r\n",
+                              (unsigned)snap.pool.pagesUsed, (unsigned)snap.pool.pagesTotal,
+                              (unsigned)snap.failures);
+}
+
+static void reportSites() {
+  CallSite sites[HEAP_MONITOR_CALL_SITES];
+  uint32_t buckets[16];
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  memcpy(sites, s_sites, sizeof(sites));
+  memcpy(buckets, s_sizeBuckets, sizeof(buckets));
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+  // Top 16 by bytes, selection on the local copy.
+  for (int rank = 0; rank < 16; rank++) {
+    int best = -1;
+    for (int i = 0; i < HEAP_MONITOR_CALL_SITES; i++) {
+      if (sites[i].site != NULL && (best < 0 || sites[i].bytes > sites[best].bytes)) {
+        best = i;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+    Qul::PlatformInterface::log("  %p %8u allocs %10u bytes\r\n", sites[best].site,
+                                (unsigned)sites[best].count, (unsigned)sites[best].bytes);
+    sites[best].site = NULL;
+  }
+  if (s_siteOverflows != 0) {
+    Qul::PlatformInterface::log("  (%u allocations from untracked sites)\r\n", (unsigned)s_siteOverflows);
+  }
+  for (int i = 0; i < 15; i++) {
+    if (buckets[i] != 0) {
+      Qul::PlatformInterface::log("  < %5u bytes: %u\r\n", 1U << i, (unsigned)buckets[i]);
+    }
+  }
+  if (buckets[15] != 0) {
+    Qul::PlatformInterface::log("  >=%5u bytes: %u\r\n", 1U << 14, (unsigned)buckets[15]);
+  }
+}
+
+static void heapCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "sites")) {
+    reportSites();
+  } else if (DebugConsole_ArgIs(args, "trace")) {
+    const bool on = strstr(args, "on") != NULL;
+    s_traceSites.store(on, std::memory_order_relaxed);
+    Qul::PlatformInterface::log("heap: call-site tracing %s\r\n", on ? "on" : "off");
+  } else if (DebugConsole_ArgIs(args, "reset")) {
+    const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    memset(s_sites, 0, sizeof(s_sites));
+    memset(s_sizeBuckets, 0, sizeof(s_sizeBuckets));
+    s_siteOverflows = 0;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+  } else {
+    HeapMonitor_Report();
+  }
+}
+
+static void HeapMonitor_Thread(void *argument) {
+  (void)argument;
+  TickType_t lastWake = xTaskGetTickCount();
+  while (true) {
+    HeapSnapshot snap;
+    HeapMonitor_Sample(snap);
+    if (snap.fragmentationPermille > s_worstFragmentation) {
+      s_worstFragmentation = snap.fragmentationPermille;
+    }
+    if (snap.largestFreeBlock < s_smallestLargestFree) {
+      s_smallestLargestFree = snap.largestFreeBlock;
+    }
+    const bool low = snap.largestFreeBlock < HEAP_MONITOR_WARN_LARGEST_FREE;
+    if (low && !s_lowWarned) {
+      Qul::PlatformInterface::log("heap: largest free block down to %u bytes\r\n",
+                                  (unsigned)snap.largestFreeBlock);
+      HeapMonitor_Report();
+    }
+    s_lowWarned = low;
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(HEAP_MONITOR_PERIOD_MS));
+  }
+}
+
+void HeapMonitor_Start(UBaseType_t priority) {
+  DebugConsole_Register("heap", "heap stats [sites|trace on|trace off|reset]", heapCommand);
+  if (s_task.create(HeapMonitor_Thread, "HeapMonitor", 0, priority) != pdPASS) {
+    Qul::PlatformInterface::log("Task creation failed!.\r\n");
+    configASSERT(false);
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pool_allocator.h"
+
+// Telemetry for the C++ heap (small-object pools on top of heap_4).
+//
+// operator new/delete report every call here. The counters are relaxed
+// atomics; the expensive part, walking the heap_4 free list for the largest
+// free block, only runs in a low-priority sampler task. Per-call-site
+// accounting is off by default and is switched on from the console
+// ("heap trace on"); sites are return addresses, resolve them with
+// arm-none-eabi-addr2line against the .elf.
+
+#ifndef HEAP_MONITOR_PERIOD_MS
+#define HEAP_MONITOR_PERIOD_MS 1000
+#endif
+
+/* Must be a power of two. */
+#ifndef HEAP_MONITOR_CALL_SITES
+#define HEAP_MONITOR_CALL_SITES 64
+#endif
+
+/* Warn when the largest contiguous free block drops below this. */
+#ifndef HEAP_MONITOR_WARN_LARGEST_FREE
+#define HEAP_MONITOR_WARN_LARGEST_FREE (512 * 1024)
+#endif
+
+enum class HeapPath : uint8_t { Pool, Heap, Arena };
+
+struct HeapSnapshot {
+  size_t bytesInUse;
+  size_t highWaterBytes;
+  size_t freeBytes;
+  size_t largestFreeBlock;
+  size_t freeBlocks;
+  uint32_t fragmentationPermille; // 1 - largest free block / free bytes
+  uint32_t allocs[3];             // by HeapPath
+  uint32_t frees[3];
+  uint32_t failures;
+  PoolAllocator::Stats pool;
+};
+
+void HeapMonitor_OnAlloc(const void *site, size_t size, HeapPath path);
+void HeapMonitor_OnFree(HeapPath path);
+void HeapMonitor_OnFailure(size_t size);
+
+// Starts the sampler task and registers the "heap" console command.
+void HeapMonitor_Start(UBaseType_t priority);
+
+void HeapMonitor_Sample(HeapSnapshot &out);
+void HeapMonitor_Report();
+
+// Provided by cpp_config.cpp.
+size_t CppHeap_SmallPoolStats(PoolAllocator::Stats &out);
+
+#endif // HEAP_MONITOR_H
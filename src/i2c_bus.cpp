@@ -0,0 +1,290 @@
+#include "i2c_bus.h"
+
+#include <FreeRTOS.h>
+#include <fsl_clock.h>
+#include <fsl_dmamux.h>
+#include <fsl_edma.h>
+#include <fsl_lpi2c.h>
+#include <fsl_lpi2c_edma.h>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+
+/* WM8962 on the EVKB; its register writes are the bulk of LPI2C5 traffic. */
+#ifndef I2C_BUS_CODEC_ADDRESS
+#define I2C_BUS_CODEC_ADDRESS 0x1AU
+#endif
+
+#define I2C_BUS_COUNT 2U
+
+struct DevicePriority {
+  uint8_t address;
+  I2cPriority priority;
+};
+
+struct Bus {
+  LPI2C_Type *base;
+  const char *name;
+  edma_handle_t txDma;
+  edma_handle_t rxDma;
+  lpi2c_master_edma_handle_t handle;
+  I2cQueue queue;
+  uint8_t *bounce;
+  uint8_t *readTo; // caller buffer of the read on the wire, if any
+  uint32_t readSize;
+  uint32_t timeouts;
+  DevicePriority devices[I2C_BUS_MAX_DEVICES];
+  uint8_t deviceCount;
+  bool ready;
+};
+
+struct Waiter {
+  TaskHandle_t task;
+  status_t status;
+};
+
+// Touched by the DMA engine, so kept out of the data cache.
+AT_NONCACHEABLE_SECTION_ALIGN(static uint8_t s_bounce[I2C_BUS_COUNT][I2C_BUS_BOUNCE_SIZE], 32);
+
+static Bus s_buses[I2C_BUS_COUNT];
+
+static Bus *findBus(LPI2C_Type *base) {
+  for (Bus &bus : s_buses) {
+    if (bus.ready && bus.base == base) {
+      return &bus;
+    }
+  }
+  return nullptr;
+}
+
+static lpi2c_master_transfer_t toTransfer(const I2cRequest &request, uint8_t *data) {
+  lpi2c_master_transfer_t transfer = {};
+  transfer.flags = kLPI2C_TransferDefaultFlag;
+  transfer.slaveAddress = request.address;
+  transfer.direction = request.read ? kLPI2C_Read : kLPI2C_Write;
+  transfer.subaddress = request.subaddress;
+  transfer.subaddressSize = request.subaddressSize;
+  transfer.data = request.size != 0U ? data : NULL;
+  transfer.dataSize = request.size;
+  return transfer;
+}
+
+static int32_t startTransfer(void *context, const I2cRequest &request) {
+  Bus &bus = *static_cast<Bus *>(context);
+  if (request.size > I2C_BUS_BOUNCE_SIZE) {
+    return kStatus_InvalidArgument;
+  }
+  if (request.read) {
+    bus.readTo = request.data;
+    bus.readSize = request.size;
+  } else {
+    bus.readTo = nullptr;
+    if (request.size != 0U) {
+      memcpy(bus.bounce, request.data, request.size);
+    }
+  }
+  lpi2c_master_transfer_t transfer = toTransfer(request, bus.bounce);
+  return LPI2C_MasterTransferEDMA(bus.base, &bus.handle, &transfer);
+}
+
+static void abortTransfer(void *context) {
+  Bus &bus = *static_cast<Bus *>(context);
+  LPI2C_MasterTransferAbortEDMA(bus.base, &bus.handle);
+  bus.readTo = nullptr;
+}
+
+static uint32_t timestamp(void *context) {
+  (void)context;
+  return CycleCounter_Read();
+}
+
+static void transferDone(LPI2C_Type *base, lpi2c_master_edma_handle_t *handle, status_t status,
+                         void *userData) {
+  (void)base;
+  (void)handle;
+  Bus &bus = *static_cast<Bus *>(userData);
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if (status == kStatus_Success && bus.readTo != nullptr) {
+    memcpy(bus.readTo, bus.bounce, bus.readSize);
+  }
+  bus.queue.complete(status);
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void I2cBus_Submit(LPI2C_Type *base, I2cRequest &request) {
+  Bus *bus = findBus(base);
+  configASSERT(bus != nullptr);
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  bus->queue.submit(request);
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+static void wakeWaiter(I2cRequest &request, int32_t status) {
+  Waiter &waiter = *static_cast<Waiter *>(request.user);
+  waiter.status = status;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveIndexedFromISR(waiter.task, I2C_BUS_NOTIFY_INDEX, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+status_t I2cBus_Transfer(LPI2C_Type *base, I2cRequest &request) {
+  Bus *bus = findBus(base);
+  if (bus == nullptr || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+    // Nothing else can be using the bus yet.
+    lpi2c_master_transfer_t transfer = toTransfer(request, request.data);
+    return LPI2C_MasterTransferBlocking(base, &transfer);
+  }
+  configASSERT(!xPortIsInsideInterrupt());
+
+  Waiter waiter = {xTaskGetCurrentTaskHandle(), kStatus_Success};
+  request.done = wakeWaiter;
+  request.user = &waiter;
+  (void)ulTaskNotifyTakeIndexed(I2C_BUS_NOTIFY_INDEX, pdTRUE, 0);
+  I2cBus_Submit(base, request);
+  if (ulTaskNotifyTakeIndexed(I2C_BUS_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(I2C_BUS_TIMEOUT_MS)) != 0U) {
+    return waiter.status;
+  }
+
+  const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+  if (bus->queue.abandon(request, kStatus_Timeout)) {
+    bus->timeouts++;
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  // Drop the notification of the abandon, or of a completion that raced the
+  // timeout.
+  (void)ulTaskNotifyTakeIndexed(I2C_BUS_NOTIFY_INDEX, pdTRUE, 0);
+  return waiter.status;
+}
+
+static I2cPriority devicePriority(LPI2C_Type *base, uint8_t address) {
+  const Bus *bus = findBus(base);
+  if (bus != nullptr) {
+    for (uint8_t i = 0; i < bus->deviceCount; i++) {
+      if (bus->devices[i].address == address) {
+        return bus->devices[i].priority;
+      }
+    }
+  }
+  return I2cPriority::Control;
+}
+
+void I2cBus_SetDevicePriority(LPI2C_Type *base, uint8_t address, I2cPriority priority) {
+  Bus *bus = findBus(base);
+  if (bus == nullptr) {
+    return;
+  }
+  for (uint8_t i = 0; i < bus->deviceCount; i++) {
+    if (bus->devices[i].address == address) {
+      bus->devices[i].priority = priority;
+      return;
+    }
+  }
+  if (bus->deviceCount < I2C_BUS_MAX_DEVICES) {
+    bus->devices[bus->deviceCount++] = DevicePriority{address, priority};
+  }
+}
+
+// Replaces the blocking default in board.c, so every BOARD_*_I2C_Send/Receive
+// helper on a shared bus is queued behind the same arbitration.
+extern "C" status_t BOARD_LPI2C_Transfer(LPI2C_Type *base, lpi2c_master_transfer_t *xfer) {
+  I2cRequest request = {};
+  request.address = (uint8_t)xfer->slaveAddress;
+  request.read = xfer->direction == kLPI2C_Read;
+  request.subaddressSize = (uint8_t)xfer->subaddressSize;
+  request.subaddress = xfer->subaddress;
+  request.data = static_cast<uint8_t *>(xfer->data);
+  request.size = (uint32_t)xfer->dataSize;
+  request.priority = devicePriority(base, request.address);
+  return I2cBus_Transfer(base, request);
+}
+
+static const char *const s_priorityNames[] = {"input", "control", "bulk"};
+
+static void i2cCommand(const char *args) {
+  const bool reset = DebugConsole_ArgIs(args, "reset");
+  for (Bus &bus : s_buses) {
+    if (!bus.ready) {
+      continue;
+    }
+    const UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    const I2cQueueStats stats = bus.queue.stats();
+    const uint32_t timeouts = bus.timeouts;
+    if (reset) {
+      bus.queue.resetStats();
+      bus.timeouts = 0;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    Qul::PlatformInterface::log("%s: %u queued (max %u), %u timeouts\r\n", bus.name,
+                                (unsigned)stats.depth, (unsigned)stats.maxDepth, (unsigned)timeouts);
+    for (int p = 0; p < static_cast<int>(I2cPriority::Count); p++) {
+      Qul::PlatformInterface::log("  %-8s %8u requests %6u failed, max wait %u us\r\n",
+                                  s_priorityNames[p], (unsigned)stats.submitted[p],
+                                  (unsigned)stats.failed[p],
+                                  (unsigned)CycleCounter_ToUs(stats.maxWait[p]));
+    }
+  }
+}
+
+static void setIrqPriority(IRQn_Type irq) { NVIC_SetPriority(irq, I2C_BUS_IRQ_PRIORITY); }
+
+static bool channelTaken(uint32_t channel) {
+  return (DMAMUX0->CHCFG[channel] & DMAMUX_CHCFG_ENBL_MASK) != 0U;
+}
+
+// One request per LPI2C serves both directions on the RT1170, on one channel,
+// as in the SDK's lpi2c_edma example; parts with separate requests get one
+// channel each.
+static void initBus(uint32_t n, LPI2C_Type *base, const char *name, int32_t txRequest,
+                    int32_t rxRequest, IRQn_Type irq) {
+  Bus &bus = s_buses[n];
+  const uint32_t txChannel = I2C_BUS_DMA_CHANNEL_BASE + 2U * n;
+#if defined(FSL_FEATURE_LPI2C_HAS_SEPARATE_DMA_RX_TX_REQn) && FSL_FEATURE_LPI2C_HAS_SEPARATE_DMA_RX_TX_REQn
+  const uint32_t rxChannel = txChannel + 1U;
+#else
+  const uint32_t rxChannel = txChannel;
+  (void)rxRequest;
+#endif
+  if (channelTaken(txChannel) || channelTaken(rxChannel)) {
+    Qul::PlatformInterface::log("%s: DMA channel %u already in use, not queued\r\n", name,
+                                (unsigned)txChannel);
+    return;
+  }
+  bus.base = base;
+  bus.name = name;
+  bus.bounce = s_bounce[n];
+
+  DMAMUX_SetSource(DMAMUX0, txChannel, txRequest);
+  DMAMUX_EnableChannel(DMAMUX0, txChannel);
+  EDMA_CreateHandle(&bus.txDma, DMA0, txChannel);
+#if defined(FSL_FEATURE_LPI2C_HAS_SEPARATE_DMA_RX_TX_REQn) && FSL_FEATURE_LPI2C_HAS_SEPARATE_DMA_RX_TX_REQn
+  DMAMUX_SetSource(DMAMUX0, rxChannel, rxRequest);
+  DMAMUX_EnableChannel(DMAMUX0, rxChannel);
+  EDMA_CreateHandle(&bus.rxDma, DMA0, rxChannel);
+  LPI2C_MasterCreateEDMAHandle(base, &bus.handle, &bus.rxDma, &bus.txDma, transferDone, &bus);
+#else
+  LPI2C_MasterCreateEDMAHandle(base, &bus.handle, &bus.txDma, &bus.txDma, transferDone, &bus);
+#endif
+
+  // Channels 0-15 share their vector with channels 16-31.
+  setIrqPriority((IRQn_Type)(DMA0_DMA16_IRQn + rxChannel % 16U));
+  setIrqPriority((IRQn_Type)(DMA0_DMA16_IRQn + txChannel % 16U));
+  setIrqPriority(irq);
+
+  bus.queue = I2cQueue(I2cBusOps{startTransfer, abortTransfer, timestamp, &bus});
+  bus.ready = true;
+}
+
+void I2cBus_Init() {
+  // EDMA_Init() would disable every channel request and clear the status of
+  // a controller the platform may already be using; clocking it is enough
+  // here, EDMA_CreateHandle() resets the channels taken.
+  CLOCK_EnableClock(kCLOCK_Edma);
+  DMAMUX_Init(DMAMUX0);
+  initBus(0, LPI2C5, "LPI2C5", kDmaRequestMuxLPI2C5, kDmaRequestMuxLPI2C5, LPI2C5_IRQn);
+  initBus(1, LPI2C6, "LPI2C6", kDmaRequestMuxLPI2C6, kDmaRequestMuxLPI2C6, LPI2C6_IRQn);
+  I2cBus_SetDevicePriority(BOARD_CODEC_I2C_BASEADDR, I2C_BUS_CODEC_ADDRESS, I2cPriority::Bulk);
+  DebugConsole_Register("i2c", "I2C queue statistics [reset]", i2cCommand);
+}
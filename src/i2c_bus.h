@@ -0,0 +1,78 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <board.h>
+#include <stdint.h>
+
+#include "i2c_queue.h"
+
+/*
+ * Shared LPI2C buses behind one asynchronous transaction queue each.
+ *
+ * LPI2C5 carries the GT911 touch controller, the codec and the accelerometer;
+ * LPI2C6 the camera. Every transfer on them, including the blocking
+ * BOARD_*_I2C_Send/Receive helpers in board.c (through the
+ * BOARD_LPI2C_Transfer hook), goes through an I2cQueue (i2c_queue.h) and out
+ * by EDMA, so a touch read never waits behind more than the one transfer
+ * already on the wire.
+ *
+ * Priorities are per device: I2cBus_SetDevicePriority() sets the priority the
+ * blocking helpers use for an address, anything not registered is Control.
+ * Requests submitted directly carry their own priority.
+ *
+ * Data goes through a non-cacheable bounce buffer, so callers can use any
+ * buffer but a single transfer is limited to I2C_BUS_BOUNCE_SIZE bytes.
+ * Blocking callers wait on task notification index I2C_BUS_NOTIFY_INDEX.
+ * Before the scheduler starts, blocking transfers bypass the queue and poll
+ * the bus directly.
+ *
+ * "i2c" on the console prints per-bus queue statistics.
+ */
+
+#ifndef I2C_BUS_BOUNCE_SIZE
+#define I2C_BUS_BOUNCE_SIZE 256
+#endif
+
+/* Bus n uses DMA0 channel BASE + 2n, and BASE + 2n + 1 for RX on parts whose
+   LPI2C has separate RX and TX requests. The top channels, clear of the low
+   ones the SDK drivers default to. */
+#ifndef I2C_BUS_DMA_CHANNEL_BASE
+#define I2C_BUS_DMA_CHANNEL_BASE 28U
+#endif
+
+/* LPI2C and DMA completion interrupts, and every ISR that submits requests,
+   must share this priority. Must be at or below the syscall ceiling. */
+#ifndef I2C_BUS_IRQ_PRIORITY
+#define I2C_BUS_IRQ_PRIORITY (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1)
+#endif
+
+#ifndef I2C_BUS_NOTIFY_INDEX
+#define I2C_BUS_NOTIFY_INDEX 1
+#endif
+
+/* A blocking transfer that has not finished by then is aborted. */
+#ifndef I2C_BUS_TIMEOUT_MS
+#define I2C_BUS_TIMEOUT_MS 100
+#endif
+
+#ifndef I2C_BUS_MAX_DEVICES
+#define I2C_BUS_MAX_DEVICES 8
+#endif
+
+// Sets up EDMA for every shared bus and registers the "i2c" console command.
+// DMA0 is shared, so it is not reset; a bus whose channels are already muxed
+// to something else is left unqueued and transfers on it poll as before.
+// Call from main() before the scheduler starts.
+void I2cBus_Init();
+
+// Any context at or below I2C_BUS_IRQ_PRIORITY. Queues request on the bus
+// behind base; request.done runs in interrupt context.
+void I2cBus_Submit(LPI2C_Type *base, I2cRequest &request);
+
+// Task context: queues request and waits for it (request.done and
+// request.user are overwritten).
+status_t I2cBus_Transfer(LPI2C_Type *base, I2cRequest &request);
+
+void I2cBus_SetDevicePriority(LPI2C_Type *base, uint8_t address, I2cPriority priority);
+
+#endif // I2C_BUS_H
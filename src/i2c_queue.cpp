@@ -0,0 +1,132 @@
+#include "i2c_queue.h"
+
+static int slot(I2cPriority priority) { return static_cast<int>(priority); }
+
+void I2cQueue::submit(I2cRequest &request) {
+  if (request.priority >= I2cPriority::Count) {
+    request.priority = I2cPriority::Bulk;
+  }
+  const int p = slot(request.priority);
+  request.next = nullptr;
+  request.queuedAt = ops_.now != nullptr ? ops_.now(ops_.context) : 0;
+  if (inCallback_ && head_[p] != nullptr) {
+    request.next = head_[p];
+    head_[p] = &request;
+  } else {
+    if (tail_[p] != nullptr) {
+      tail_[p]->next = &request;
+    } else {
+      head_[p] = &request;
+    }
+    tail_[p] = &request;
+  }
+  stats_.submitted[p]++;
+  if (++stats_.depth > stats_.maxDepth) {
+    stats_.maxDepth = stats_.depth;
+  }
+  pump();
+}
+
+bool I2cQueue::cancel(I2cRequest &request) {
+  const int p = slot(request.priority);
+  I2cRequest *prev = nullptr;
+  for (I2cRequest *it = head_[p]; it != nullptr; prev = it, it = it->next) {
+    if (it != &request) {
+      continue;
+    }
+    if (prev != nullptr) {
+      prev->next = it->next;
+    } else {
+      head_[p] = it->next;
+    }
+    if (tail_[p] == it) {
+      tail_[p] = prev;
+    }
+    it->next = nullptr;
+    stats_.depth--;
+    return true;
+  }
+  return false;
+}
+
+bool I2cQueue::abandon(I2cRequest &request, int32_t status) {
+  if (cancel(request)) {
+    finish(request, status);
+    return true;
+  }
+  if (active_ != &request || ops_.abort == nullptr) {
+    return false;
+  }
+  ops_.abort(ops_.context);
+  complete(status);
+  return true;
+}
+
+I2cRequest *I2cQueue::pop() {
+  for (int p = 0; p < slot(I2cPriority::Count); p++) {
+    I2cRequest *request = head_[p];
+    if (request == nullptr) {
+      continue;
+    }
+    head_[p] = request->next;
+    if (head_[p] == nullptr) {
+      tail_[p] = nullptr;
+    }
+    request->next = nullptr;
+    stats_.depth--;
+    return request;
+  }
+  return nullptr;
+}
+
+// Runs until something is on the wire or nothing is left. A callback that
+// submits re-enters here; the outer loop then sees the bus busy and stops.
+void I2cQueue::pump() {
+  while (active_ == nullptr) {
+    I2cRequest *request = pop();
+    if (request == nullptr) {
+      return;
+    }
+    if (ops_.now != nullptr) {
+      const uint32_t waited = ops_.now(ops_.context) - request->queuedAt;
+      if (waited > stats_.maxWait[slot(request->priority)]) {
+        stats_.maxWait[slot(request->priority)] = waited;
+      }
+    }
+    active_ = request;
+    const int32_t status = ops_.start(ops_.context, *request);
+    if (status != 0) {
+      active_ = nullptr;
+      finish(*request, status);
+    }
+  }
+}
+
+void I2cQueue::complete(int32_t status) {
+  I2cRequest *request = active_;
+  if (request == nullptr) {
+    return;
+  }
+  active_ = nullptr;
+  finish(*request, status);
+  pump();
+}
+
+void I2cQueue::finish(I2cRequest &request, int32_t status) {
+  if (status != 0) {
+    stats_.failed[slot(request.priority)]++;
+  }
+  if (request.done != nullptr) {
+    const bool nested = inCallback_;
+    inCallback_ = true;
+    request.done(request, status);
+    inCallback_ = nested;
+  }
+}
+
+void I2cQueue::resetStats() {
+  const uint32_t depth = stats_.depth;
+  stats_ = I2cQueueStats();
+  stats_.depth = depth;
+  stats_.maxDepth = depth;
+}
@@ -0,0 +1,107 @@
+#ifndef I2C_QUEUE_H
+#define I2C_QUEUE_H
+
+#include <stdint.h>
+
+// Prioritised transaction queue for one I2C bus.
+//
+// Requests wait in one FIFO per priority and the bus always takes the oldest
+// request of the most urgent non-empty priority next, so a touch read queued
+// behind a batch of codec register writes goes out as soon as the transfer
+// currently on the wire finishes. A transfer that has started is never cut
+// short; the worst wait for an Input request is one transfer of another kind.
+//
+// The queue only sequences requests. The driver behind I2cBusOps::start puts
+// one transfer on the wire and reports its end by calling complete(), usually
+// from the transfer-complete interrupt; the request's callback runs from
+// there. A request submitted from a callback jumps to the front of its
+// priority, so a read and the write that acknowledges it are not split up by
+// another request of the same priority.
+//
+// Nothing here locks or touches hardware: the caller serialises submit(),
+// cancel(), abandon() and complete() (i2c_bus.cpp masks interrupts around
+// them). tools/i2c_queue_sim.cpp drives every state on the host with a
+// simulated bus whose start() records the transfer.
+//
+// Requests are caller-owned and linked intrusively; a request must stay alive
+// and must not be resubmitted until its callback has run.
+
+enum class I2cPriority : uint8_t { Input, Control, Bulk, Count };
+
+struct I2cRequest;
+typedef void (*I2cDoneFn)(I2cRequest &request, int32_t status);
+
+struct I2cRequest {
+  uint8_t address;
+  bool read;
+  uint8_t subaddressSize;
+  uint32_t subaddress;
+  uint8_t *data;
+  uint32_t size;
+  I2cPriority priority;
+  I2cDoneFn done; // 0 status is success, anything else comes from the driver
+  void *user;
+  // Owned by the queue while the request is pending.
+  uint32_t queuedAt;
+  I2cRequest *next;
+};
+
+struct I2cBusOps {
+  // Starts request on the wire without waiting for it. Must not call
+  // complete() itself; a non-zero return fails the request with that status.
+  int32_t (*start)(void *context, const I2cRequest &request);
+  // Stops the transfer on the wire; complete() is then not called for it.
+  // Only needed for abandon(), may be null otherwise.
+  void (*abort)(void *context);
+  // Free-running timestamp for the wait statistics, may be null.
+  uint32_t (*now)(void *context);
+  void *context;
+};
+
+struct I2cQueueStats {
+  uint32_t submitted[static_cast<int>(I2cPriority::Count)];
+  uint32_t failed[static_cast<int>(I2cPriority::Count)];
+  uint32_t maxWait[static_cast<int>(I2cPriority::Count)]; // in I2cBusOps::now units
+  uint32_t depth;
+  uint32_t maxDepth;
+};
+
+class I2cQueue {
+public:
+  I2cQueue() = default;
+  explicit I2cQueue(const I2cBusOps &ops) : ops_(ops) {}
+
+  // Queues request and starts it right away if the bus is idle.
+  void submit(I2cRequest &request);
+
+  // The transfer on the wire finished with status. Runs its callback, then
+  // starts the next request.
+  void complete(int32_t status);
+
+  // Takes request back if it has not started yet. Its callback is not run.
+  bool cancel(I2cRequest &request);
+
+  // Gives up on request, e.g. after a timeout: takes it back if it is still
+  // queued, or aborts it if it is on the wire, and runs its callback with
+  // status. Returns false if request is not pending.
+  bool abandon(I2cRequest &request, int32_t status);
+
+  const I2cRequest *active() const { return active_; }
+  bool idle() const { return active_ == nullptr && stats_.depth == 0; }
+  const I2cQueueStats &stats() const { return stats_; }
+  void resetStats();
+
+private:
+  I2cRequest *pop();
+  void pump();
+  void finish(I2cRequest &request, int32_t status);
+
+  I2cBusOps ops_ = {};
+  I2cRequest *head_[static_cast<int>(I2cPriority::Count)] = {};
+  I2cRequest *tail_[static_cast<int>(I2cPriority::Count)] = {};
+  I2cRequest *active_ = nullptr;
+  bool inCallback_ = false;
+  I2cQueueStats stats_ = {};
+};
+
+#endif // I2C_QUEUE_H
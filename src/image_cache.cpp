@@ -0,0 +1,326 @@
+#include "image_cache.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <qul/application.h>
+#include <qul/image.h>
+#include <qul/imageprovider.h>
+#include <qul/sharedimage.h>
+#include <semphr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "static_alloc.h"
+
+// Pool window reserved in armgcc/mem_regions.ld.
+extern "C" uint8_t __image_cache_start[];
+
+// Under s_lock, except the asset table, which is set once.
+static LruCache s_cache;
+static const ImageAsset *s_assets;
+static uint32_t s_assetCount;
+static struct {
+  uint32_t decodes;
+  uint32_t failures;
+  uint64_t cycles;
+  uint32_t cyclesMax;
+  uint32_t preloaded;
+} s_decode;
+
+static MutexStorage s_lockStorage APP_STATIC_STORAGE;
+static SemaphoreHandle_t s_lock;
+static std::atomic<uint32_t> s_contention{0};
+
+// Holds s_lock for its scope. Before the scheduler starts there is nobody
+// to exclude.
+class CacheLock {
+public:
+  CacheLock() : held_(xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    if (held_ && xSemaphoreTake(s_lock, 0) != pdTRUE) {
+      s_contention.fetch_add(1, std::memory_order_relaxed);
+      (void)xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+  }
+  ~CacheLock() {
+    if (held_) {
+      (void)xSemaphoreGive(s_lock);
+    }
+  }
+
+private:
+  bool held_;
+};
+
+static uint32_t readBe32(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// QOI (qoiformat.org) straight into the cache, without qoi_decode()'s
+// malloc'ed copy. Output is ARGB8888.
+static bool decodeQoi(const ImageAsset &asset, uint8_t *pixels, uint32_t stride) {
+  static const uint32_t HeaderSize = 14;
+  static const uint32_t PaddingSize = 8;
+  const uint8_t *data = asset.data;
+  if (asset.format != PixelFormat::Argb8888 || asset.size < HeaderSize + PaddingSize ||
+      memcmp(data, "qoif", 4) != 0 || readBe32(data + 4) != asset.width || readBe32(data + 8) != asset.height) {
+    return false;
+  }
+  const uint32_t end = asset.size - PaddingSize;
+  uint32_t index[64] = {};
+  uint32_t r = 0, g = 0, b = 0, a = 255;
+  uint32_t run = 0;
+  uint32_t p = HeaderSize;
+  for (uint32_t y = 0; y < asset.height; y++) {
+    uint32_t *line = reinterpret_cast<uint32_t *>(pixels + y * stride);
+    for (uint32_t x = 0; x < asset.width; x++) {
+      if (run != 0U) {
+        run--;
+      } else if (p < end) {
+        const uint32_t b1 = data[p++];
+        if (b1 == 0xFEU) { // QOI_OP_RGB
+          r = data[p];
+          g = data[p + 1U];
+          b = data[p + 2U];
+          p += 3U;
+        } else if (b1 == 0xFFU) { // QOI_OP_RGBA
+          r = data[p];
+          g = data[p + 1U];
+          b = data[p + 2U];
+          a = data[p + 3U];
+          p += 4U;
+        } else if ((b1 & 0xC0U) == 0x00U) { // QOI_OP_INDEX
+          const uint32_t c = index[b1];
+          a = c >> 24;
+          r = (c >> 16) & 0xFFU;
+          g = (c >> 8) & 0xFFU;
+          b = c & 0xFFU;
+        } else if ((b1 & 0xC0U) == 0x40U) { // QOI_OP_DIFF
+          r = (r + ((b1 >> 4) & 3U) - 2U) & 0xFFU;
+          g = (g + ((b1 >> 2) & 3U) - 2U) & 0xFFU;
+          b = (b + (b1 & 3U) - 2U) & 0xFFU;
+        } else if ((b1 & 0xC0U) == 0x80U) { // QOI_OP_LUMA
+          const uint32_t b2 = data[p++];
+          const uint32_t vg = (b1 & 0x3FU) - 32U;
+          r = (r + vg - 8U + ((b2 >> 4) & 0xFU)) & 0xFFU;
+          g = (g + vg) & 0xFFU;
+          b = (b + vg - 8U + (b2 & 0xFU)) & 0xFFU;
+        } else { // QOI_OP_RUN
+          run = b1 & 0x3FU;
+        }
+        index[(r * 3U + g * 5U + b * 7U + a * 11U) % 64U] = a << 24 | r << 16 | g << 8 | b;
+      }
+      line[x] = a << 24 | r << 16 | g << 8 | b;
+    }
+  }
+  return true;
+}
+
+static uint8_t *pixelsOf(int slot) { return __image_cache_start + s_cache.offset(slot); }
+
+// Places and decodes the asset; LruCache::None if it does not fit or fails
+// to decode. Under s_lock.
+static int decode(const ImageAsset &asset, bool evict) {
+  const uint32_t stride = ImageCache_Stride(asset);
+  const int slot = s_cache.insert(asset.id, stride * asset.height, evict);
+  if (slot == LruCache::None) {
+    return LruCache::None;
+  }
+  uint8_t *pixels = pixelsOf(slot);
+  const uint32_t start = CycleCounter_Read();
+  const bool decoded = asset.decode != nullptr ? asset.decode(asset, pixels, stride) : decodeQoi(asset, pixels, stride);
+  const uint32_t cycles = CycleCounter_Read() - start;
+  s_decode.decodes++;
+  s_decode.cycles += cycles;
+  s_decode.cyclesMax = cycles > s_decode.cyclesMax ? cycles : s_decode.cyclesMax;
+  if (!decoded) {
+    s_decode.failures++;
+    s_cache.remove(slot);
+    return LruCache::None;
+  }
+  // The GPU and the PXP read behind the data cache.
+  SCB_CleanDCache_by_Addr(pixels, (int32_t)(stride * asset.height));
+  return slot;
+}
+
+// Slot holding the decoded asset, decoding it on a miss. Under s_lock.
+static int load(const ImageAsset &asset) {
+  const int slot = s_cache.lookup(asset.id);
+  return slot != LruCache::None ? slot : decode(asset, true);
+}
+
+uint32_t ImageCache_Stride(const ImageAsset &asset) {
+  const uint32_t bytes = asset.width * (asset.format == PixelFormat::Argb8888 ? 4U : 2U);
+  return (bytes + IMAGE_CACHE_ALIGN - 1U) / IMAGE_CACHE_ALIGN * IMAGE_CACHE_ALIGN;
+}
+
+const ImageAsset *ImageCache_Find(uint32_t id) {
+  for (uint32_t i = 0; i < s_assetCount; i++) {
+    if (s_assets[i].id == id) {
+      return &s_assets[i];
+    }
+  }
+  return nullptr;
+}
+
+const ImageAsset *ImageCache_FindByName(const char *name, size_t length) {
+  for (uint32_t i = 0; i < s_assetCount; i++) {
+    if (strncmp(s_assets[i].name, name, length) == 0 && s_assets[i].name[length] == '\0') {
+      return &s_assets[i];
+    }
+  }
+  return nullptr;
+}
+
+uint32_t ImageCache_AssetCount() { return s_assetCount; }
+
+const ImageAsset &ImageCache_Asset(uint32_t index) { return s_assets[index]; }
+
+const uint8_t *ImageCache_Acquire(const ImageAsset &asset) {
+  CacheLock lock;
+  const int slot = load(asset);
+  if (slot == LruCache::None) {
+    return nullptr;
+  }
+  s_cache.acquire(slot);
+  return pixelsOf(slot);
+}
+
+void ImageCache_Release(const ImageAsset &asset) {
+  CacheLock lock;
+  const int slot = s_cache.find(asset.id);
+  if (slot != LruCache::None) {
+    s_cache.release(slot);
+  }
+}
+
+bool ImageCache_Pin(const ImageAsset &asset, bool pinned) {
+  CacheLock lock;
+  const int slot = pinned ? load(asset) : s_cache.find(asset.id);
+  if (slot == LruCache::None) {
+    return !pinned;
+  }
+  s_cache.pin(slot, pinned);
+  return true;
+}
+
+PreloadResult ImageCache_Preload(const ImageAsset &asset) {
+  CacheLock lock;
+  if (s_cache.find(asset.id) != LruCache::None) {
+    return PreloadResult::Cached;
+  }
+  const uint32_t failures = s_decode.failures;
+  if (decode(asset, false) == LruCache::None) {
+    return s_decode.failures != failures ? PreloadResult::Failed : PreloadResult::NoRoom;
+  }
+  s_decode.preloaded++;
+  return PreloadResult::Decoded;
+}
+
+uint32_t ImageCache_Contention() { return s_contention.load(std::memory_order_relaxed); }
+
+void ImageCache_SetAssets(const ImageAsset *assets, uint32_t count) {
+  s_assets = assets;
+  s_assetCount = count;
+  for (uint32_t i = 0; i < count; i++) {
+    if (assets[i].pinned && !ImageCache_Pin(assets[i], true)) {
+      Qul::PlatformInterface::log("Image %s could not be pinned\r\n", assets[i].name);
+    }
+  }
+}
+
+static Qul::PixelFormat qulFormat(PixelFormat format) {
+  switch (format) {
+  case PixelFormat::Rgb565:
+    return Qul::PixelFormat_RGB16;
+  case PixelFormat::Argb4444:
+    return Qul::PixelFormat_ARGB4444;
+  default:
+    return Qul::PixelFormat_ARGB32;
+  }
+}
+
+// Qul drops the last SharedImage of a cached asset.
+static void releaseImage(void *info) { ImageCache_Release(*static_cast<const ImageAsset *>(info)); }
+
+class CacheImageProvider : public Qul::ImageProvider {
+public:
+  Qul::SharedImage requestImage(const char *imageId, size_t imageIdLength) override {
+    const ImageAsset *asset = ImageCache_FindByName(imageId, imageIdLength);
+    const uint8_t *pixels = asset != nullptr ? ImageCache_Acquire(*asset) : nullptr;
+    if (pixels == nullptr) {
+      return Qul::SharedImage();
+    }
+    return Qul::SharedImage(Qul::Image(const_cast<uint8_t *>(pixels), asset->width, asset->height,
+                                       qulFormat(asset->format), (int)ImageCache_Stride(*asset), 0,
+                                       releaseImage, const_cast<ImageAsset *>(asset)));
+  }
+};
+
+static CacheImageProvider s_provider;
+
+void ImageCache_Register(Qul::Application &app) { app.addImageProvider("cache", &s_provider); }
+
+void ImageCache_SetBudget(uint32_t bytes) {
+  CacheLock lock;
+  s_cache.setBudget(bytes);
+}
+
+void ImageCache_Flush() {
+  CacheLock lock;
+  s_cache.evictAll();
+}
+
+void ImageCache_GetStats(ImageCacheStats &out) {
+  CacheLock lock;
+  s_cache.stats(out.cache);
+  out.budget = s_cache.budget();
+  out.decodes = s_decode.decodes;
+  out.decodeFailures = s_decode.failures;
+  out.decodeAvgUs = s_decode.decodes != 0U ? CycleCounter_ToUs((uint32_t)(s_decode.cycles / s_decode.decodes)) : 0U;
+  out.decodeMaxUs = CycleCounter_ToUs(s_decode.cyclesMax);
+  out.preloaded = s_decode.preloaded;
+  out.contention = s_contention.load(std::memory_order_relaxed);
+}
+
+void ImageCache_ResetStats() {
+  CacheLock lock;
+  s_cache.resetStats();
+  memset(&s_decode, 0, sizeof(s_decode));
+}
+
+static void imgcacheCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    ImageCache_ResetStats();
+  } else if (DebugConsole_ArgIs(args, "flush")) {
+    ImageCache_Flush();
+  } else if (DebugConsole_ArgIs(args, "budget")) {
+    ImageCache_SetBudget((uint32_t)strtoul(args + 6, NULL, 10) * 1024U);
+  }
+  ImageCacheStats stats;
+  ImageCache_GetStats(stats);
+  const LruCacheStats &c = stats.cache;
+  const uint32_t lookups = c.hits + c.misses;
+  Qul::PlatformInterface::log("Image cache %u KB of %u KB budget (pool %u KB), high water %u KB\r\n",
+                              (unsigned)(c.bytesUsed / 1024U), (unsigned)(stats.budget / 1024U),
+                              (unsigned)(IMAGE_CACHE_POOL_SIZE / 1024), (unsigned)(c.bytesHighWater / 1024U));
+  Qul::PlatformInterface::log("  %u images, %u pinned (%u KB)\r\n", (unsigned)c.entries, (unsigned)c.pinned,
+                              (unsigned)(c.bytesPinned / 1024U));
+  Qul::PlatformInterface::log("  hits %u, misses %u (%u%% hit), evictions %u, rejected %u\r\n", (unsigned)c.hits,
+                              (unsigned)c.misses, lookups != 0U ? (unsigned)(c.hits * 100ULL / lookups) : 0U,
+                              (unsigned)c.evictions, (unsigned)c.rejected);
+  Qul::PlatformInterface::log("  decodes %u (%u failed, %u preloaded), avg %u us, max %u us\r\n",
+                              (unsigned)stats.decodes, (unsigned)stats.decodeFailures, (unsigned)stats.preloaded,
+                              (unsigned)stats.decodeAvgUs, (unsigned)stats.decodeMaxUs);
+  Qul::PlatformInterface::log("  lock waits %u\r\n", (unsigned)stats.contention);
+}
+
+void ImageCache_Init() {
+  s_lock = s_lockStorage.create();
+  configASSERT(s_lock != NULL);
+  s_cache.init(IMAGE_CACHE_POOL_SIZE, IMAGE_CACHE_BUDGET, IMAGE_CACHE_ALIGN);
+  DebugConsole_Register("imgcache", "decoded image cache [reset|flush|budget <KB>]", imgcacheCommand);
+}
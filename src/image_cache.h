@@ -0,0 +1,127 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "framebuffer.h"
+#include "lru_cache.h"
+
+namespace Qul {
+class Application;
+}
+
+/*
+ * Decoded image cache in SDRAM.
+ *
+ * Images kept encoded in flash (QOI, or PNG through an application decode
+ * function) are decoded on first use into a NOLOAD SDRAM window
+ * (armgcc/mem_regions.ld) and stay there, keyed by asset id, until the LRU
+ * order evicts them (lru_cache.h). Conditionally shown images such as warning
+ * icons then cost one decode per eviction instead of one per appearance.
+ *
+ * IMAGE_CACHE_BUDGET bounds the decoded bytes; the window is larger so that
+ * fragmentation rarely forces extra evictions. Pinned assets are decoded up
+ * front and never evicted, for images that are always visible. An image the
+ * UI still holds is not evicted either: QML shows assets as
+ * "image://cache/<name>", and the provider references the cached pixels
+ * until Qul drops the last SharedImage.
+ *
+ * Lines are padded to IMAGE_CACHE_ALIGN and decoded pixels are cleaned out of
+ * the data cache, so VGLite and the PXP can read them directly.
+ *
+ * Any task may call in. A mutex with priority inheritance serialises the
+ * calls and is held across a decode, so when the Qul thread needs the cache
+ * while the preloader (preload.h) is decoding, the preloader finishes at the
+ * Qul thread's priority instead of being starved by everything in between.
+ * ImageCache_Contention() counts how often a task had to wait for it.
+ *
+ * "imgcache" on the console prints hits, misses, evictions and decode time;
+ * "imgcache flush" drops everything unpinned, "imgcache budget <KB>" changes
+ * the budget. Preloads count neither as hits nor as misses.
+ */
+
+/* Must match armgcc/mem_regions.ld. */
+#ifndef IMAGE_CACHE_POOL_SIZE
+#define IMAGE_CACHE_POOL_SIZE (8 * 1024 * 1024)
+#endif
+
+#ifndef IMAGE_CACHE_BUDGET
+#define IMAGE_CACHE_BUDGET (6 * 1024 * 1024)
+#endif
+
+#ifndef IMAGE_CACHE_ALIGN
+#define IMAGE_CACHE_ALIGN 64
+#endif
+
+struct ImageAsset;
+
+// Writes the decoded image, asset.height lines of stride bytes. Returns
+// false if the encoded data is broken.
+typedef bool (*ImageDecodeFn)(const ImageAsset &asset, uint8_t *pixels, uint32_t stride);
+
+struct ImageAsset {
+  uint32_t id;
+  const char *name; // image://cache/<name>
+  uint16_t width;
+  uint16_t height;
+  PixelFormat format; // decoded
+  const uint8_t *data; // encoded
+  uint32_t size;
+  ImageDecodeFn decode; // nullptr: QOI, decoded to Argb8888 only
+  bool pinned;
+  bool preload; // decoded at boot by the preloader
+};
+
+struct ImageCacheStats {
+  LruCacheStats cache;
+  uint32_t budget;
+  uint32_t decodes;
+  uint32_t decodeFailures;
+  uint32_t decodeAvgUs;
+  uint32_t decodeMaxUs;
+  uint32_t preloaded;
+  uint32_t contention;
+};
+
+// Sets up the pool and registers the "imgcache" console command.
+void ImageCache_Init();
+
+// Assets the cache serves, kept by reference. Decodes the pinned ones. Call
+// before the scheduler starts or at the top of Qul_Thread.
+void ImageCache_SetAssets(const ImageAsset *assets, uint32_t count);
+uint32_t ImageCache_AssetCount();
+const ImageAsset &ImageCache_Asset(uint32_t index);
+
+// Makes the assets available to QML as image://cache/<name>.
+void ImageCache_Register(Qul::Application &app);
+
+const ImageAsset *ImageCache_Find(uint32_t id);
+const ImageAsset *ImageCache_FindByName(const char *name, size_t length);
+
+// Bytes per line of the decoded asset.
+uint32_t ImageCache_Stride(const ImageAsset &asset);
+
+// Decoded pixels of asset, decoding on a miss, referenced until
+// ImageCache_Release(). nullptr if it does not fit or fails to decode.
+const uint8_t *ImageCache_Acquire(const ImageAsset &asset);
+void ImageCache_Release(const ImageAsset &asset);
+
+// Decodes if needed and keeps the asset resident until unpinned.
+bool ImageCache_Pin(const ImageAsset &asset, bool pinned);
+
+enum class PreloadResult : uint8_t { Decoded, Cached, NoRoom, Failed };
+
+// Decodes the asset if it fits without evicting anything.
+PreloadResult ImageCache_Preload(const ImageAsset &asset);
+
+// Times a task had to wait for the cache lock.
+uint32_t ImageCache_Contention();
+
+void ImageCache_SetBudget(uint32_t bytes);
+void ImageCache_Flush();
+
+void ImageCache_GetStats(ImageCacheStats &out);
+void ImageCache_ResetStats();
+
+#endif // IMAGE_CACHE_H
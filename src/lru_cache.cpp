@@ -0,0 +1,203 @@
+#include "lru_cache.h"
+
+#include <string.h>
+
+static_assert(LRU_CACHE_MAX_ENTRIES <= 127, "slots are int8_t");
+
+static uint32_t alignUp(uint32_t value, uint32_t align) { return (value + align - 1U) / align * align; }
+
+void LruCache::init(uint32_t capacity, uint32_t budget, uint32_t align) {
+  *this = LruCache();
+  align_ = align != 0U ? align : 1U;
+  capacity_ = capacity / align_ * align_;
+  budget_ = budget < capacity_ ? budget : capacity_;
+}
+
+void LruCache::setBudget(uint32_t budget) {
+  budget_ = budget < capacity_ ? budget : capacity_;
+  while (used_ > budget_ && evictOne()) {
+  }
+}
+
+int LruCache::find(uint32_t key) const {
+  for (uint32_t i = 0; i < count_; i++) {
+    if (entries_[order_[i]].key == key) {
+      return order_[i];
+    }
+  }
+  return None;
+}
+
+int LruCache::lookup(uint32_t key) {
+  const int slot = find(key);
+  if (slot == None) {
+    misses_++;
+    return None;
+  }
+  hits_++;
+  if (slot != head_) {
+    unlink(slot);
+    pushFront(slot);
+  }
+  return slot;
+}
+
+int LruCache::freeSlot() const {
+  for (int i = 0; i < LRU_CACHE_MAX_ENTRIES; i++) {
+    if (!entries_[i].used) {
+      return i;
+    }
+  }
+  return None;
+}
+
+uint32_t LruCache::findGap(uint32_t bytes, uint32_t *position) const {
+  uint32_t start = 0;
+  for (uint32_t i = 0; i < count_; i++) {
+    const Entry &e = entries_[order_[i]];
+    if (e.offset - start >= bytes) {
+      *position = i;
+      return start;
+    }
+    start = e.offset + e.bytes;
+  }
+  *position = count_;
+  return capacity_ - start >= bytes ? start : capacity_;
+}
+
+bool LruCache::evictOne() {
+  for (int slot = tail_; slot != None; slot = entries_[slot].prev) {
+    if (evictable(slot)) {
+      remove(slot);
+      evictions_++;
+      return true;
+    }
+  }
+  return false;
+}
+
+int LruCache::insert(uint32_t key, uint32_t bytes, bool evict) {
+  bytes = alignUp(bytes != 0U ? bytes : 1U, align_);
+  if (bytes > budget_) {
+    rejected_++;
+    return None;
+  }
+  uint32_t position = 0;
+  uint32_t offset = capacity_;
+  while (true) {
+    if (used_ + bytes <= budget_ && count_ < LRU_CACHE_MAX_ENTRIES) {
+      offset = findGap(bytes, &position);
+      if (offset != capacity_) {
+        break;
+      }
+    }
+    if (!evict || !evictOne()) {
+      rejected_++;
+      return None;
+    }
+  }
+
+  const int slot = freeSlot();
+  Entry &e = entries_[slot];
+  e.key = key;
+  e.offset = offset;
+  e.bytes = bytes;
+  e.refs = 0;
+  e.used = true;
+  e.pinned = false;
+  memmove(&order_[position + 1U], &order_[position], count_ - position);
+  order_[position] = (int8_t)slot;
+  count_++;
+  pushFront(slot);
+  used_ += bytes;
+  highWater_ = used_ > highWater_ ? used_ : highWater_;
+  return slot;
+}
+
+void LruCache::remove(int slot) {
+  Entry &e = entries_[slot];
+  for (uint32_t i = 0; i < count_; i++) {
+    if (order_[i] == slot) {
+      memmove(&order_[i], &order_[i + 1U], count_ - i - 1U);
+      break;
+    }
+  }
+  count_--;
+  unlink(slot);
+  used_ -= e.bytes;
+  e.used = false;
+}
+
+void LruCache::evictAll() {
+  int slot = tail_;
+  while (slot != None) {
+    const int prev = entries_[slot].prev;
+    if (evictable(slot)) {
+      remove(slot);
+      evictions_++;
+    }
+    slot = prev;
+  }
+}
+
+void LruCache::release(int slot) {
+  if (entries_[slot].refs != 0U) {
+    entries_[slot].refs--;
+  }
+}
+
+void LruCache::pin(int slot, bool on) { entries_[slot].pinned = on; }
+
+void LruCache::unlink(int slot) {
+  Entry &e = entries_[slot];
+  if (e.prev != None) {
+    entries_[e.prev].next = e.next;
+  } else {
+    head_ = e.next;
+  }
+  if (e.next != None) {
+    entries_[e.next].prev = e.prev;
+  } else {
+    tail_ = e.prev;
+  }
+  e.prev = None;
+  e.next = None;
+}
+
+void LruCache::pushFront(int slot) {
+  Entry &e = entries_[slot];
+  e.prev = None;
+  e.next = head_;
+  if (head_ != None) {
+    entries_[head_].prev = (int8_t)slot;
+  } else {
+    tail_ = (int8_t)slot;
+  }
+  head_ = (int8_t)slot;
+}
+
+void LruCache::stats(LruCacheStats &out) const {
+  out = LruCacheStats();
+  out.hits = hits_;
+  out.misses = misses_;
+  out.evictions = evictions_;
+  out.rejected = rejected_;
+  out.entries = count_;
+  out.bytesUsed = used_;
+  out.bytesHighWater = highWater_;
+  for (uint32_t i = 0; i < count_; i++) {
+    const Entry &e = entries_[order_[i]];
+    if (e.pinned) {
+      out.pinned++;
+      out.bytesPinned += e.bytes;
+    }
+  }
+}
+
+void LruCache::resetStats() {
+  hits_ = 0;
+  misses_ = 0;
+  evictions_ = 0;
+  rejected_ = 0;
+  highWater_ = used_;
+}
@@ -0,0 +1,112 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <stdint.h>
+
+// Bookkeeping of a byte-budgeted cache of variable-sized blocks in one
+// arena, evicted least recently used first.
+//
+// The class only hands out offsets into an arena of capacity bytes; the
+// caller owns the memory and fills the blocks. Blocks are placed first fit in
+// the gaps between live blocks (kept sorted by offset), every block starting
+// and ending on align. insert() evicts from the cold end of the LRU list
+// until the budget has room and a gap fits: keeping the budget below the
+// capacity leaves slack, so a fitting gap usually exists without evicting
+// more than the budget requires.
+//
+// A block is never evicted while pinned or while it has references
+// (acquire/release), e.g. an image the UI is still showing. Keys are looked
+// up linearly, fine for LRU_CACHE_MAX_ENTRIES in the tens.
+//
+// Not thread safe; portable, so it builds on the host as well.
+
+#ifndef LRU_CACHE_MAX_ENTRIES
+#define LRU_CACHE_MAX_ENTRIES 64
+#endif
+
+struct LruCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t rejected; // inserts that found no room
+  uint32_t entries;
+  uint32_t pinned;
+  uint32_t bytesUsed;
+  uint32_t bytesPinned;
+  uint32_t bytesHighWater;
+};
+
+class LruCache {
+public:
+  static const int None = -1;
+
+  void init(uint32_t capacity, uint32_t budget, uint32_t align);
+
+  // Clamped to the capacity. Evicts down to the new budget where it can.
+  void setBudget(uint32_t budget);
+  uint32_t budget() const { return budget_; }
+  uint32_t capacity() const { return capacity_; }
+
+  // Slot of key, made most recently used, or None. Counts a hit or a miss.
+  int lookup(uint32_t key);
+  // Slot of key without touching the LRU order or the counters.
+  int find(uint32_t key) const;
+
+  // Places a new block of bytes for key (which must not be present) as most
+  // recently used. None if the budget or the arena cannot make room, or
+  // would have to evict something when evict is false.
+  int insert(uint32_t key, uint32_t bytes, bool evict = true);
+  void remove(int slot);
+  // Drops every block that is neither pinned nor referenced.
+  void evictAll();
+
+  uint32_t offset(int slot) const { return entries_[slot].offset; }
+  uint32_t bytes(int slot) const { return entries_[slot].bytes; }
+  uint32_t key(int slot) const { return entries_[slot].key; }
+
+  void acquire(int slot) { entries_[slot].refs++; }
+  void release(int slot);
+  void pin(int slot, bool on);
+  bool pinned(int slot) const { return entries_[slot].pinned; }
+
+  void stats(LruCacheStats &out) const;
+  void resetStats();
+
+private:
+  struct Entry {
+    uint32_t key;
+    uint32_t offset;
+    uint32_t bytes;
+    int8_t prev; // towards most recently used
+    int8_t next;
+    uint16_t refs;
+    bool used;
+    bool pinned;
+  };
+
+  bool evictable(int slot) const { return entries_[slot].refs == 0U && !entries_[slot].pinned; }
+  bool evictOne();
+  int freeSlot() const;
+  // Offset of the first gap of bytes, or capacity_ if there is none;
+  // *position receives its index in order_.
+  uint32_t findGap(uint32_t bytes, uint32_t *position) const;
+  void unlink(int slot);
+  void pushFront(int slot);
+
+  Entry entries_[LRU_CACHE_MAX_ENTRIES] = {};
+  int8_t order_[LRU_CACHE_MAX_ENTRIES] = {}; // live slots by offset
+  uint32_t count_ = 0;
+  int8_t head_ = None; // most recently used
+  int8_t tail_ = None;
+  uint32_t capacity_ = 0;
+  uint32_t budget_ = 0;
+  uint32_t align_ = 1;
+  uint32_t used_ = 0;
+  uint32_t highWater_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t evictions_ = 0;
+  uint32_t rejected_ = 0;
+};
+
+#endif // LRU_CACHE_H
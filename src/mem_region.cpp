@@ -0,0 +1,161 @@
+#include "mem_region.h"
+
+#include <FreeRTOS.h>
+#include <platforminterface/log.h>
+#include <portable.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "pool_allocator.h"
+
+// Address windows from the memoryBlocks of freertos_hello_cm7_v3_14.xml.
+static const uintptr_t DtcmBase = 0x20000000U;
+static const uintptr_t DtcmEnd = DtcmBase + 0x00040000U;
+static const uintptr_t OcramBase = 0x20240000U; // SRAM_OC1 + SRAM_OC2
+static const uintptr_t OcramEnd = 0x20300000U;
+
+// Placed by armgcc/mem_regions.ld.
+static uint8_t s_dtcmArena[MEM_REGION_DTCM_ARENA_SIZE]
+    __attribute__((section(".dtcm_heap"), aligned(32)));
+static uint8_t s_ocramArena[MEM_REGION_OCRAM_ARENA_SIZE]
+    __attribute__((section(".ocram_heap"), aligned(32)));
+
+static PoolAllocator s_dtcmHeap;
+static PoolAllocator s_ocramHeap;
+
+// Cycles per dependent load, times 100, indexed by Region.
+static uint32_t s_loadCost[3];
+
+static const size_t ChaseStride = 32; // one M7 cache line
+static const uint32_t ChaseLoads = 8192;
+
+// Links every cache line of buf into a single random cycle (Sattolo) and
+// times dependent loads through it, so neither the prefetcher nor the cache
+// can hide the latency of the memory behind buf.
+static uint32_t measureLoadCost(uint8_t *buf, size_t size) {
+  const size_t lines = size / ChaseStride;
+  if (lines < 2) {
+    return 0;
+  }
+  for (size_t i = 0; i < lines; i++) {
+    *reinterpret_cast<uintptr_t *>(buf + i * ChaseStride) = i;
+  }
+  uint32_t seed = 0x2545F491U;
+  for (size_t i = lines - 1; i > 0; i--) {
+    seed = seed * 1664525U + 1013904223U;
+    const size_t j = (seed >> 8) % i;
+    uintptr_t *a = reinterpret_cast<uintptr_t *>(buf + i * ChaseStride);
+    uintptr_t *b = reinterpret_cast<uintptr_t *>(buf + j * ChaseStride);
+    const uintptr_t t = *a;
+    *a = *b;
+    *b = t;
+  }
+  for (size_t i = 0; i < lines; i++) {
+    uintptr_t *slot = reinterpret_cast<uintptr_t *>(buf + i * ChaseStride);
+    *slot = reinterpret_cast<uintptr_t>(buf + *slot * ChaseStride);
+  }
+  SCB_CleanInvalidateDCache();
+
+  void *volatile *p = reinterpret_cast<void *volatile *>(buf);
+  const uint32_t start = CycleCounter_Read();
+  for (uint32_t n = 0; n < ChaseLoads; n++) {
+    p = static_cast<void *volatile *>(*p);
+  }
+  const uint32_t cycles = CycleCounter_Read() - start;
+  return static_cast<uint32_t>((static_cast<uint64_t>(cycles) * 100U) / ChaseLoads);
+}
+
+static void initRegionHeap(PoolAllocator &heap, uint8_t *arena, size_t size,
+                           Region region, size_t chaseSize) {
+  if (MemRegion_Of(arena) != region) {
+    Qul::PlatformInterface::log("%s arena at %p is outside %s, heap disabled\r\n",
+                                MemRegion_Name(region), arena, MemRegion_Name(region));
+    return;
+  }
+  s_loadCost[static_cast<int>(region)] =
+      measureLoadCost(arena, chaseSize < size ? chaseSize : size);
+  heap.init(arena, size);
+}
+
+static void memlatCommand(const char *args) {
+  (void)args;
+  MemRegion_ReportLatency();
+}
+
+void MemRegion_Init() {
+  CycleCounter_Init();
+  DebugConsole_Register("memlat", "per-region load latency", memlatCommand);
+  // Chase sets larger than the 32 KB D-cache for the cached regions.
+  initRegionHeap(s_dtcmHeap, s_dtcmArena, sizeof(s_dtcmArena), Region::Dtcm, 32 * 1024);
+  initRegionHeap(s_ocramHeap, s_ocramArena, sizeof(s_ocramArena), Region::Ocram, 128 * 1024);
+
+  const size_t sdramChase = 256 * 1024;
+  uint8_t *scratch = static_cast<uint8_t *>(pvPortMalloc(sdramChase));
+  if (scratch != NULL) {
+    s_loadCost[static_cast<int>(Region::Sdram)] = measureLoadCost(scratch, sdramChase);
+    vPortFree(scratch);
+  }
+}
+
+void *MemRegion_Alloc(Region region, size_t size) {
+  PoolAllocator *heap = region == Region::Dtcm ? &s_dtcmHeap : region == Region::Ocram ? &s_ocramHeap : nullptr;
+  if (heap == nullptr) {
+    return nullptr;
+  }
+  // The region heaps are not synchronized themselves.
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  void *p = heap->allocate(size);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+  return p;
+}
+
+bool MemRegion_Free(void *p) {
+  PoolAllocator *heap = s_dtcmHeap.owns(p) ? &s_dtcmHeap : s_ocramHeap.owns(p) ? &s_ocramHeap : nullptr;
+  if (heap == nullptr) {
+    return false;
+  }
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  heap->deallocate(p);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+  return true;
+}
+
+Region MemRegion_Of(const void *p) {
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(p);
+  if (addr >= DtcmBase && addr < DtcmEnd) {
+    return Region::Dtcm;
+  }
+  if (addr >= OcramBase && addr < OcramEnd) {
+    return Region::Ocram;
+  }
+  return Region::Sdram;
+}
+
+const char *MemRegion_Name(Region region) {
+  switch (region) {
+  case Region::Dtcm:
+    return "DTCM";
+  case Region::Ocram:
+    return "OCRAM";
+  default:
+    return "SDRAM";
+  }
+}
+
+void MemRegion_ReportLatency() {
+  for (int i = 0; i < 3; i++) {
+    Qul::PlatformInterface::log("%-6s %u.%02u cycles/load\r\n",
+                                MemRegion_Name(static_cast<Region>(i)),
+                                (unsigned)(s_loadCost[i] / 100), (unsigned)(s_loadCost[i] % 100));
+  }
+}
+
+void *operator new(size_t size, Region region) {
+  void *p = MemRegion_Alloc(region, size);
+  return p != nullptr ? p : ::operator new(size);
+}
+
+void *operator new[](size_t size, Region region) {
+  void *p = MemRegion_Alloc(region, size);
+  return p != nullptr ? p : ::operator new[](size);
+}
@@ -0,0 +1,54 @@
+#ifndef MEM_REGION_H
+#define MEM_REGION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Placement-tagged allocation.
+//
+//   auto *filter = new (Region::Dtcm) SpeedFilter();
+//
+// Dtcm and Ocram are served by small size-class heaps (blocks up to
+// PoolAllocator::MaxBlockSize) carved from arenas in those memories. When a
+// region heap cannot satisfy a request the object silently lands in the
+// default SDRAM heap instead, so callers never see a failure that plain new
+// would not have produced. Objects are released with plain delete.
+
+enum class Region : uint8_t {
+  Dtcm,  // 256 KB tightly coupled, zero wait state, not cached
+  Ocram, // 768 KB on-chip, cached
+  Sdram, // 64 MB external, cached; the default heap
+};
+
+/* Placed at the start of DTCM by armgcc/mem_regions.ld. */
+#ifndef MEM_REGION_DTCM_ARENA_SIZE
+#define MEM_REGION_DTCM_ARENA_SIZE (64 * 1024)
+#endif
+
+/* Must match armgcc/mem_regions.ld. */
+#ifndef MEM_REGION_OCRAM_ARENA_SIZE
+#define MEM_REGION_OCRAM_ARENA_SIZE (256 * 1024)
+#endif
+
+// Sets up the region heaps and measures per-region access latency. Call from
+// main() before the first new(Region).
+void MemRegion_Init();
+
+// nullptr if the region heap cannot serve the request.
+void *MemRegion_Alloc(Region region, size_t size);
+
+// Returns false if p does not belong to a region heap.
+bool MemRegion_Free(void *p);
+
+// Region p lives in, judged by address.
+Region MemRegion_Of(const void *p);
+
+const char *MemRegion_Name(Region region);
+
+// Logs the cycles per dependent load measured by MemRegion_Init.
+void MemRegion_ReportLatency();
+
+void *operator new(size_t size, Region region);
+void *operator new[](size_t size, Region region);
+
+#endif // MEM_REGION_H
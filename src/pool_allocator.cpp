@@ -0,0 +1,86 @@
+#include "pool_allocator.h"
+
+#include <string.h>
+
+static const uint16_t s_classSizes[PoolAllocator::ClassCount] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+// Size class for a request, indexed by (size + 15) / 16.
+static const uint8_t s_classForSize[PoolAllocator::MaxBlockSize / 16 + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+    8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9};
+
+static const uint8_t NoClass = 0xFF;
+
+size_t PoolAllocator::classSize(size_t cls) { return s_classSizes[cls]; }
+
+void PoolAllocator::init(void *base, size_t size) {
+  uint8_t *start = static_cast<uint8_t *>(base);
+  const size_t maxPages = size / PageSize;
+
+  // The page -> class map lives at the front of the arena itself.
+  pageClass_ = start;
+  memset(pageClass_, NoClass, maxPages);
+  firstPage_ = start + ((maxPages + 31) & ~static_cast<size_t>(31));
+  pageCount_ = (start + size - firstPage_) / PageSize;
+  end_ = firstPage_ + pageCount_ * PageSize;
+  nextPage_ = 0;
+}
+
+PoolAllocator::FreeBlock *PoolAllocator::carve(uint8_t cls) {
+  const size_t blockSize = s_classSizes[cls];
+  if (static_cast<size_t>(carveEnd_[cls] - carveNext_[cls]) < blockSize) {
+    if (nextPage_ == pageCount_) {
+      return nullptr;
+    }
+    pageClass_[nextPage_] = cls;
+    carveNext_[cls] = firstPage_ + nextPage_ * PageSize;
+    carveEnd_[cls] = carveNext_[cls] + PageSize;
+    nextPage_++;
+  }
+  FreeBlock *block = reinterpret_cast<FreeBlock *>(carveNext_[cls]);
+  carveNext_[cls] += blockSize;
+  return block;
+}
+
+void *PoolAllocator::allocate(size_t size) {
+  if (size > MaxBlockSize || pageCount_ == 0) {
+    return nullptr;
+  }
+  const uint8_t cls = s_classForSize[(size + 15) >> 4];
+  FreeBlock *block = freeLists_[cls];
+  if (block != nullptr) {
+    freeLists_[cls] = block->next;
+  } else {
+    block = carve(cls);
+  }
+  if (block != nullptr) {
+    inUse_[cls]++;
+    bytes_ += s_classSizes[cls];
+    peakBytes_ = bytes_ > peakBytes_ ? bytes_ : peakBytes_;
+  }
+  return block;
+}
+
+void PoolAllocator::deallocate(void *p) {
+  const size_t page = (static_cast<uint8_t *>(p) - firstPage_) / PageSize;
+  const uint8_t cls = pageClass_[page];
+  FreeBlock *block = static_cast<FreeBlock *>(p);
+  block->next = freeLists_[cls];
+  freeLists_[cls] = block;
+  inUse_[cls]--;
+  bytes_ -= s_classSizes[cls];
+}
+
+size_t PoolAllocator::blockSize(const void *p) const {
+  const size_t page = (static_cast<const uint8_t *>(p) - firstPage_) / PageSize;
+  return s_classSizes[pageClass_[page]];
+}
+
+void PoolAllocator::stats(Stats &out) const {
+  out.pagesUsed = nextPage_;
+  out.pagesTotal = pageCount_;
+  memcpy(out.blocksInUse, inUse_, sizeof(inUse_));
+  out.bytesInUse = bytes_;
+  out.peakBytes = peakBytes_;
+}
@@ -0,0 +1,72 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Segregated size-class allocator for small blocks.
+//
+// The arena handed to init() is split into 4 KB pages. A page is assigned to
+// one size class the first time that class runs dry and is then carved into
+// equally sized blocks on demand. Freed blocks go onto the per-class free
+// list, so both allocate() and deallocate() are O(1). Pages are never handed
+// back to another class.
+//
+// Requests larger than MaxBlockSize, or made after the arena is exhausted,
+// return nullptr and the caller falls back to another heap.
+//
+// The allocator takes no locks and depends on nothing but the C library, so
+// it builds on the host (tools/alloc_replay.cpp). Callers that share an
+// instance between tasks or ISRs serialize the calls themselves.
+class PoolAllocator {
+public:
+  static constexpr size_t PageSize = 4096;
+  static constexpr size_t MaxBlockSize = 512;
+  static constexpr size_t ClassCount = 10;
+
+  struct Stats {
+    size_t pagesUsed;
+    size_t pagesTotal;
+    uint32_t blocksInUse[ClassCount];
+    size_t bytesInUse; // block sizes, not requested sizes
+    size_t peakBytes;  // highest bytesInUse since init()
+  };
+
+  void init(void *base, size_t size);
+  bool ready() const { return pageCount_ != 0; }
+
+  void *allocate(size_t size);
+  void deallocate(void *p);
+
+  bool owns(const void *p) const {
+    return p >= firstPage_ && p < end_;
+  }
+
+  // Usable size of a block returned by allocate().
+  size_t blockSize(const void *p) const;
+
+  void stats(Stats &out) const;
+
+  static size_t classSize(size_t cls);
+
+private:
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  FreeBlock *carve(uint8_t cls);
+
+  FreeBlock *freeLists_[ClassCount] = {};
+  uint8_t *carveNext_[ClassCount] = {};
+  uint8_t *carveEnd_[ClassCount] = {};
+  uint32_t inUse_[ClassCount] = {};
+  size_t bytes_ = 0;
+  size_t peakBytes_ = 0;
+  uint8_t *pageClass_ = nullptr;
+  uint8_t *firstPage_ = nullptr;
+  uint8_t *end_ = nullptr;
+  size_t pageCount_ = 0;
+  size_t nextPage_ = 0;
+};
+
+#endif // POOL_ALLOCATOR_H
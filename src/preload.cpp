@@ -0,0 +1,120 @@
+#include "preload.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <platforminterface/log.h>
+#include <task.h>
+
+#include "boot_trace.h"
+#include "debug_console.h"
+#include "image_cache.h"
+
+struct PreloadItem {
+  const char *name;
+  PreloadFn fn;
+  void *arg;
+};
+
+static PreloadItem s_items[PRELOAD_MAX_ITEMS];
+static uint32_t s_itemCount;
+
+static std::atomic<bool> s_cancel{false};
+static std::atomic<bool> s_finished{false};
+
+// Written by the preload task; the console reads it under vTaskSuspendAll.
+static PreloadStats s_stats;
+
+bool Preload_Add(const char *name, PreloadFn fn, void *arg) {
+  if (s_itemCount == PRELOAD_MAX_ITEMS) {
+    return false;
+  }
+  s_items[s_itemCount++] = PreloadItem{name, fn, arg};
+  return true;
+}
+
+// Waits while the UI keeps running into the cache lock. seen is the
+// contention count the previous wait ended at.
+static void backOff(uint32_t &seen) {
+  while (!s_cancel.load(std::memory_order_relaxed)) {
+    const uint32_t contention = ImageCache_Contention();
+    if (contention == seen) {
+      return;
+    }
+    seen = contention;
+    s_stats.backoffs++;
+    vTaskDelay(pdMS_TO_TICKS(PRELOAD_BACKOFF_MS));
+  }
+}
+
+void Preload_Run() {
+  const TickType_t start = xTaskGetTickCount();
+  uint32_t seen = ImageCache_Contention();
+  for (uint32_t i = 0; i < ImageCache_AssetCount() && !s_cancel.load(std::memory_order_relaxed); i++) {
+    const ImageAsset &asset = ImageCache_Asset(i);
+    if (!asset.preload) {
+      continue;
+    }
+    backOff(seen);
+    switch (ImageCache_Preload(asset)) {
+    case PreloadResult::Decoded:
+      s_stats.decoded++;
+      break;
+    case PreloadResult::Cached:
+      s_stats.cached++;
+      break;
+    case PreloadResult::NoRoom:
+      s_stats.noRoom++;
+      break;
+    case PreloadResult::Failed:
+      s_stats.failed++;
+      Qul::PlatformInterface::log("Preloading image %s failed\r\n", asset.name);
+      break;
+    }
+  }
+  for (uint32_t i = 0; i < s_itemCount && !s_cancel.load(std::memory_order_relaxed); i++) {
+    backOff(seen);
+    s_stats.items++;
+    if (!s_items[i].fn(s_items[i].arg)) {
+      s_stats.failed++;
+      Qul::PlatformInterface::log("Preloading %s failed\r\n", s_items[i].name);
+    }
+  }
+  s_stats.elapsedMs = (uint32_t)((xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+  s_stats.cancelled = s_cancel.load(std::memory_order_relaxed);
+  s_finished.store(true, std::memory_order_release);
+  BootTrace_Mark(BootMark::PreloadDone);
+}
+
+void Preload_Cancel() { s_cancel.store(true, std::memory_order_relaxed); }
+
+bool Preload_Finished() { return s_finished.load(std::memory_order_acquire); }
+
+void Preload_GetStats(PreloadStats &out) {
+  vTaskSuspendAll();
+  out = s_stats;
+  (void)xTaskResumeAll();
+  out.finished = Preload_Finished();
+}
+
+static void preloadCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "cancel")) {
+    Preload_Cancel();
+  }
+  PreloadStats stats;
+  Preload_GetStats(stats);
+  if (!stats.finished) {
+    Qul::PlatformInterface::log("Preload running%s\r\n", s_cancel.load(std::memory_order_relaxed) ? ", cancelling" : "");
+  } else {
+    Qul::PlatformInterface::log("Preload %s in %u ms\r\n", stats.cancelled ? "cancelled" : "finished",
+                                (unsigned)stats.elapsedMs);
+  }
+  Qul::PlatformInterface::log("  images: %u decoded, %u already cached, %u did not fit; %u other items\r\n",
+                              (unsigned)stats.decoded, (unsigned)stats.cached, (unsigned)stats.noRoom,
+                              (unsigned)stats.items);
+  Qul::PlatformInterface::log("  %u failed, backed off %u times for the UI\r\n", (unsigned)stats.failed,
+                              (unsigned)stats.backoffs);
+}
+
+void Preload_Init() {
+  DebugConsole_Register("preload", "boot-time asset preloading [cancel]", preloadCommand);
+}
@@ -0,0 +1,78 @@
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include <stdint.h>
+
+/*
+ * Boot-time asset preloader.
+ *
+ * Preload_Run() runs on its own task, created in main() next to Qul_Thread at
+ * PRELOAD_TASK_PRIORITY, just above idle, so it only gets the CPU while
+ * Qul_Thread sleeps between frames of the splash screen. It decodes every
+ * image asset marked preload (image_cache.h), in table order, into the image
+ * cache, then runs the items added with Preload_Add(). The assets come from
+ * the boot manifest (asset_manifest.h). Fonts are not warmed here: the
+ * manifest's fonts are prewarmed on the Qul thread (GlyphCache_Prewarm),
+ * since the font engine is not thread safe, and a Preload_Add() callback
+ * must only touch caches of its own.
+ *
+ * The task stays out of the UI's way:
+ *  - preloading never evicts; an image that does not fit is skipped;
+ *  - a decode holds the image cache's mutex, whose priority inheritance makes
+ *    the preloader finish at the Qul thread's priority when the UI needs the
+ *    cache at that moment;
+ *  - when the UI had to wait for the cache since the previous item, it is
+ *    busy loading a screen: the preloader backs off PRELOAD_BACKOFF_MS, for
+ *    as long as that keeps happening;
+ *  - Preload_Cancel() ("preload cancel") stops it after the current item.
+ *
+ * When it is done it marks BootMark::PreloadDone; the first frame after that
+ * is the first interactive one (boot_trace.h). "preload" on the console
+ * prints what it did.
+ */
+
+#ifndef PRELOAD_TASK_PRIORITY
+#define PRELOAD_TASK_PRIORITY 1
+#endif
+
+#ifndef PRELOAD_STACK_DEPTH
+#define PRELOAD_STACK_DEPTH 1024
+#endif
+
+#ifndef PRELOAD_BACKOFF_MS
+#define PRELOAD_BACKOFF_MS 20
+#endif
+
+#ifndef PRELOAD_MAX_ITEMS
+#define PRELOAD_MAX_ITEMS 8
+#endif
+
+// Returns false if the item could not be loaded.
+typedef bool (*PreloadFn)(void *arg);
+
+struct PreloadStats {
+  uint32_t decoded;
+  uint32_t cached;  // already resident, e.g. pinned
+  uint32_t noRoom;  // skipped rather than evict
+  uint32_t failed;  // images and items
+  uint32_t items;
+  uint32_t backoffs;
+  uint32_t elapsedMs;
+  bool finished;
+  bool cancelled;
+};
+
+// Registers the "preload" console command. Call before the scheduler starts.
+void Preload_Init();
+
+// Before the scheduler starts. false once PRELOAD_MAX_ITEMS are registered.
+bool Preload_Add(const char *name, PreloadFn fn, void *arg);
+
+// Body of the preload task; returns when done or cancelled.
+void Preload_Run();
+
+void Preload_Cancel();
+bool Preload_Finished();
+void Preload_GetStats(PreloadStats &out);
+
+#endif // PRELOAD_H
@@ -0,0 +1,173 @@
+#include "profiler.h"
+
+#include <atomic>
+#include <stdio.h>
+
+#include "spsc_ring.h"
+
+#if PROFILER_HOST
+#define PROFILER_LOG(...) printf(__VA_ARGS__)
+#else
+#include <FreeRTOS.h>
+#include <platforminterface/log.h>
+#include <task.h>
+
+#include "debug_console.h"
+
+#define PROFILER_LOG(...) Qul::PlatformInterface::log(__VA_ARGS__)
+#endif
+
+struct ProfileRing {
+  SpscRing<ProfileEvent, PROFILER_RING_DEPTH> events;
+  const char *owner;
+};
+
+static ProfileRing s_rings[PROFILER_MAX_RINGS];
+static std::atomic<size_t> s_ringCount{0};
+static std::atomic<bool> s_recording{false};
+
+bool Profiler_Recording() { return s_recording.load(std::memory_order_relaxed); }
+
+#if PROFILER_HOST
+
+static thread_local ProfileRing *t_ring;
+static thread_local bool t_claimed;
+
+static ProfileRing *currentRing() {
+  if (!t_claimed) {
+    t_claimed = true;
+    const size_t index = s_ringCount.fetch_add(1, std::memory_order_relaxed);
+    if (index < PROFILER_MAX_RINGS) {
+      s_rings[index].owner = "thread";
+      t_ring = &s_rings[index];
+    }
+  }
+  return t_ring;
+}
+
+void Profiler_Record(const char *name, uint32_t begin, uint32_t end) {
+  ProfileRing *ring = currentRing();
+  if (ring != nullptr) {
+    (void)ring->events.push(ProfileEvent{name, begin, end});
+  }
+}
+
+static uint32_t timerHz() { return 1000000000U; }
+
+#else
+
+// Shared by every ISR and by code that runs before the scheduler starts.
+static ProfileRing s_isrRing = {{}, "isr/boot"};
+static char s_noRing; // marks a task that found no free ring
+
+static ProfileRing *claimRing() {
+  ProfileRing *ring = nullptr;
+  taskENTER_CRITICAL();
+  const size_t index = s_ringCount.load(std::memory_order_relaxed);
+  if (index < PROFILER_MAX_RINGS) {
+    ring = &s_rings[index];
+    ring->owner = pcTaskGetName(NULL);
+    s_ringCount.store(index + 1, std::memory_order_release);
+  }
+  vTaskSetThreadLocalStoragePointer(NULL, PROFILER_TLS_INDEX,
+                                    ring != nullptr ? (void *)ring : (void *)&s_noRing);
+  taskEXIT_CRITICAL();
+  return ring;
+}
+
+void Profiler_Record(const char *name, uint32_t begin, uint32_t end) {
+  if (__get_IPSR() != 0U || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    (void)s_isrRing.events.push(ProfileEvent{name, begin, end});
+    __set_PRIMASK(primask);
+    return;
+  }
+  void *slot = pvTaskGetThreadLocalStoragePointer(NULL, PROFILER_TLS_INDEX);
+  ProfileRing *ring = slot == &s_noRing ? nullptr
+                      : slot != NULL    ? static_cast<ProfileRing *>(slot)
+                                        : claimRing();
+  if (ring != nullptr) {
+    (void)ring->events.push(ProfileEvent{name, begin, end});
+  }
+}
+
+static uint32_t timerHz() { return SystemCoreClock; }
+
+#endif /* PROFILER_HOST */
+
+/*
+ * Dump format, one record per line:
+ *   PRF hz <timer Hz>
+ *   PRF T <ring> <owner> <dropped>
+ *   PRF E <ring> <age> <duration> <name>
+ *   PRF .
+ * age is how long before the dump the zone began, in timer ticks.
+ */
+static void dumpRing(size_t index, ProfileRing &ring, uint32_t now) {
+  PROFILER_LOG("PRF T %u %s %u\r\n", (unsigned)index, ring.owner, (unsigned)ring.events.dropped());
+  ring.events.drain([index, now](const ProfileEvent &event) {
+    PROFILER_LOG("PRF E %u %ld %lu %s\r\n", (unsigned)index, (long)(int32_t)(now - event.begin),
+                 (unsigned long)(event.end - event.begin), event.name);
+  });
+}
+
+void Profiler_Dump() {
+  const uint32_t now = Profiler_Now();
+  PROFILER_LOG("PRF hz %lu\r\n", (unsigned long)timerHz());
+  size_t count = s_ringCount.load(std::memory_order_acquire);
+  if (count > PROFILER_MAX_RINGS) {
+    count = PROFILER_MAX_RINGS;
+  }
+  for (size_t i = 0; i < count; i++) {
+    dumpRing(i, s_rings[i], now);
+  }
+#if !PROFILER_HOST
+  dumpRing(count, s_isrRing, now);
+#endif
+  PROFILER_LOG("PRF .\r\n");
+}
+
+static void clearRings() {
+  const size_t count = s_ringCount.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count && i < PROFILER_MAX_RINGS; i++) {
+    s_rings[i].events.drain([](const ProfileEvent &) {});
+  }
+#if !PROFILER_HOST
+  s_isrRing.events.drain([](const ProfileEvent &) {});
+#endif
+}
+
+void Profiler_SetRecording(bool on) {
+  if (on) {
+    clearRings();
+  }
+  s_recording.store(on, std::memory_order_relaxed);
+}
+
+#if PROFILER_HOST
+
+void Profiler_Init() {}
+
+#else
+
+static void profCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "on")) {
+    Profiler_SetRecording(true);
+  } else if (DebugConsole_ArgIs(args, "off")) {
+    Profiler_SetRecording(false);
+  } else if (DebugConsole_ArgIs(args, "clear")) {
+    clearRings();
+  } else if (DebugConsole_ArgIs(args, "dump")) {
+    Profiler_Dump();
+  } else {
+    PROFILER_LOG("profiler %s, %u task rings\r\n", Profiler_Recording() ? "recording" : "stopped",
+                 (unsigned)s_ringCount.load(std::memory_order_relaxed));
+  }
+}
+
+void Profiler_Init() {
+  DebugConsole_Register("prof", "zone profiler [on|off|dump|clear]", profCommand);
+}
+
+#endif /* PROFILER_HOST */
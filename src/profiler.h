@@ -0,0 +1,113 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Scoped hot-path profiler.
+//
+//   void SignalBridge_Drain() {
+//     PROFILE_ZONE("SignalBridge_Drain");
+//     ...
+//   }
+//
+// A zone stores one {name, begin, end} event when it goes out of scope, into
+// a lock-free ring owned by the calling task (found through a FreeRTOS
+// thread-local storage slot, claimed on first use). Zones opened from an ISR
+// share one extra ring, pushed with interrupts masked. Recording is off until
+// "prof on"; "prof dump" drains every ring to the console and
+// tools/prof2trace.py turns the dump into Chrome trace-event JSON
+// (chrome://tracing, ui.perfetto.dev).
+//
+// On the M7 timestamps are raw 32-bit CYCCNT values and a dump reports each
+// zone relative to the moment of the dump, so a capture covers the last ~4 s
+// at 996 MHz. On a Linux host the same code builds against std::chrono
+// (nanoseconds) and thread_local instead of FreeRTOS, and Profiler_Dump
+// writes to stdout.
+//
+// Names must be string literals (or otherwise outlive the dump). Build with
+// PROFILER_ENABLED=0 to compile every zone out.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#if defined(__linux__) && !defined(__arm__)
+#define PROFILER_HOST 1
+#else
+#define PROFILER_HOST 0
+#endif
+
+/* Events per ring, must be a power of two. */
+#ifndef PROFILER_RING_DEPTH
+#define PROFILER_RING_DEPTH 256
+#endif
+
+/* Tasks that can record at the same time; later tasks are not profiled. */
+#ifndef PROFILER_MAX_RINGS
+#define PROFILER_MAX_RINGS 8
+#endif
+
+/* Thread-local storage slot holding a task's ring. */
+#ifndef PROFILER_TLS_INDEX
+#define PROFILER_TLS_INDEX 4
+#endif
+
+struct ProfileEvent {
+  const char *name;
+  uint32_t begin;
+  uint32_t end;
+};
+
+#if PROFILER_HOST
+#include <chrono>
+
+static inline uint32_t Profiler_Now() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+#else
+#include "cycle_counter.h"
+
+static inline uint32_t Profiler_Now() { return CycleCounter_Read(); }
+#endif
+
+bool Profiler_Recording();
+void Profiler_Record(const char *name, uint32_t begin, uint32_t end);
+
+// Drains every ring as "PRF ..." lines. Also registered as "prof dump".
+void Profiler_Dump();
+void Profiler_SetRecording(bool on);
+
+// Registers the "prof [on|off|dump|clear]" console command.
+void Profiler_Init();
+
+class ProfileZone {
+public:
+  explicit ProfileZone(const char *name)
+      : name_(name), active_(Profiler_Recording()), begin_(active_ ? Profiler_Now() : 0) {}
+  ~ProfileZone() {
+    if (active_) {
+      Profiler_Record(name_, begin_, Profiler_Now());
+    }
+  }
+
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+  const char *name_;
+  bool active_;
+  uint32_t begin_;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
+
+#endif // PROFILER_H
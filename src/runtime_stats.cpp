@@ -0,0 +1,208 @@
+#include "runtime_stats.h"
+
+#include <FreeRTOS.h>
+#include <platforminterface/log.h>
+#include <string.h>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "static_alloc.h"
+
+struct TaskCpu {
+  UBaseType_t number;
+  UBaseType_t priority;
+  eTaskState state;
+  char name[configMAX_TASK_NAME_LEN];
+  uint64_t cycles;
+  uint32_t stackFree; // words
+};
+
+struct TaskTotal {
+  UBaseType_t number;
+  uint64_t cycles;
+};
+
+static TaskStorage<768> s_task APP_STATIC_STORAGE;
+
+static uint32_t s_counterHigh;
+static uint32_t s_counterLast;
+
+// Written by the stats task only.
+static TaskStatus_t s_status[RUNTIME_STATS_MAX_TASKS];
+static TaskTotal s_previous[RUNTIME_STATS_MAX_TASKS];
+static size_t s_previousCount;
+static uint64_t s_previousTotal;
+
+// Last completed window, copied out under a critical section.
+static TaskCpu s_window[RUNTIME_STATS_MAX_TASKS];
+static size_t s_windowCount;
+static uint64_t s_windowCycles;
+
+static bool s_watch;
+
+extern "C" void RunTimeStats_InitCounter(void) { CycleCounter_Init(); }
+
+extern "C" uint64_t RunTimeStats_ReadCounter(void) {
+  const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  const uint32_t now = CycleCounter_Read();
+  if (now < s_counterLast) {
+    s_counterHigh++;
+  }
+  s_counterLast = now;
+  const uint64_t value = ((uint64_t)s_counterHigh << 32) | now;
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+  return value;
+}
+
+static uint64_t previousCycles(UBaseType_t number) {
+  for (size_t i = 0; i < s_previousCount; i++) {
+    if (s_previous[i].number == number) {
+      return s_previous[i].cycles;
+    }
+  }
+  return 0;
+}
+
+static void sampleWindow() {
+  configRUN_TIME_COUNTER_TYPE total = 0;
+  const UBaseType_t count = uxTaskGetSystemState(s_status, RUNTIME_STATS_MAX_TASKS, &total);
+
+  TaskCpu window[RUNTIME_STATS_MAX_TASKS];
+  for (UBaseType_t i = 0; i < count; i++) {
+    const TaskStatus_t &status = s_status[i];
+    TaskCpu &entry = window[i];
+    entry.number = status.xTaskNumber;
+    entry.priority = status.uxCurrentPriority;
+    entry.state = status.eCurrentState;
+    strncpy(entry.name, status.pcTaskName, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entry.cycles = status.ulRunTimeCounter - previousCycles(status.xTaskNumber);
+    entry.stackFree = status.usStackHighWaterMark;
+  }
+  for (UBaseType_t i = 0; i < count; i++) {
+    s_previous[i].number = s_status[i].xTaskNumber;
+    s_previous[i].cycles = s_status[i].ulRunTimeCounter;
+  }
+  s_previousCount = count;
+
+  taskENTER_CRITICAL();
+  memcpy(s_window, window, count * sizeof(TaskCpu));
+  s_windowCount = count;
+  s_windowCycles = total - s_previousTotal;
+  taskEXIT_CRITICAL();
+  s_previousTotal = total;
+}
+
+static size_t copyWindow(TaskCpu *out, uint64_t &cycles) {
+  taskENTER_CRITICAL();
+  const size_t count = s_windowCount;
+  memcpy(out, s_window, count * sizeof(TaskCpu));
+  cycles = s_windowCycles;
+  taskEXIT_CRITICAL();
+  return count;
+}
+
+void RunTimeStats_Report() {
+  TaskCpu window[RUNTIME_STATS_MAX_TASKS];
+  uint64_t cycles;
+  const size_t count = copyWindow(window, cycles);
+  if (cycles == 0) {
+    return;
+  }
+  Qul::PlatformInterface::log("task                 prio   cpu%%    stack free\r\n");
+  for (size_t i = 0; i < count; i++) {
+    const uint32_t permille = (uint32_t)(window[i].cycles * 1000U / cycles);
+    Qul::PlatformInterface::log("%-20s %4u %3u.%u%% %8u\r\n", window[i].name,
+                                (unsigned)window[i].priority, (unsigned)(permille / 10),
+                                (unsigned)(permille % 10), (unsigned)window[i].stackFree);
+  }
+}
+
+/*
+ * Binary record, little endian:
+ *   "RTS1" u8 version u8 count u16 0 u32 cpuHz u64 windowCycles
+ *   count x { u8 number u8 priority u8 state u8 nameLength name u64 cycles u32 stackFree }
+ *   u32 FNV-1a over everything before it
+ * printed as "RTS <hex>" lines followed by "RTS .".
+ */
+static size_t put(uint8_t *buf, size_t at, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    buf[at + i] = (uint8_t)(value >> (8 * i));
+  }
+  return at + bytes;
+}
+
+void RunTimeStats_ExportBinary() {
+  TaskCpu window[RUNTIME_STATS_MAX_TASKS];
+  uint64_t cycles;
+  const size_t count = copyWindow(window, cycles);
+
+  static uint8_t record[24 + RUNTIME_STATS_MAX_TASKS * (16 + configMAX_TASK_NAME_LEN)];
+  size_t at = 0;
+  memcpy(record, "RTS1", 4);
+  at = put(record, 4, 1, 1);
+  at = put(record, at, count, 1);
+  at = put(record, at, 0, 2);
+  at = put(record, at, SystemCoreClock, 4);
+  at = put(record, at, cycles, 8);
+  for (size_t i = 0; i < count; i++) {
+    const size_t nameLength = strlen(window[i].name);
+    at = put(record, at, window[i].number, 1);
+    at = put(record, at, window[i].priority, 1);
+    at = put(record, at, (uint8_t)window[i].state, 1);
+    at = put(record, at, nameLength, 1);
+    memcpy(record + at, window[i].name, nameLength);
+    at += nameLength;
+    at = put(record, at, window[i].cycles, 8);
+    at = put(record, at, window[i].stackFree, 4);
+  }
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < at; i++) {
+    hash = (hash ^ record[i]) * 16777619U;
+  }
+  at = put(record, at, hash, 4);
+
+  static const char digits[] = "0123456789abcdef";
+  char line[2 * 32 + 1];
+  for (size_t offset = 0; offset < at; offset += 32) {
+    size_t n = 0;
+    for (size_t i = offset; i < at && i < offset + 32; i++) {
+      line[n++] = digits[record[i] >> 4];
+      line[n++] = digits[record[i] & 0xF];
+    }
+    line[n] = '\0';
+    Qul::PlatformInterface::log("RTS %s\r\n", line);
+  }
+  Qul::PlatformInterface::log("RTS .\r\n");
+}
+
+static void cpuCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "bin")) {
+    RunTimeStats_ExportBinary();
+  } else if (DebugConsole_ArgIs(args, "watch")) {
+    s_watch = strstr(args, "on") != NULL;
+  } else {
+    RunTimeStats_Report();
+  }
+}
+
+static void RunTimeStats_Thread(void *argument) {
+  (void)argument;
+  TickType_t lastWake = xTaskGetTickCount();
+  while (true) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(RUNTIME_STATS_PERIOD_MS));
+    sampleWindow();
+    if (s_watch) {
+      RunTimeStats_Report();
+    }
+  }
+}
+
+void RunTimeStats_Start(UBaseType_t priority) {
+  DebugConsole_Register("cpu", "per-task CPU share [bin|watch on|watch off]", cpuCommand);
+  if (s_task.create(RunTimeStats_Thread, "RunTimeStats", 0, priority) != pdPASS) {
+    Qul::PlatformInterface::log("Task creation failed!.\r\n");
+    configASSERT(false);
+  }
+}
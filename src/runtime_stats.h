@@ -0,0 +1,48 @@
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include <stdint.h>
+
+/*
+ * FreeRTOS run-time stats on the DWT cycle counter.
+ *
+ * CYCCNT is 32 bits wide and wraps every ~4.3 s at 996 MHz, so it is extended
+ * to 64 bits in software. Every read folds in a wrap, which is enough as long
+ * as some read happens at least once per wrap period; the kernel reads it on
+ * every context switch and the stats task wakes once per
+ * RUNTIME_STATS_PERIOD_MS on top of that.
+ *
+ * The stats task turns the kernel's per-task totals into per-window CPU
+ * shares. The console shows them ("cpu") or emits the compact binary record
+ * ("cpu bin") that tools/rtstats.py decodes on the host.
+ */
+
+#ifndef RUNTIME_STATS_PERIOD_MS
+#define RUNTIME_STATS_PERIOD_MS 1000
+#endif
+
+#ifndef RUNTIME_STATS_MAX_TASKS
+#define RUNTIME_STATS_MAX_TASKS 16
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* portCONFIGURE_TIMER_FOR_RUN_TIME_STATS / portGET_RUN_TIME_COUNTER_VALUE */
+void RunTimeStats_InitCounter(void);
+uint64_t RunTimeStats_ReadCounter(void);
+
+#ifdef __cplusplus
+}
+
+#include <FreeRTOS.h>
+
+// Starts the stats task and registers the "cpu" console command.
+void RunTimeStats_Start(UBaseType_t priority);
+
+void RunTimeStats_Report();
+void RunTimeStats_ExportBinary();
+#endif
+
+#endif /* RUNTIME_STATS_H */
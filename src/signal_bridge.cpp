@@ -0,0 +1,118 @@
+#include "signal_bridge.h"
+
+#include <FreeRTOS.h>
+#include <atomic>
+#include <task.h>
+
+#include "cycle_counter.h"
+#include "profiler.h"
+
+static SignalChannel s_channels[SIGNAL_BRIDGE_MAX_CHANNELS];
+static std::atomic<uint32_t> s_channelCount{0};
+static LatestValueTable<SIGNAL_BRIDGE_TABLE_SIZE> s_table;
+static std::atomic<uint32_t> s_coalesced{0};
+
+// Cleared by the first update after a drain; only that update notifies.
+static std::atomic<bool> s_armed{true};
+static std::atomic<uint32_t> s_firstDirty{0}; // CYCCNT of that update
+static TaskHandle_t s_wakeTask;
+static uint32_t s_wakeBits;
+
+// UI thread only.
+static SignalWakeStats s_wakeStats;
+static uint64_t s_wakeCyclesTotal;
+
+void SignalBridge_SetWakeTarget(TaskHandle_t task, uint32_t bits) {
+  s_wakeBits = bits;
+  s_wakeTask = task;
+}
+
+static void wakeUi() {
+  if (!s_armed.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  s_firstDirty.store(CycleCounter_Read(), std::memory_order_relaxed);
+  TaskHandle_t task = s_wakeTask;
+  if (task == NULL) {
+    return;
+  }
+  if (xPortIsInsideInterrupt()) {
+    BaseType_t woken = pdFALSE;
+    (void)xTaskNotifyFromISR(task, s_wakeBits, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+  } else {
+    (void)xTaskNotify(task, s_wakeBits, eSetBits);
+  }
+}
+
+SignalChannel *SignalBridge_OpenChannel() {
+  const uint32_t index = s_channelCount.fetch_add(1, std::memory_order_acq_rel);
+  if (index >= SIGNAL_BRIDGE_MAX_CHANNELS) {
+    s_channelCount.fetch_sub(1, std::memory_order_acq_rel);
+    return nullptr;
+  }
+  return &s_channels[index];
+}
+
+bool SignalBridge_Post(SignalChannel *channel, Message id, int32_t value) {
+  if (!channel->push(SignalUpdate{id, value})) {
+    return false;
+  }
+  wakeUi();
+  return true;
+}
+
+void SignalBridge_Publish(Message id, int32_t value) {
+  const size_t slot = static_cast<size_t>(id);
+  configASSERT(slot < SIGNAL_BRIDGE_TABLE_SIZE);
+  if (s_table.set(slot, value)) {
+    s_coalesced.fetch_add(1, std::memory_order_relaxed);
+  }
+  wakeUi();
+}
+
+size_t SignalBridge_Drain() {
+  PROFILE_ZONE("SignalBridge_Drain");
+  // Re-arm before draining: an update racing with the drain then costs one
+  // spurious wakeup instead of a lost one.
+  if (!s_armed.exchange(true, std::memory_order_acq_rel)) {
+    const uint32_t cycles = CycleCounter_Read() - s_firstDirty.load(std::memory_order_relaxed);
+    const uint32_t us = CycleCounter_ToUs(cycles);
+    s_wakeStats.wakes++;
+    s_wakeCyclesTotal += cycles;
+    s_wakeStats.avgUs = CycleCounter_ToUs((uint32_t)(s_wakeCyclesTotal / s_wakeStats.wakes));
+    if (us > s_wakeStats.maxUs) {
+      s_wakeStats.maxUs = us;
+    }
+  }
+  size_t delivered = s_table.drain([](size_t slot, int32_t value) {
+    Msg_SendToUI(static_cast<Message>(slot), value);
+  });
+  const uint32_t count = s_channelCount.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count && i < SIGNAL_BRIDGE_MAX_CHANNELS; i++) {
+    delivered += s_channels[i].drain([](const SignalUpdate &update) {
+      Msg_SendToUI(update.id, update.value);
+    });
+  }
+  return delivered;
+}
+
+uint32_t SignalBridge_Dropped() {
+  uint32_t dropped = 0;
+  const uint32_t count = s_channelCount.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count && i < SIGNAL_BRIDGE_MAX_CHANNELS; i++) {
+    dropped += s_channels[i].dropped();
+  }
+  return dropped;
+}
+
+uint32_t SignalBridge_Coalesced() {
+  return s_coalesced.load(std::memory_order_relaxed);
+}
+
+void SignalBridge_GetWakeStats(SignalWakeStats &out) { out = s_wakeStats; }
+
+void SignalBridge_ResetWakeStats() {
+  s_wakeStats = SignalWakeStats();
+  s_wakeCyclesTotal = 0;
+}
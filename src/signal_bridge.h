@@ -0,0 +1,85 @@
+#ifndef SIGNAL_BRIDGE_H
+#define SIGNAL_BRIDGE_H
+
+#include <FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <task.h>
+
+#include "bredge/messager.h"
+#include "signal_table.h"
+#include "spsc_ring.h"
+
+// Producer -> UI transport in front of Msg_SendToUI.
+//
+// State signals (gear, speed, rpm, ...) go through SignalBridge_Publish into a
+// latest-value table: only the newest value per Message ID is kept and the UI
+// only sees IDs that changed since the previous frame.
+//
+// Events, where every occurrence matters, go through per-producer channels:
+// each producer task opens its own channel once and posts into it without
+// taking any lock.
+//
+// The frame loop on Qul_Thread drains both once per frame and forwards the
+// updates to Msg_SendToUI, so the UI side is the only caller of it. The first
+// update after a drain also sends a task notification to the wake target, so
+// an idle UI thread can sleep until something actually changes; later updates
+// in the same frame are free.
+
+#ifndef SIGNAL_BRIDGE_MAX_CHANNELS
+#define SIGNAL_BRIDGE_MAX_CHANNELS 4
+#endif
+
+/* Per-channel depth, must be a power of two. */
+#ifndef SIGNAL_BRIDGE_CHANNEL_DEPTH
+#define SIGNAL_BRIDGE_CHANNEL_DEPTH 512
+#endif
+
+/* Number of latest-value slots, must exceed the largest Message ID. */
+#ifndef SIGNAL_BRIDGE_TABLE_SIZE
+#define SIGNAL_BRIDGE_TABLE_SIZE 64
+#endif
+
+// Time from the first update after a drain to the drain that delivers it.
+struct SignalWakeStats {
+  uint32_t wakes;
+  uint32_t avgUs;
+  uint32_t maxUs;
+};
+
+struct SignalUpdate {
+  Message id;
+  int32_t value;
+};
+
+using SignalChannel = SpscRing<SignalUpdate, SIGNAL_BRIDGE_CHANNEL_DEPTH>;
+
+// Returns a channel owned by the calling task, or nullptr once all
+// SIGNAL_BRIDGE_MAX_CHANNELS are taken. Call once per producer task.
+SignalChannel *SignalBridge_OpenChannel();
+
+// Event producer side. Never blocks; returns false if the channel is full.
+bool SignalBridge_Post(SignalChannel *channel, Message id, int32_t value);
+
+// State producer side, callable from any task or ISR. Overwrites the pending
+// value of id.
+void SignalBridge_Publish(Message id, int32_t value);
+
+// UI thread only. Forwards the changed state signals, then everything queued
+// on the event channels, to Msg_SendToUI and returns the number of calls made.
+size_t SignalBridge_Drain();
+
+// Notify task with bits (eSetBits) on the first update after each drain.
+void SignalBridge_SetWakeTarget(TaskHandle_t task, uint32_t bits);
+
+// Updated by the drain on the UI thread; read and reset from the console.
+void SignalBridge_GetWakeStats(SignalWakeStats &out);
+void SignalBridge_ResetWakeStats();
+
+// Total updates dropped because a channel was full.
+uint32_t SignalBridge_Dropped();
+
+// Publishes that were overwritten before the UI picked them up.
+uint32_t SignalBridge_Coalesced();
+
+#endif // SIGNAL_BRIDGE_H
@@ -0,0 +1,60 @@
+#ifndef SIGNAL_TABLE_H
+#define SIGNAL_TABLE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Latest-value table with one dirty bit per slot.
+//
+// Any number of producers may overwrite a slot; only the newest value
+// survives until the consumer drains it. The consumer only visits words of
+// the dirty bitmap that are non-zero, so a drain costs O(changed slots)
+// regardless of how many updates were written since the last one.
+//
+// A drain can observe a value that was stored after its dirty bit was
+// claimed; that slot is then delivered again on the next drain with the same
+// value, which is harmless for state signals.
+template <size_t Slots> class LatestValueTable {
+  static constexpr size_t Words = (Slots + 31) / 32;
+
+public:
+  // Returns true if the slot was already dirty, i.e. the update coalesced
+  // with one the consumer has not seen yet.
+  bool set(size_t slot, int32_t value) {
+    values_[slot].store(value, std::memory_order_relaxed);
+    const uint32_t bit = 1u << (slot & 31);
+    const uint32_t prev = dirty_[slot >> 5].fetch_or(bit, std::memory_order_release);
+    return (prev & bit) != 0;
+  }
+
+  int32_t get(size_t slot) const {
+    return values_[slot].load(std::memory_order_relaxed);
+  }
+
+  // Consumer side. Calls fn(slot, value) for every dirty slot and clears it.
+  template <typename Fn> size_t drain(Fn &&fn) {
+    size_t count = 0;
+    for (size_t word = 0; word < Words; word++) {
+      if (dirty_[word].load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      uint32_t bits = dirty_[word].exchange(0, std::memory_order_acquire);
+      while (bits != 0) {
+        const size_t slot = (word << 5) + __builtin_ctz(bits);
+        bits &= bits - 1;
+        fn(slot, values_[slot].load(std::memory_order_relaxed));
+        count++;
+      }
+    }
+    return count;
+  }
+
+  static constexpr size_t size() { return Slots; }
+
+private:
+  std::atomic<uint32_t> dirty_[Words] = {};
+  std::atomic<int32_t> values_[Slots] = {};
+};
+
+#endif // SIGNAL_TABLE_H
@@ -0,0 +1,92 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Wait-free single-producer/single-consumer ring.
+//
+// Exactly one context may call push() and exactly one (other) context may call
+// pop()/drain(). Neither side ever blocks or masks interrupts, so a producer
+// can be a task or an ISR. Only <atomic> is used, which keeps the ring
+// buildable on the host as well as on the M7.
+//
+// Capacity must be a power of two. Indices are free-running 32-bit counters,
+// so head - tail is always the fill level, even across wrap-around.
+template <typename T, size_t Capacity> class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  // Producer side. Returns false (and counts a drop) when the ring is full.
+  bool push(const T &item) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tailCache_ == Capacity) {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (head - tailCache_ == Capacity) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+        return false;
+      }
+    }
+    slots_[head & (Capacity - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T &item) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == headCache_) {
+      headCache_ = head_.load(std::memory_order_acquire);
+      if (tail == headCache_) {
+        return false;
+      }
+    }
+    item = slots_[tail & (Capacity - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Hands every item that was visible on entry (at most
+  // maxItems) to fn and publishes the new tail once, not per item.
+  template <typename Fn> size_t drain(Fn &&fn, size_t maxItems = Capacity) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    headCache_ = head_.load(std::memory_order_acquire);
+    size_t count = headCache_ - tail;
+    if (count > maxItems) {
+      count = maxItems;
+    }
+    for (size_t n = 0; n < count; n++) {
+      fn(slots_[(tail + n) & (Capacity - 1)]);
+    }
+    if (count != 0) {
+      tail_.store(tail + static_cast<uint32_t>(count), std::memory_order_release);
+    }
+    return count;
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  // Producer and consumer indices live on separate 32-byte M7 cache lines so
+  // the two sides do not keep invalidating each other's line.
+  alignas(32) std::atomic<uint32_t> head_{0};
+  uint32_t tailCache_ = 0; // producer-private copy of tail_
+  std::atomic<uint32_t> dropped_{0};
+  alignas(32) std::atomic<uint32_t> tail_{0};
+  uint32_t headCache_ = 0; // consumer-private copy of head_
+  alignas(32) T slots_[Capacity];
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,29 @@
+#include "static_alloc.h"
+
+#if APP_STATIC_ALLOCATION
+
+/* Kernel-owned tasks, required by configSUPPORT_STATIC_ALLOCATION. */
+static StaticTask_t s_idleTcb APP_STATIC_STORAGE;
+static StackType_t s_idleStack[configMINIMAL_STACK_SIZE] APP_STATIC_STORAGE;
+static StaticTask_t s_timerTcb APP_STATIC_STORAGE;
+static StackType_t s_timerStack[configTIMER_TASK_STACK_DEPTH] APP_STATIC_STORAGE;
+
+extern "C" {
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &s_idleTcb;
+  *ppxIdleTaskStackBuffer = s_idleStack;
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize) {
+  *ppxTimerTaskTCBBuffer = &s_timerTcb;
+  *ppxTimerTaskStackBuffer = s_timerStack;
+  *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+}
+
+#endif /* APP_STATIC_ALLOCATION */
@@ -0,0 +1,97 @@
+#ifndef STATIC_ALLOC_H
+#define STATIC_ALLOC_H
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+#include <timers.h>
+
+// Storage for tasks and kernel objects that follows APP_STATIC_ALLOCATION.
+//
+// With APP_STATIC_ALLOCATION=1 the objects are created with the
+// xCreateStatic variants from the embedded buffers and nothing touches the
+// heap; otherwise the buffers compile away and the regular dynamic API is
+// used. Declare every storage object with APP_STATIC_STORAGE so stacks and
+// TCBs end up in DTCM:
+//
+//   static TaskStorage<4096> s_testAppTask APP_STATIC_STORAGE;
+//   s_testAppTask.create(TestApp_Thread, "TestApp_Thread", 0, 3);
+//
+// armgcc/mem_regions.ld places the storage at the start of DTCM, ahead of
+// the DTCM heap arena, and fails the link when both together outgrow the
+// 256 KB. The section is not zeroed at startup; the xCreateStatic calls
+// initialise everything in it.
+
+#if APP_STATIC_ALLOCATION
+#define APP_STATIC_STORAGE __attribute__((section(".dtcm_stacks"), aligned(8)))
+#else
+#define APP_STATIC_STORAGE
+#endif
+
+template <uint32_t StackDepth> struct TaskStorage {
+  BaseType_t create(TaskFunction_t fn, const char *name, void *arg,
+                    UBaseType_t priority, TaskHandle_t *handle = nullptr) {
+#if APP_STATIC_ALLOCATION
+    TaskHandle_t created = xTaskCreateStatic(fn, name, StackDepth, arg, priority, stack, &tcb);
+    if (handle != nullptr) {
+      *handle = created;
+    }
+    return created != NULL ? pdPASS : pdFAIL;
+#else
+    return xTaskCreate(fn, name, StackDepth, arg, priority, handle);
+#endif
+  }
+
+#if APP_STATIC_ALLOCATION
+  StackType_t stack[StackDepth];
+  StaticTask_t tcb;
+#endif
+};
+
+template <typename T, UBaseType_t Length> struct QueueStorage {
+  QueueHandle_t create() {
+#if APP_STATIC_ALLOCATION
+    return xQueueCreateStatic(Length, sizeof(T), items, &queue);
+#else
+    return xQueueCreate(Length, sizeof(T));
+#endif
+  }
+
+#if APP_STATIC_ALLOCATION
+  uint8_t items[Length * sizeof(T)];
+  StaticQueue_t queue;
+#endif
+};
+
+struct TimerStorage {
+  TimerHandle_t create(const char *name, TickType_t period, UBaseType_t autoReload,
+                       void *id, TimerCallbackFunction_t callback) {
+#if APP_STATIC_ALLOCATION
+    return xTimerCreateStatic(name, period, autoReload, id, callback, &timer);
+#else
+    return xTimerCreate(name, period, autoReload, id, callback);
+#endif
+  }
+
+#if APP_STATIC_ALLOCATION
+  StaticTimer_t timer;
+#endif
+};
+
+// A mutex, with priority inheritance.
+struct MutexStorage {
+  SemaphoreHandle_t create() {
+#if APP_STATIC_ALLOCATION
+    return xSemaphoreCreateMutexStatic(&mutex);
+#else
+    return xSemaphoreCreateMutex();
+#endif
+  }
+
+#if APP_STATIC_ALLOCATION
+  StaticSemaphore_t mutex;
+#endif
+};
+
+#endif // STATIC_ALLOC_H
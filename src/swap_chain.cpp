@@ -0,0 +1,86 @@
+#include "swap_chain.h"
+
+void SwapChain::reset(uint8_t count) {
+  if (count == 0) {
+    count = 1;
+  }
+  count_ = count < SWAP_CHAIN_MAX_BUFFERS ? count : SWAP_CHAIN_MAX_BUFFERS;
+  for (uint8_t i = 0; i < SWAP_CHAIN_MAX_BUFFERS; i++) {
+    buffers_[i] = Buffer{i == 0 ? BufferState::Scanout : BufferState::Free, 0, 0};
+  }
+  tearing_ = -1;
+  stats_ = SwapChainStats{};
+}
+
+int SwapChain::find(BufferState state) const {
+  for (int i = 0; i < count_; i++) {
+    if (buffers_[i].state == state) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int SwapChain::acquire(bool allowTear, uint32_t &age) {
+  if (drawing() >= 0 || tearing_ >= 0) {
+    return -1;
+  }
+  int index = find(BufferState::Free);
+  if (index >= 0) {
+    buffers_[index].state = BufferState::Drawing;
+  } else if ((allowTear || count_ == 1) && (index = scanout()) >= 0) {
+    // Stays Scanout while being drawn into.
+    tearing_ = (int8_t)index;
+    if (count_ > 1) {
+      stats_.tears++;
+    }
+  } else {
+    return -1;
+  }
+  const Buffer &buffer = buffers_[index];
+  age = buffer.frame != 0 ? stats_.presents + 1U - buffer.frame : 0U;
+  return index;
+}
+
+int SwapChain::present(uint32_t now) {
+  stats_.presents++;
+  const int torn = tearing_;
+  tearing_ = -1;
+  if (torn >= 0 && buffers_[torn].state == BufferState::Scanout) {
+    // Already on screen; there is nothing to flip.
+    buffers_[torn].frame = stats_.presents;
+    return -1;
+  }
+  const int index = drawing();
+  if (index < 0) {
+    stats_.presents--;
+    return -1;
+  }
+  const int replaced = queued();
+  if (replaced >= 0) {
+    buffers_[replaced].state = BufferState::Free;
+    stats_.replaced++;
+  }
+  buffers_[index] = Buffer{BufferState::Queued, stats_.presents, now};
+  return replaced;
+}
+
+bool SwapChain::flip(uint32_t now) {
+  const int index = queued();
+  if (index < 0) {
+    return false;
+  }
+  const int previous = scanout();
+  if (previous >= 0) {
+    // A buffer torn into keeps being drawn, now off screen.
+    buffers_[previous].state = previous == tearing_ ? BufferState::Drawing : BufferState::Free;
+  }
+  buffers_[index].state = BufferState::Scanout;
+  const uint32_t latency = now - buffers_[index].queuedAt;
+  stats_.flips++;
+  stats_.latencySum += latency;
+  if (latency > stats_.latencyMax) {
+    stats_.latencyMax = latency;
+  }
+  return true;
+}
@@ -0,0 +1,86 @@
+#ifndef SWAP_CHAIN_H
+#define SWAP_CHAIN_H
+
+#include <stdint.h>
+
+// Buffer bookkeeping for one double- or triple-buffered display layer.
+//
+// Every buffer is in one of four states. Exactly one is Scanout, the buffer
+// the display controller reads; the renderer acquires a Free one (Drawing),
+// presents it (Queued), and the flip latches it at the next vsync, which
+// frees the previous Scanout buffer.
+//
+// With two buffers the renderer has to wait for that vsync before it can
+// acquire again. With three it can draw the next frame while one is queued;
+// if it presents again before the vsync, the newer frame replaces the queued
+// one, which goes back to Free without ever being shown. That keeps latency
+// at one refresh at most instead of letting frames pile up.
+//
+// acquire(true) hands out the Scanout buffer when nothing is Free, i.e.
+// draws into the picture being displayed; it exists to measure tearing and
+// counts every such frame. A chain of one buffer, for layers that are drawn
+// once and then only shown, is always drawn in place and never counts.
+//
+// Nothing here locks or touches hardware; framebuffer.cpp serialises the
+// calls against the vsync interrupt and programs the controller. Times are
+// in caller units (CPU cycles on the target).
+
+#ifndef SWAP_CHAIN_MAX_BUFFERS
+#define SWAP_CHAIN_MAX_BUFFERS 3
+#endif
+
+enum class BufferState : uint8_t { Free, Drawing, Queued, Scanout };
+
+struct SwapChainStats {
+  uint32_t presents;
+  uint32_t flips;      // queued buffers that reached the screen
+  uint32_t replaced;   // queued buffers superseded before a flip
+  uint32_t tears;      // frames drawn into the Scanout buffer
+  uint32_t latencyMax; // present -> flip
+  uint64_t latencySum;
+};
+
+class SwapChain {
+public:
+  // Buffer 0 starts as Scanout, the others Free. count is clamped to
+  // 1..SWAP_CHAIN_MAX_BUFFERS.
+  void reset(uint8_t count);
+
+  // Index of the buffer to draw the next frame into, -1 if none is Free (or
+  // one is already Drawing). age is the number of presents since the
+  // buffer's contents were current, 0 if they never were.
+  int acquire(bool allowTear, uint32_t &age);
+
+  // Queues the Drawing buffer. Returns the index of the queued buffer it
+  // replaced, -1 if there was none.
+  int present(uint32_t now);
+
+  // The display controller took the Queued buffer. Returns false if nothing
+  // was queued.
+  bool flip(uint32_t now);
+
+  uint8_t count() const { return count_; }
+  int scanout() const { return find(BufferState::Scanout); }
+  int queued() const { return find(BufferState::Queued); }
+  int drawing() const { return find(BufferState::Drawing); }
+  BufferState state(int index) const { return buffers_[index].state; }
+
+  const SwapChainStats &stats() const { return stats_; }
+  void resetStats() { stats_ = SwapChainStats{}; }
+
+private:
+  struct Buffer {
+    BufferState state;
+    uint32_t frame;     // present count when last presented
+    uint32_t queuedAt;
+  };
+
+  int find(BufferState state) const;
+
+  Buffer buffers_[SWAP_CHAIN_MAX_BUFFERS] = {};
+  uint8_t count_ = 0;
+  int8_t tearing_ = -1; // buffer drawn while it was Scanout
+  SwapChainStats stats_ = {};
+};
+
+#endif // SWAP_CHAIN_H
@@ -0,0 +1,204 @@
+#include "tickless_idle.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#if APP_TICKLESS_IDLE
+
+#include <fsl_clock.h>
+#include <fsl_gpt.h>
+#include <platforminterface/log.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+
+#define TICKLESS_GPT GPT2
+#define TICKLESS_GPT_IRQ GPT2_IRQn
+#define TICKLESS_GPT_COUNTS_PER_TICK (TICKLESS_IDLE_GPT_HZ / configTICK_RATE_HZ)
+
+struct TicklessStats {
+  uint32_t sleeps;
+  uint32_t aborted;
+  uint32_t timerWakes;
+  uint32_t interruptWakes;
+  uint64_t sleptCounts;
+  uint32_t longestCounts;
+  uint64_t lateCounts; // timer wakes only
+  uint32_t maxLateCounts;
+  uint64_t exitCycles;
+  uint32_t maxExitCycles;
+  TickType_t since;
+};
+
+static bool s_ready;
+static TicklessStats s_stats;
+
+extern "C" void GPT2_IRQHandler(void) {
+  GPT_ClearStatusFlags(TICKLESS_GPT, kGPT_OutputCompare1Flag);
+  SDK_ISR_EXIT_BARRIER;
+}
+
+extern "C" void TicklessIdle_Sleep(uint32_t expectedIdleTicks) {
+  if (!s_ready) {
+    return;
+  }
+  const uint32_t maxTicks = pdMS_TO_TICKS(TICKLESS_IDLE_MAX_SLEEP_MS);
+  if (expectedIdleTicks > maxTicks) {
+    expectedIdleTicks = maxTicks;
+  }
+
+  __disable_irq();
+  __DSB();
+  __ISB();
+
+  // A task was readied or a tick became pending since the scheduler decided
+  // to sleep: let SysTick carry on from where it was.
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0) {
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    s_stats.aborted++;
+    __enable_irq();
+    return;
+  }
+
+  // Part of the current tick period that has already gone by, in GPT counts.
+  const uint32_t reload = SysTick->LOAD + 1U;
+  const uint32_t spent =
+      (uint32_t)((uint64_t)(reload - SysTick->VAL) * TICKLESS_GPT_COUNTS_PER_TICK / reload);
+  const uint32_t budget = expectedIdleTicks * TICKLESS_GPT_COUNTS_PER_TICK - spent;
+
+  const uint32_t start = GPT_GetCurrentTimerCount(TICKLESS_GPT);
+  GPT_ClearStatusFlags(TICKLESS_GPT, kGPT_OutputCompare1Flag);
+  GPT_SetOutputCompareValue(TICKLESS_GPT, kGPT_OutputCompare_Channel1, start + budget);
+  GPT_EnableInterrupts(TICKLESS_GPT, kGPT_OutputCompare1InterruptEnable);
+
+  __DSB();
+  __WFI();
+  __ISB();
+
+  const uint32_t woke = CycleCounter_Read();
+  const uint32_t slept = GPT_GetCurrentTimerCount(TICKLESS_GPT) - start;
+  const bool timerWake = GPT_GetStatusFlags(TICKLESS_GPT, kGPT_OutputCompare1Flag) != 0;
+  GPT_DisableInterrupts(TICKLESS_GPT, kGPT_OutputCompare1InterruptEnable);
+  GPT_ClearStatusFlags(TICKLESS_GPT, kGPT_OutputCompare1Flag);
+  NVIC_ClearPendingIRQ(TICKLESS_GPT_IRQ);
+
+  // Restart SysTick so the next tick lands where it would have without the
+  // sleep. If the deadline itself was reached, leave the last tick to the
+  // tick interrupt so the kernel unblocks the waiting task the normal way.
+  const uint32_t elapsed = spent + slept;
+  uint32_t completeTicks = elapsed / TICKLESS_GPT_COUNTS_PER_TICK;
+  uint32_t remaining;
+  if (completeTicks >= expectedIdleTicks) {
+    completeTicks = expectedIdleTicks - 1U;
+    remaining = 1U;
+  } else {
+    remaining = (completeTicks + 1U) * TICKLESS_GPT_COUNTS_PER_TICK - elapsed;
+  }
+  uint32_t remainingCycles = (uint32_t)((uint64_t)remaining * reload / TICKLESS_GPT_COUNTS_PER_TICK);
+  if (remainingCycles == 0U) {
+    remainingCycles = 1U;
+  }
+  SysTick->LOAD = remainingCycles - 1U;
+  SysTick->VAL = 0U;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  SysTick->LOAD = reload - 1U;
+  vTaskStepTick(completeTicks);
+
+  s_stats.sleeps++;
+  s_stats.sleptCounts += slept;
+  if (slept > s_stats.longestCounts) {
+    s_stats.longestCounts = slept;
+  }
+  if (timerWake) {
+    s_stats.timerWakes++;
+    const uint32_t late = slept > budget ? slept - budget : 0U;
+    s_stats.lateCounts += late;
+    if (late > s_stats.maxLateCounts) {
+      s_stats.maxLateCounts = late;
+    }
+  } else {
+    s_stats.interruptWakes++;
+  }
+  const uint32_t exit = CycleCounter_Read() - woke;
+  s_stats.exitCycles += exit;
+  if (exit > s_stats.maxExitCycles) {
+    s_stats.maxExitCycles = exit;
+  }
+
+  __enable_irq();
+}
+
+static uint32_t countsToUs(uint64_t counts) {
+  return (uint32_t)(counts * 1000000U / TICKLESS_IDLE_GPT_HZ);
+}
+
+static uint32_t countsToNs(uint64_t counts) {
+  return (uint32_t)(counts * 1000000000U / TICKLESS_IDLE_GPT_HZ);
+}
+
+void TicklessIdle_Report() {
+  taskENTER_CRITICAL();
+  const TicklessStats stats = s_stats;
+  taskEXIT_CRITICAL();
+
+  const uint32_t windowMs = (xTaskGetTickCount() - stats.since) * 1000U / configTICK_RATE_HZ;
+  const uint32_t sleptMs = countsToUs(stats.sleptCounts) / 1000U;
+  const uint32_t sleeps = stats.sleeps != 0 ? stats.sleeps : 1U;
+  const uint32_t timerWakes = stats.timerWakes != 0 ? stats.timerWakes : 1U;
+  const uint32_t mhz = SystemCoreClock / 1000000U;
+  Qul::PlatformInterface::log("asleep %u of %u ms (%u%%), %u sleeps, %u aborted\r\n",
+                              (unsigned)sleptMs, (unsigned)windowMs,
+                              (unsigned)(windowMs != 0 ? sleptMs * 100U / windowMs : 0U),
+                              (unsigned)stats.sleeps, (unsigned)stats.aborted);
+  Qul::PlatformInterface::log("  sleep   avg %u us, longest %u us\r\n",
+                              (unsigned)countsToUs(stats.sleptCounts / sleeps),
+                              (unsigned)countsToUs(stats.longestCounts));
+  Qul::PlatformInterface::log("  wakes   %u timer, %u interrupt\r\n", (unsigned)stats.timerWakes,
+                              (unsigned)stats.interruptWakes);
+  Qul::PlatformInterface::log("  late    avg %u ns, max %u ns (timer wakes)\r\n",
+                              (unsigned)countsToNs(stats.lateCounts / timerWakes),
+                              (unsigned)countsToNs(stats.maxLateCounts));
+  Qul::PlatformInterface::log("  exit    avg %u ns, max %u ns (WFI to interrupts on)\r\n",
+                              (unsigned)(stats.exitCycles / sleeps * 1000U / mhz),
+                              (unsigned)(stats.maxExitCycles * 1000U / mhz));
+}
+
+static void idleCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "reset")) {
+    taskENTER_CRITICAL();
+    s_stats = TicklessStats();
+    s_stats.since = xTaskGetTickCount();
+    taskEXIT_CRITICAL();
+  } else {
+    TicklessIdle_Report();
+  }
+}
+
+void TicklessIdle_Init() {
+  const clock_root_config_t root = {false, kCLOCK_GPT2_ClockRoot_MuxOsc24MOut, 1};
+  CLOCK_SetRootClock(kCLOCK_Root_Gpt2, &root);
+
+  gpt_config_t config;
+  GPT_GetDefaultConfig(&config);
+  config.clockSource = kGPT_ClockSource_Periph;
+  config.divider = 24000000U / TICKLESS_IDLE_GPT_HZ;
+  config.enableFreeRun = true;
+  config.enableRunInWait = true;
+  config.enableRunInStop = true;
+  config.enableRunInDoze = true;
+  GPT_Init(TICKLESS_GPT, &config);
+  GPT_StartTimer(TICKLESS_GPT);
+
+  NVIC_SetPriority(TICKLESS_GPT_IRQ, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+  (void)EnableIRQ(TICKLESS_GPT_IRQ);
+
+  s_ready = true;
+  DebugConsole_Register("idle", "tickless idle residency and wake latency [reset]", idleCommand);
+}
+
+#else
+
+void TicklessIdle_Init() {}
+
+#endif /* APP_TICKLESS_IDLE */
@@ -0,0 +1,51 @@
+#ifndef TICKLESS_IDLE_H
+#define TICKLESS_IDLE_H
+
+#include <stdint.h>
+
+/*
+ * Tickless idle on GPT2.
+ *
+ * When every task is blocked for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+ * ticks the idle task stops SysTick, programs a GPT2 compare for the next
+ * kernel deadline and executes WFI. Any interrupt ends the sleep early: the
+ * LCDIFv2 vsync, touch, UART, or the GPT2 compare itself. On the way out the
+ * slept time is read back from GPT2 (24 MHz, keeps counting while the core
+ * clock is gated), the missed ticks are stepped in and SysTick is restarted
+ * in phase with the original tick grid.
+ *
+ * Sleeps are capped at TICKLESS_IDLE_MAX_SLEEP_MS so the software-extended
+ * CYCCNT used by the run-time stats never misses a wrap.
+ *
+ * The "idle" console command reports sleep residency and the wake path
+ * latency: how late the GPT2 wakeup was, and how many cycles it takes from
+ * WFI returning to interrupts being re-enabled, which is the delay added in
+ * front of the ISR of whatever woke the core.
+ */
+
+#ifndef TICKLESS_IDLE_MAX_SLEEP_MS
+#define TICKLESS_IDLE_MAX_SLEEP_MS 2000
+#endif
+
+#ifndef TICKLESS_IDLE_GPT_HZ
+#define TICKLESS_IDLE_GPT_HZ 24000000U
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* portSUPPRESS_TICKS_AND_SLEEP, called by the idle task with the scheduler suspended. */
+void TicklessIdle_Sleep(uint32_t expectedIdleTicks);
+
+#ifdef __cplusplus
+}
+
+// Sets up GPT2 and registers the "idle" console command. Call before the
+// scheduler starts.
+void TicklessIdle_Init();
+
+void TicklessIdle_Report();
+#endif
+
+#endif /* TICKLESS_IDLE_H */
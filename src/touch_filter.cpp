@@ -0,0 +1,91 @@
+#include "touch_filter.h"
+
+#include <math.h>
+
+static const float kPi = 3.14159265f;
+
+// Smoothing factor of a one-pole low-pass at cutoffHz sampled every dt s.
+static float smoothing(float cutoffHz, float dt) {
+  const float tau = 1.0f / (2.0f * kPi * cutoffHz);
+  return 1.0f / (1.0f + tau / dt);
+}
+
+TouchFilterConfig TouchFilter::defaults() {
+  TouchFilterConfig config;
+  config.minCutoffHz = 1.0f;
+  config.beta = 0.05f;
+  config.speedCutoffHz = 20.0f;
+  config.maxLeadUs = 50000;
+  config.maxLeadPx = 80.0f;
+  config.minSpeedPxS = 40.0f;
+  return config;
+}
+
+void TouchFilter::filter(Axis &axis, float raw, float dt) const {
+  const float speed = (raw - axis.raw) / dt;
+  axis.raw = raw;
+  axis.speed += smoothing(config_.speedCutoffHz, dt) * (speed - axis.speed);
+  const float cutoff = config_.minCutoffHz + config_.beta * fabsf(axis.speed);
+  axis.value += smoothing(cutoff, dt) * (raw - axis.value);
+}
+
+void TouchFilter::update(uint8_t id, float x, float y, uint32_t timeUs) {
+  if (id >= TOUCH_FILTER_MAX_CONTACTS) {
+    return;
+  }
+  Contact &contact = contacts_[id];
+  if (!contact.active) {
+    contact.x = Axis{x, x, 0.0f};
+    contact.y = Axis{y, y, 0.0f};
+    contact.timeUs = timeUs;
+    contact.active = true;
+    return;
+  }
+  const int32_t elapsed = (int32_t)(timeUs - contact.timeUs);
+  if (elapsed <= 0) {
+    return; // duplicate or out-of-order sample
+  }
+  const float dt = (float)elapsed * 1e-6f;
+  filter(contact.x, x, dt);
+  filter(contact.y, y, dt);
+  contact.timeUs = timeUs;
+}
+
+void TouchFilter::release(uint8_t id) {
+  if (id < TOUCH_FILTER_MAX_CONTACTS) {
+    contacts_[id].active = false;
+  }
+}
+
+void TouchFilter::reset() {
+  for (Contact &contact : contacts_) {
+    contact.active = false;
+  }
+}
+
+void TouchFilter::position(uint8_t id, float &x, float &y) const {
+  if (id >= TOUCH_FILTER_MAX_CONTACTS) {
+    return;
+  }
+  x = contacts_[id].x.value;
+  y = contacts_[id].y.value;
+}
+
+void TouchFilter::predict(uint8_t id, uint32_t displayUs, float &x, float &y) const {
+  position(id, x, y);
+  if (id >= TOUCH_FILTER_MAX_CONTACTS || !contacts_[id].active) {
+    return;
+  }
+  const Contact &contact = contacts_[id];
+  const float speed = sqrtf(contact.x.speed * contact.x.speed + contact.y.speed * contact.y.speed);
+  const int32_t lead = (int32_t)(displayUs - contact.timeUs);
+  if (speed < config_.minSpeedPxS || lead <= 0) {
+    return;
+  }
+  float leadS = (float)((uint32_t)lead < config_.maxLeadUs ? (uint32_t)lead : config_.maxLeadUs) * 1e-6f;
+  if (speed * leadS > config_.maxLeadPx) {
+    leadS = config_.maxLeadPx / speed;
+  }
+  x += contact.x.speed * leadS;
+  y += contact.y.speed * leadS;
+}
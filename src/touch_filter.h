@@ -0,0 +1,73 @@
+#ifndef TOUCH_FILTER_H
+#define TOUCH_FILTER_H
+
+#include <stdint.h>
+
+// Jitter filter and motion predictor for touch contacts.
+//
+// Every raw sample of a contact goes through a 1-euro filter per axis (a
+// low-pass whose cutoff rises with speed): a resting finger is smoothed
+// heavily, a fast swipe hardly at all, so it neither jitters nor lags. The
+// same filter tracks the contact's velocity, and predict() extrapolates the
+// filtered position to the time the frame will actually be on the panel.
+// The extrapolation is capped in time and distance so a contact that stops
+// or turns does not overshoot far.
+//
+// Timestamps are wrapping microsecond counters. Plain C++ without FreeRTOS or
+// SDK headers: tools/touch_replay.cpp builds the same code on the host to
+// measure prediction error on recorded traces.
+
+#ifndef TOUCH_FILTER_MAX_CONTACTS
+#define TOUCH_FILTER_MAX_CONTACTS 16 /* GT911 track ids are 0..15 */
+#endif
+
+struct TouchFilterConfig {
+  float minCutoffHz; // cutoff of a resting contact, lower is smoother
+  float beta;        // cutoff increase per px/s of speed, higher lags less
+  float speedCutoffHz;
+  uint32_t maxLeadUs; // longest extrapolation
+  float maxLeadPx;    // furthest extrapolation
+  float minSpeedPxS;  // slower contacts are not extrapolated
+};
+
+class TouchFilter {
+public:
+  static TouchFilterConfig defaults();
+
+  explicit TouchFilter(const TouchFilterConfig &config = defaults()) : config_(config) {}
+
+  // Feeds a raw sample. The first sample after release() starts a new
+  // contact without any history.
+  void update(uint8_t id, float x, float y, uint32_t timeUs);
+  void release(uint8_t id);
+  void reset();
+
+  // Filtered position at the last sample.
+  void position(uint8_t id, float &x, float &y) const;
+
+  // Filtered position extrapolated to displayUs.
+  void predict(uint8_t id, uint32_t displayUs, float &x, float &y) const;
+
+  const TouchFilterConfig &config() const { return config_; }
+  void setConfig(const TouchFilterConfig &config) { config_ = config; }
+
+private:
+  struct Axis {
+    float value;
+    float raw;   // last sample
+    float speed; // px per second, from raw samples
+  };
+  struct Contact {
+    Axis x;
+    Axis y;
+    uint32_t timeUs;
+    bool active;
+  };
+
+  void filter(Axis &axis, float raw, float dt) const;
+
+  TouchFilterConfig config_;
+  Contact contacts_[TOUCH_FILTER_MAX_CONTACTS] = {};
+};
+
+#endif // TOUCH_FILTER_H
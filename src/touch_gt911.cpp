@@ -0,0 +1,415 @@
+#include "touch_gt911.h"
+
+#if APP_TOUCH_IRQ
+
+#include <atomic>
+#include <board.h>
+#include <fsl_gpio.h>
+#include <fsl_gt911.h>
+#include <platforminterface/log.h>
+#include <platforminterface/touch.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cycle_counter.h"
+#include "debug_console.h"
+#include "i2c_bus.h"
+#include "spsc_ring.h"
+#include "touch_filter.h"
+
+#define TOUCH_I2C BOARD_MIPI_PANEL_TOUCH_I2C_BASEADDR
+#define TOUCH_INT_GPIO BOARD_MIPI_PANEL_TOUCH_INT_GPIO
+#define TOUCH_INT_PIN BOARD_MIPI_PANEL_TOUCH_INT_PIN
+#define TOUCH_INT_IRQ GPIO2_Combined_16_31_IRQn
+
+#define GT911_STATUS_REG 0x814EU
+#define GT911_STATUS_READY 0x80U
+#define GT911_POINT_SIZE 8U
+
+enum class BurstState : uint8_t { Idle, Reading, Clearing };
+
+static gt911_handle_t s_gt911;
+static uint8_t s_rx[1 + TOUCH_MAX_POINTS * GT911_POINT_SIZE];
+static uint8_t s_clear[1];
+static I2cRequest s_readRequest;
+static I2cRequest s_clearRequest;
+
+// Touch interrupt and I2C completion only; both run at I2C_BUS_IRQ_PRIORITY.
+static BurstState s_state;
+static bool s_pending;
+static uint32_t s_burstIrqCycles;
+static uint32_t s_pendingIrqCycles;
+static uint64_t s_burstCyclesTotal;
+
+static SpscRing<TouchReport, TOUCH_QUEUE_DEPTH> s_queue;
+static TaskHandle_t s_wakeTask;
+static uint32_t s_wakeBits;
+static TouchStats s_stats;
+
+struct TraceEntry {
+  uint32_t timeUs;
+  TouchReport report;
+};
+
+// UI thread only.
+static uint16_t s_down; // bit per track id
+static TouchFilter s_filter;
+static uint32_t s_clockUs;
+static uint32_t s_clockCycles;
+static uint64_t s_toUiCyclesTotal;
+
+// Written by the UI thread while recording, read by the console afterwards.
+static TraceEntry s_trace[TOUCH_TRACE_DEPTH];
+static std::atomic<uint32_t> s_traceCount{0};
+static std::atomic<bool> s_recording{false};
+static std::atomic<bool> s_predict{true};
+
+static void startRead() {
+  s_state = BurstState::Reading;
+  I2cBus_Submit(TOUCH_I2C, s_readRequest);
+}
+
+// The controller keeps its INT asserted until the buffer-ready flag is
+// written back to zero.
+static void startClear() {
+  s_state = BurstState::Clearing;
+  I2cBus_Submit(TOUCH_I2C, s_clearRequest);
+}
+
+static void queueReport() {
+  TouchReport report;
+  report.count = s_rx[0] & 0x0FU;
+  if (report.count > TOUCH_MAX_POINTS) {
+    report.count = TOUCH_MAX_POINTS;
+  }
+  for (uint8_t i = 0; i < report.count; i++) {
+    const uint8_t *p = &s_rx[1 + i * GT911_POINT_SIZE];
+    report.points[i].id = p[0] & 0x0FU;
+    report.points[i].x = (uint16_t)(p[1] | (p[2] << 8));
+    report.points[i].y = (uint16_t)(p[3] | (p[4] << 8));
+    report.points[i].size = (uint16_t)(p[5] | (p[6] << 8));
+  }
+  report.irqCycles = s_burstIrqCycles;
+
+  const uint32_t cycles = CycleCounter_Read() - s_burstIrqCycles;
+  s_stats.reports++;
+  s_burstCyclesTotal += cycles;
+  s_stats.burstAvgUs = CycleCounter_ToUs((uint32_t)(s_burstCyclesTotal / s_stats.reports));
+  if (CycleCounter_ToUs(cycles) > s_stats.burstMaxUs) {
+    s_stats.burstMaxUs = CycleCounter_ToUs(cycles);
+  }
+
+  if (!s_queue.push(report)) {
+    s_stats.dropped++;
+    return;
+  }
+  if (s_wakeTask != NULL) {
+    BaseType_t woken = pdFALSE;
+    (void)xTaskNotifyFromISR(s_wakeTask, s_wakeBits, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+static void transferDone(I2cRequest &request, int32_t status) {
+  if (&request == &s_readRequest) {
+    if (status != kStatus_Success) {
+      s_stats.errors++;
+    } else if (s_rx[0] & GT911_STATUS_READY) {
+      queueReport();
+      startClear();
+      return;
+    }
+  } else if (status != kStatus_Success) {
+    s_stats.errors++;
+  }
+  s_state = BurstState::Idle;
+  if (s_pending) {
+    s_pending = false;
+    s_burstIrqCycles = s_pendingIrqCycles;
+    startRead();
+  }
+}
+
+extern "C" void GPIO2_Combined_16_31_IRQHandler(void) {
+  const uint32_t flags = GPIO_PortGetInterruptFlags(TOUCH_INT_GPIO) & (1UL << TOUCH_INT_PIN);
+  GPIO_PortClearInterruptFlags(TOUCH_INT_GPIO, flags);
+  if (flags != 0U) {
+    s_stats.interrupts++;
+    if (s_state != BurstState::Idle) {
+      if (!s_pending) {
+        s_pending = true;
+        s_pendingIrqCycles = CycleCounter_Read();
+      }
+      s_stats.coalesced++;
+    } else {
+      s_burstIrqCycles = CycleCounter_Read();
+      startRead();
+    }
+  }
+  SDK_ISR_EXIT_BARRIER;
+}
+
+void Touch_SetWakeTarget(TaskHandle_t task, uint32_t bits) {
+  s_wakeBits = bits;
+  s_wakeTask = task;
+}
+
+// Dispatch-side microsecond clock, advanced from CYCCNT on every call. The
+// frame loop dispatches at least every FRAME_LOOP_IDLE_MAX_MS, far inside one
+// CYCCNT wrap.
+static uint32_t advanceClock() {
+  const uint32_t cyclesPerUs = SystemCoreClock / 1000000U;
+  const uint32_t us = (CycleCounter_Read() - s_clockCycles) / cyclesPerUs;
+  s_clockCycles += us * cyclesPerUs;
+  s_clockUs += us;
+  return s_clockUs;
+}
+
+static uint32_t sampleTime(const TouchReport &report) {
+  const int32_t age = (int32_t)(s_clockCycles - report.irqCycles);
+  return age > 0 ? s_clockUs - CycleCounter_ToUs((uint32_t)age) : s_clockUs;
+}
+
+static void record(const TouchReport &report, uint32_t timeUs) {
+  if (!s_recording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  const uint32_t count = s_traceCount.load(std::memory_order_relaxed);
+  if (count == TOUCH_TRACE_DEPTH) {
+    s_recording.store(false, std::memory_order_relaxed);
+    return;
+  }
+  s_trace[count].timeUs = timeUs;
+  s_trace[count].report = report;
+  s_traceCount.store(count + 1, std::memory_order_release);
+}
+
+// Hands the contacts of report to Qul: filtered positions for presses and
+// releases, positions extrapolated to displayUs for contacts still moving.
+static void deliver(const TouchReport &report, uint32_t displayUs) {
+  Qul::PlatformInterface::TouchPoint points[16];
+  unsigned count = 0;
+  uint16_t down = 0;
+  const bool predict = s_predict.load(std::memory_order_relaxed);
+  for (uint8_t i = 0; i < report.count; i++) {
+    const TouchPointRaw &raw = report.points[i];
+    const uint16_t bit = (uint16_t)(1U << raw.id);
+    const bool moved = (s_down & bit) != 0;
+    float x, y;
+    if (moved && predict) {
+      s_filter.predict(raw.id, displayUs, x, y);
+    } else {
+      s_filter.position(raw.id, x, y);
+    }
+    Qul::PlatformInterface::TouchPoint &point = points[count++];
+    point.id = raw.id;
+    point.positionX = x < 0.0f ? 0.0f : x;
+    point.positionY = y < 0.0f ? 0.0f : y;
+    point.areaX = raw.size;
+    point.areaY = raw.size;
+    point.pressure = 1.0f;
+    point.rotation = 0.0f;
+    point.state = moved ? Qul::PlatformInterface::TouchPoint::Moved
+                        : Qul::PlatformInterface::TouchPoint::Pressed;
+    down |= bit;
+  }
+  const uint16_t released = (uint16_t)(s_down & ~down);
+  for (uint8_t id = 0; id < 16 && count < 16; id++) {
+    if (released & (1U << id)) {
+      float x, y;
+      s_filter.position(id, x, y);
+      s_filter.release(id);
+      Qul::PlatformInterface::TouchPoint &point = points[count++];
+      point.id = id;
+      point.positionX = x;
+      point.positionY = y;
+      point.areaX = 0.0f;
+      point.areaY = 0.0f;
+      point.pressure = 0.0f;
+      point.rotation = 0.0f;
+      point.state = Qul::PlatformInterface::TouchPoint::Released;
+    }
+  }
+  s_down = down;
+  if (count != 0) {
+    Qul::PlatformInterface::handleTouchEvent(
+        nullptr, (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS, points, count);
+  }
+}
+
+static void trackLatency(const TouchReport &report) {
+  static uint32_t handled;
+  const uint32_t cycles = CycleCounter_Read() - report.irqCycles;
+  handled++;
+  s_toUiCyclesTotal += cycles;
+  s_stats.toUiAvgUs = CycleCounter_ToUs((uint32_t)(s_toUiCyclesTotal / handled));
+  if (CycleCounter_ToUs(cycles) > s_stats.toUiMaxUs) {
+    s_stats.toUiMaxUs = CycleCounter_ToUs(cycles);
+  }
+}
+
+// Every sample feeds the filter, but only reports that press or lift a
+// contact are delivered one by one. Runs of pure moves collapse into the
+// newest one, delivered once at the end of the drain.
+void Touch_Dispatch(uint32_t displayLeadUs) {
+  const uint32_t displayUs = advanceClock() + displayLeadUs;
+  TouchReport latest;
+  bool pending = false;
+  s_queue.drain([&](const TouchReport &report) {
+    const uint32_t timeUs = sampleTime(report);
+    record(report, timeUs);
+    uint16_t down = 0;
+    for (uint8_t i = 0; i < report.count; i++) {
+      const TouchPointRaw &raw = report.points[i];
+      s_filter.update(raw.id, raw.x, raw.y, timeUs);
+      down |= (uint16_t)(1U << raw.id);
+    }
+    if (pending) {
+      s_stats.merged++;
+    }
+    if (down != s_down) {
+      deliver(report, displayUs);
+      pending = false;
+    } else {
+      latest = report;
+      pending = true;
+    }
+    trackLatency(report);
+  });
+  if (pending) {
+    deliver(latest, displayUs);
+  }
+}
+
+void Touch_GetStats(TouchStats &out) { out = s_stats; }
+
+// One line per report, read back by tools/touch_replay.cpp:
+//   TCH <us> <n> [<id> <x> <y>]...
+//   TCH .
+static void dumpTrace() {
+  s_recording.store(false, std::memory_order_relaxed);
+  const uint32_t count = s_traceCount.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count; i++) {
+    const TouchReport &report = s_trace[i].report;
+    char line[128];
+    int length = snprintf(line, sizeof(line), "TCH %u %u", (unsigned)s_trace[i].timeUs,
+                          (unsigned)report.count);
+    for (uint8_t p = 0; p < report.count && length > 0 && (size_t)length < sizeof(line); p++) {
+      length += snprintf(line + length, sizeof(line) - (size_t)length, " %u %u %u",
+                         (unsigned)report.points[p].id, (unsigned)report.points[p].x,
+                         (unsigned)report.points[p].y);
+    }
+    Qul::PlatformInterface::log("%s\r\n", line);
+  }
+  Qul::PlatformInterface::log("TCH .\r\n");
+}
+
+static void touchCommand(const char *args) {
+  if (DebugConsole_ArgIs(args, "rec")) {
+    s_traceCount.store(0, std::memory_order_relaxed);
+    s_recording.store(true, std::memory_order_relaxed);
+    Qul::PlatformInterface::log("recording up to %u reports\r\n", (unsigned)TOUCH_TRACE_DEPTH);
+    return;
+  }
+  if (DebugConsole_ArgIs(args, "dump")) {
+    dumpTrace();
+    return;
+  }
+  if (DebugConsole_ArgIs(args, "predict")) {
+    bool on;
+    if (!DebugConsole_ArgOnOff(args, on)) {
+      Qul::PlatformInterface::log("usage: touch predict on|off\r\n");
+      return;
+    }
+    s_predict.store(on, std::memory_order_relaxed);
+  }
+  TouchStats stats;
+  Touch_GetStats(stats);
+  Qul::PlatformInterface::log("%u irqs, %u reports, %u coalesced, %u merged, %u errors, %u dropped\r\n",
+                              (unsigned)stats.interrupts, (unsigned)stats.reports,
+                              (unsigned)stats.coalesced, (unsigned)stats.merged,
+                              (unsigned)stats.errors, (unsigned)stats.dropped);
+  Qul::PlatformInterface::log("  irq->report avg %u us, max %u us\r\n", (unsigned)stats.burstAvgUs,
+                              (unsigned)stats.burstMaxUs);
+  Qul::PlatformInterface::log("  irq->UI     avg %u us, max %u us\r\n", (unsigned)stats.toUiAvgUs,
+                              (unsigned)stats.toUiMaxUs);
+  Qul::PlatformInterface::log("  prediction %s\r\n",
+                              s_predict.load(std::memory_order_relaxed) ? "on" : "off");
+}
+
+static void delayMs(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms) != 0 ? pdMS_TO_TICKS(ms) : 1); }
+
+static void pullResetPin(bool pullUp) {
+  GPIO_PinWrite(BOARD_MIPI_PANEL_TOUCH_RST_GPIO, BOARD_MIPI_PANEL_TOUCH_RST_PIN, pullUp ? 1U : 0U);
+}
+
+// The GT911 samples INT during reset to pick its I2C address.
+static void configIntPin(gt911_int_pin_mode_t mode) {
+  if (mode == kGT911_IntPinInput) {
+    TOUCH_INT_GPIO->GDIR &= ~(1UL << TOUCH_INT_PIN);
+    return;
+  }
+  GPIO_PinWrite(TOUCH_INT_GPIO, TOUCH_INT_PIN, mode == kGT911_IntPinPullUp ? 1U : 0U);
+  TOUCH_INT_GPIO->GDIR |= (1UL << TOUCH_INT_PIN);
+}
+
+bool Touch_Init() {
+  const gpio_pin_config_t resetPin = {kGPIO_DigitalOutput, 0, kGPIO_NoIntmode};
+  GPIO_PinInit(BOARD_MIPI_PANEL_TOUCH_RST_GPIO, BOARD_MIPI_PANEL_TOUCH_RST_PIN, &resetPin);
+
+  BOARD_MIPIPanelTouch_I2C_Init();
+  const gt911_config_t config = {
+      BOARD_MIPIPanelTouch_I2C_Send,
+      BOARD_MIPIPanelTouch_I2C_Receive,
+      delayMs,
+      configIntPin,
+      pullResetPin,
+      TOUCH_MAX_POINTS,
+      kGT911_I2cAddrMode0,
+      kGT911_IntRisingEdge,
+  };
+  if (GT911_Init(&s_gt911, &config) != kStatus_Success) {
+    Qul::PlatformInterface::log("GT911 init failed\r\n");
+    return false;
+  }
+
+  // Reads jump ahead of codec and accelerometer traffic on the shared bus.
+  I2cBus_SetDevicePriority(TOUCH_I2C, (uint8_t)s_gt911.i2cAddr, I2cPriority::Input);
+  s_readRequest.address = (uint8_t)s_gt911.i2cAddr;
+  s_readRequest.read = true;
+  s_readRequest.subaddress = GT911_STATUS_REG;
+  s_readRequest.subaddressSize = 2;
+  s_readRequest.data = s_rx;
+  s_readRequest.size = sizeof(s_rx);
+  s_readRequest.priority = I2cPriority::Input;
+  s_readRequest.done = transferDone;
+  s_clearRequest = s_readRequest;
+  s_clearRequest.read = false;
+  s_clearRequest.data = s_clear;
+  s_clearRequest.size = sizeof(s_clear);
+  NVIC_SetPriority(TOUCH_INT_IRQ, I2C_BUS_IRQ_PRIORITY);
+
+  const gpio_pin_config_t intPin = {kGPIO_DigitalInput, 0, kGPIO_IntRisingEdge};
+  GPIO_PinInit(TOUCH_INT_GPIO, TOUCH_INT_PIN, &intPin);
+  GPIO_PortClearInterruptFlags(TOUCH_INT_GPIO, 1UL << TOUCH_INT_PIN);
+  GPIO_PortEnableInterrupts(TOUCH_INT_GPIO, 1UL << TOUCH_INT_PIN);
+  (void)EnableIRQ(TOUCH_INT_IRQ);
+
+  DebugConsole_Register("touch", "touch interrupt and latency statistics", touchCommand);
+  return true;
+}
+
+#else
+
+bool Touch_Init() { return false; }
+
+void Touch_SetWakeTarget(TaskHandle_t task, uint32_t bits) {
+  (void)task;
+  (void)bits;
+}
+
+void Touch_Dispatch(uint32_t displayLeadUs) { (void)displayLeadUs; }
+
+void Touch_GetStats(TouchStats &out) { out = TouchStats(); }
+
+#endif /* APP_TOUCH_IRQ */
@@ -0,0 +1,94 @@
+#ifndef TOUCH_GT911_H
+#define TOUCH_GT911_H
+
+#include <FreeRTOS.h>
+#include <stdint.h>
+#include <task.h>
+
+/*
+ * Interrupt-driven GT911 touch on LPI2C5 (APP_TOUCH_IRQ=1).
+ *
+ * The controller raises GPIO2 pin 31 when it has a new report. The GPIO ISR
+ * queues a read of the status byte and all point records in one burst on the
+ * shared LPI2C5 queue (i2c_bus.h) at Input priority, ahead of any codec or
+ * accelerometer traffic. The completion callback decodes the points into a
+ * lock-free ring, wakes the frame loop and then clears the controller's
+ * buffer-ready flag with a second request. An interrupt that arrives while a
+ * burst is in flight is remembered and serviced right after it, so no task
+ * ever waits on the bus.
+ *
+ * The frame loop calls Touch_Dispatch() at the start of each frame. Every
+ * queued sample goes through a jitter filter (touch_filter.h), but a run of
+ * pure moves reaches Qul as one event carrying the newest position,
+ * extrapolated to when the frame will be on the panel. Presses and releases
+ * are always delivered in order.
+ *
+ * The Qul platform BSP polls the same controller by default. Build with
+ * APP_TOUCH_IRQ only together with platform glue that has its own GT911
+ * polling and GPIO2_Combined_16_31 handler removed.
+ *
+ * "touch" on the console prints interrupt, burst and IRQ-to-UI latency
+ * statistics; "touch predict off" delivers filtered positions only. "touch
+ * rec" records raw reports and "touch dump" prints them for
+ * tools/touch_replay.cpp, which measures prediction error on the host.
+ */
+
+#ifndef APP_TOUCH_IRQ
+#define APP_TOUCH_IRQ 0
+#endif
+
+#ifndef TOUCH_MAX_POINTS
+#define TOUCH_MAX_POINTS 5
+#endif
+
+/* Reports buffered between two frames, must be a power of two. */
+#ifndef TOUCH_QUEUE_DEPTH
+#define TOUCH_QUEUE_DEPTH 32
+#endif
+
+/* Reports kept by "touch rec". */
+#ifndef TOUCH_TRACE_DEPTH
+#define TOUCH_TRACE_DEPTH 512
+#endif
+
+struct TouchPointRaw {
+  uint8_t id;
+  uint16_t x;
+  uint16_t y;
+  uint16_t size;
+};
+
+struct TouchReport {
+  uint8_t count;
+  TouchPointRaw points[TOUCH_MAX_POINTS];
+  uint32_t irqCycles; // CYCCNT when the controller raised its interrupt
+};
+
+struct TouchStats {
+  uint32_t interrupts;
+  uint32_t reports;
+  uint32_t errors;      // failed bursts
+  uint32_t coalesced;   // interrupts folded into a burst already in flight
+  uint32_t merged;      // move reports superseded by a newer one in the same frame
+  uint32_t dropped;     // reports lost to a full queue
+  uint32_t burstAvgUs;  // interrupt to decoded report
+  uint32_t burstMaxUs;
+  uint32_t toUiAvgUs;   // interrupt to Qul event
+  uint32_t toUiMaxUs;
+};
+
+// Resets and configures the GT911 and enables the touch interrupt. Needs
+// I2cBus_Init(). Blocking; call once from a task before the frame loop
+// starts. Registers the "touch" console command.
+bool Touch_Init();
+
+// Notify task with bits (eSetBits) whenever a report is queued.
+void Touch_SetWakeTarget(TaskHandle_t task, uint32_t bits);
+
+// UI thread only. Hands the queued reports to Qul, predicting moving contacts
+// displayLeadUs ahead.
+void Touch_Dispatch(uint32_t displayLeadUs);
+
+void Touch_GetStats(TouchStats &out);
+
+#endif // TOUCH_GT911_H
@@ -0,0 +1,353 @@
+// Replays an allocation trace against the size-class pools of
+// src/cpp_config.cpp and against plain heap_4, on the host.
+//
+//   g++ -std=gnu++14 -O2 -Isrc tools/alloc_replay.cpp src/pool_allocator.cpp -o alloc_replay
+//   ./alloc_replay [trace | --write trace]
+//
+// A trace is one operation per line, "+ <id> <size>" for an allocation and
+// "- <id>" for freeing the block allocated under that id. Without a file a
+// synthetic trace is generated: frames of short-lived UI allocations (mostly
+// up to 256 bytes, strings and nodes, freed within a few frames) over a
+// population of long-lived objects and a few large buffers. --write stores
+// that trace instead of replaying it.
+//
+// Both runs use an arena of configTOTAL_HEAP_SIZE. "heap_4" is a model of
+// FreeRTOS 10.5.1 heap_4.c with its 32-bit block header: first fit over an
+// address-ordered free list, splitting and coalescing on free.
+// "pools + heap_4" first takes CPP_POOL_ARENA_SIZE out of that heap for a
+// PoolAllocator and sends requests up to MaxBlockSize there, as cppAlloc()
+// does. Reported: time per operation, free-list blocks visited per heap_4
+// call, and the longest heap_4 free list and worst fragmentation (1 - largest
+// free block / free bytes) seen every 4096 operations. Every block is
+// stamped with its id and checked on free; the tool exits 1 if two live
+// blocks overlapped or an allocation failed.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "pool_allocator.h"
+
+static const size_t HeapSize = 15 * 1024 * 1024; // configTOTAL_HEAP_SIZE
+static const size_t PoolArenaSize = 2 * 1024 * 1024; // CPP_POOL_ARENA_SIZE
+
+struct Op {
+  bool alloc;
+  uint32_t id;
+  uint32_t size;
+};
+
+// heap_4.c with offsets instead of pointers, so the block header is 8 bytes
+// as on the M7.
+class Heap4 {
+public:
+  explicit Heap4(size_t size) : heap_(size) {
+    start_.next = 0;
+    start_.size = 0;
+    Block *first = at(Alignment);
+    first->size = (uint32_t)(size - 2 * Alignment);
+    first->next = End;
+    start_.next = Alignment;
+  }
+
+  void *malloc(size_t wanted) {
+    calls_++;
+    wanted += HeaderSize;
+    wanted = (wanted + Alignment - 1) & ~(size_t)(Alignment - 1);
+    Block *previous = &start_;
+    uint32_t offset = start_.next;
+    while (offset != End && at(offset)->size < wanted) {
+      visited_++;
+      previous = at(offset);
+      offset = previous->next;
+    }
+    if (offset == End) {
+      return nullptr;
+    }
+    visited_++;
+    Block *block = at(offset);
+    previous->next = block->next;
+    if (block->size - wanted > MinimumBlockSize) {
+      Block *rest = at(offset + (uint32_t)wanted);
+      rest->size = block->size - (uint32_t)wanted;
+      block->size = (uint32_t)wanted;
+      insert(offset + (uint32_t)wanted);
+    }
+    block->size |= Allocated;
+    block->next = End;
+    return heap_.data() + offset + HeaderSize;
+  }
+
+  void free(void *p) {
+    calls_++;
+    const uint32_t offset = (uint32_t)(static_cast<uint8_t *>(p) - heap_.data() - HeaderSize);
+    at(offset)->size &= ~Allocated;
+    insert(offset);
+  }
+
+  // Free bytes, free blocks and the largest of them.
+  void freeSpace(size_t &bytes, size_t &blocks, size_t &largest) const {
+    bytes = blocks = largest = 0;
+    for (uint32_t offset = start_.next; offset != End; offset = at(offset)->next) {
+      const size_t size = at(offset)->size;
+      bytes += size;
+      blocks++;
+      largest = size > largest ? size : largest;
+    }
+  }
+
+  uint64_t calls() const { return calls_; }
+  uint64_t visited() const { return visited_; }
+
+private:
+  struct Block {
+    uint32_t next;
+    uint32_t size;
+  };
+  static const uint32_t Alignment = 8;
+  static const uint32_t HeaderSize = sizeof(Block);
+  static const uint32_t MinimumBlockSize = HeaderSize * 2;
+  static const uint32_t Allocated = 0x80000000U;
+  static const uint32_t End = 0xFFFFFFFFU;
+
+  Block *at(uint32_t offset) { return reinterpret_cast<Block *>(heap_.data() + offset); }
+  const Block *at(uint32_t offset) const { return reinterpret_cast<const Block *>(heap_.data() + offset); }
+
+  // prvInsertBlockIntoFreeList(): walk to the position by address and merge
+  // with the neighbours.
+  void insert(uint32_t offset) {
+    Block *block = at(offset);
+    Block *previous = &start_;
+    uint32_t previousOffset = 0;
+    while (previous->next != End && previous->next < offset) {
+      visited_++;
+      previousOffset = previous->next;
+      previous = at(previousOffset);
+    }
+    if (previous != &start_ && previousOffset + previous->size == offset) {
+      previous->size += block->size;
+      block = previous;
+      offset = previousOffset;
+    }
+    const uint32_t next = previous->next;
+    if (next != End && offset + block->size == next) {
+      block->size += at(next)->size;
+      block->next = at(next)->next;
+    } else {
+      block->next = next;
+    }
+    if (block != previous) {
+      previous->next = offset;
+    }
+  }
+
+  std::vector<uint8_t> heap_;
+  Block start_;
+  uint64_t calls_ = 0;
+  uint64_t visited_ = 0;
+};
+
+static std::vector<Op> generate(uint32_t frames) {
+  std::vector<Op> ops;
+  std::vector<uint32_t> live;                   // long-lived ids
+  std::vector<std::vector<uint32_t>> expiry(4); // transient ids by frames left
+  uint32_t seed = 0x2545F491U;
+  uint32_t nextId = 0;
+  auto rnd = [&](uint32_t n) {
+    seed = seed * 1664525U + 1013904223U;
+    return (seed >> 8) % n;
+  };
+  auto size = [&]() -> uint32_t {
+    const uint32_t r = rnd(100);
+    if (r < 60) {
+      return 8 + rnd(57); // strings, small nodes
+    }
+    if (r < 85) {
+      return 65 + rnd(192);
+    }
+    if (r < 97) {
+      return 257 + rnd(256);
+    }
+    return 513 + rnd(16 * 1024); // buffers beyond the pools
+  };
+
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    for (uint32_t id : expiry[0]) {
+      ops.push_back(Op{false, id, 0});
+    }
+    expiry[0].swap(expiry[1]);
+    expiry[1].swap(expiry[2]);
+    expiry[2].swap(expiry[3]);
+    expiry[3].clear();
+
+    const uint32_t transient = 100 + rnd(200);
+    for (uint32_t i = 0; i < transient; i++) {
+      ops.push_back(Op{true, nextId, size()});
+      expiry[rnd(4)].push_back(nextId++);
+    }
+    // The long-lived population turns over slowly around 5000 objects.
+    for (uint32_t i = rnd(20); i > 0; i--) {
+      if (live.size() > 5000 || (!live.empty() && rnd(2) == 0)) {
+        const uint32_t pick = rnd((uint32_t)live.size());
+        ops.push_back(Op{false, live[pick], 0});
+        live[pick] = live.back();
+        live.pop_back();
+      } else {
+        ops.push_back(Op{true, nextId, size()});
+        live.push_back(nextId++);
+      }
+    }
+  }
+  for (const std::vector<uint32_t> &ids : expiry) {
+    for (uint32_t id : ids) {
+      ops.push_back(Op{false, id, 0});
+    }
+  }
+  for (uint32_t id : live) {
+    ops.push_back(Op{false, id, 0});
+  }
+  return ops;
+}
+
+static bool load(const char *path, std::vector<Op> &ops) {
+  FILE *f = fopen(path, "r");
+  if (f == nullptr) {
+    return false;
+  }
+  char kind;
+  unsigned id, size;
+  while (fscanf(f, " %c %u", &kind, &id) == 2) {
+    size = 0;
+    if (kind == '+' && fscanf(f, "%u", &size) != 1) {
+      break;
+    }
+    ops.push_back(Op{kind == '+', id, size});
+  }
+  fclose(f);
+  return true;
+}
+
+struct Run {
+  double nsPerOp;
+  size_t maxFreeBlocks;
+  uint32_t worstFragmentation; // permille
+  bool ok;
+};
+
+static Run replay(const std::vector<Op> &ops, uint32_t maxId, Heap4 &heap, PoolAllocator *pool) {
+  std::vector<void *> blocks(maxId + 1, nullptr);
+  std::vector<uint32_t> sizes(maxId + 1, 0);
+  Run run = {0, 0, 0, true};
+  std::chrono::steady_clock::duration elapsed{0};
+  auto start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < ops.size(); n++) {
+    const Op &op = ops[n];
+    if ((n & 4095) == 4095) {
+      // Sampling is not part of the timing.
+      elapsed += std::chrono::steady_clock::now() - start;
+      size_t bytes, blocks, largest;
+      heap.freeSpace(bytes, blocks, largest);
+      const uint32_t fragmentation = bytes != 0 ? (uint32_t)(1000 - largest * 1000 / bytes) : 0;
+      run.maxFreeBlocks = blocks > run.maxFreeBlocks ? blocks : run.maxFreeBlocks;
+      run.worstFragmentation =
+          fragmentation > run.worstFragmentation ? fragmentation : run.worstFragmentation;
+      start = std::chrono::steady_clock::now();
+    }
+    if (op.alloc) {
+      void *p = pool != nullptr ? pool->allocate(op.size) : nullptr;
+      if (p == nullptr) {
+        p = heap.malloc(op.size);
+      }
+      if (p == nullptr) {
+        printf("allocation %u of %u bytes failed\n", (unsigned)op.id, (unsigned)op.size);
+        run.ok = false;
+        return run;
+      }
+      if (op.size >= sizeof(uint32_t)) {
+        memcpy(p, &op.id, sizeof(uint32_t));
+      }
+      blocks[op.id] = p;
+      sizes[op.id] = op.size;
+    } else {
+      void *p = blocks[op.id];
+      uint32_t stamp = op.id;
+      if (p != nullptr && sizes[op.id] >= sizeof(uint32_t)) {
+        memcpy(&stamp, p, sizeof(uint32_t));
+      }
+      run.ok &= stamp == op.id;
+      if (pool != nullptr && pool->owns(p)) {
+        pool->deallocate(p);
+      } else if (p != nullptr) {
+        heap.free(p);
+      }
+      blocks[op.id] = nullptr;
+    }
+  }
+  elapsed += std::chrono::steady_clock::now() - start;
+  run.nsPerOp = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / ops.size();
+  if (!run.ok) {
+    printf("a block was overwritten while live\n");
+  }
+  return run;
+}
+
+static void report(const char *name, const Run &run, const Heap4 &heap) {
+  printf("%-15s %7.1f ns/op  heap_4 calls %9llu  visited %6.1f blocks/call  free list <= %zu blocks  "
+         "fragmentation <= %u.%u%%\n",
+         name, run.nsPerOp, (unsigned long long)heap.calls(),
+         heap.calls() != 0 ? (double)heap.visited() / heap.calls() : 0.0, run.maxFreeBlocks,
+         (unsigned)(run.worstFragmentation / 10), (unsigned)(run.worstFragmentation % 10));
+}
+
+int main(int argc, char **argv) {
+  std::vector<Op> ops;
+  const char *path = argc > 1 && strcmp(argv[1], "--write") != 0 ? argv[1] : nullptr;
+  if (path != nullptr) {
+    if (!load(path, ops)) {
+      fprintf(stderr, "cannot read %s\n", path);
+      return 2;
+    }
+  } else {
+    ops = generate(20000);
+  }
+  if (argc > 2 && strcmp(argv[1], "--write") == 0) {
+    FILE *f = fopen(argv[2], "w");
+    if (f == nullptr) {
+      fprintf(stderr, "cannot write %s\n", argv[2]);
+      return 2;
+    }
+    for (const Op &op : ops) {
+      op.alloc ? fprintf(f, "+ %u %u\n", (unsigned)op.id, (unsigned)op.size) : fprintf(f, "- %u\n", (unsigned)op.id);
+    }
+    fclose(f);
+    return 0;
+  }
+
+  uint32_t maxId = 0;
+  size_t allocs = 0, small = 0;
+  for (const Op &op : ops) {
+    maxId = op.id > maxId ? op.id : maxId;
+    allocs += op.alloc;
+    small += op.alloc && op.size <= PoolAllocator::MaxBlockSize;
+  }
+  printf("%zu operations, %zu allocations, %zu%% up to %zu bytes\n", ops.size(), allocs,
+         allocs != 0 ? small * 100 / allocs : 0, PoolAllocator::MaxBlockSize);
+
+  Heap4 plain(HeapSize);
+  const Run heapOnly = replay(ops, maxId, plain, nullptr);
+
+  Heap4 fallback(HeapSize);
+  PoolAllocator pool;
+  void *arena = fallback.malloc(PoolArenaSize);
+  pool.init(arena, PoolArenaSize);
+  const Run pooled = replay(ops, maxId, fallback, &pool);
+
+  report("heap_4", heapOnly, plain);
+  report("pools + heap_4", pooled, fallback);
+  PoolAllocator::Stats stats;
+  pool.stats(stats);
+  printf("pool pages used %zu/%zu\n", stats.pagesUsed, stats.pagesTotal);
+  return heapOnly.ok && pooled.ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Turn a boot asset manifest into the tables of src/asset_manifest.h.
+
+The manifest is a text file with one asset per line; '#' starts a comment:
+
+    image ID NAME FILE.qoi [pinned] [preload]
+    font FONT_ID PIXEL_SIZE TEXT [pinned]
+
+An image becomes an ImageAsset (src/image_cache.h) shown to QML as
+image://cache/NAME, its QOI data embedded as a const table in flash; width
+and height come from the QOI header. A font line asks for the glyphs of TEXT
+(no spaces) at PIXEL_SIZE to be rasterized into the glyph cache on the Qul
+thread (GlyphCache_Prewarm). File names are relative to the manifest.
+
+    asset_manifest.py -o asset_manifest_data.cpp assets/manifest.txt
+
+armgcc/CMakeLists.txt runs this at build time with APP_ASSET_MANIFEST.
+--depends prints the image files instead, one per line, for the build's
+dependency list.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+
+class ManifestError(Exception):
+    pass
+
+
+def c_string(text):
+    return '"%s"' % text.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def parse(path):
+    images = []
+    fonts = []
+    base = os.path.dirname(os.path.abspath(path))
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split("#", 1)[0].split()
+            if not fields:
+                continue
+            where = "%s:%d" % (path, number)
+            kind, args = fields[0], fields[1:]
+            if kind == "image" and len(args) >= 3 and set(args[3:]) <= {"pinned", "preload"}:
+                images.append({
+                    "id": int(args[0], 0),
+                    "name": args[1],
+                    "file": os.path.join(base, args[2]),
+                    "pinned": "pinned" in args[3:],
+                    "preload": "preload" in args[3:],
+                    "where": where,
+                })
+            elif kind == "font" and len(args) >= 3 and set(args[3:]) <= {"pinned"}:
+                fonts.append({
+                    "font": int(args[0], 0),
+                    "size": int(args[1], 0),
+                    "text": args[2],
+                    "pinned": "pinned" in args[3:],
+                })
+            else:
+                raise ManifestError("%s: expected 'image ID NAME FILE.qoi [pinned] [preload]' or "
+                                    "'font FONT_ID PIXEL_SIZE TEXT [pinned]'" % where)
+    ids = [image["id"] for image in images]
+    names = [image["name"] for image in images]
+    if len(set(ids)) != len(ids) or len(set(names)) != len(names):
+        raise ManifestError("%s: image ids and names must be unique" % path)
+    return images, fonts
+
+
+def qoi_size(image):
+    with open(image["file"], "rb") as f:
+        data = f.read()
+    if len(data) < 22 or data[:4] != b"qoif":
+        raise ManifestError("%s: %s is not a QOI image" % (image["where"], image["file"]))
+    width, height = struct.unpack(">II", data[4:12])
+    if width == 0 or height == 0 or width > 0xFFFF or height > 0xFFFF:
+        raise ManifestError("%s: %s is %ux%u" % (image["where"], image["file"], width, height))
+    return data, width, height
+
+
+def emit(images, fonts):
+    out = ["// Generated by tools/asset_manifest.py. Do not edit.", "",
+           '#include "asset_manifest.h"', ""]
+    for i, image in enumerate(images):
+        data, image["width"], image["height"] = qoi_size(image)
+        image["size"] = len(data)
+        out.append("alignas(4) static const uint8_t s_image%d[%d] = {" % (i, len(data)))
+        for row in range(0, len(data), 16):
+            out.append("    " + ", ".join("0x%02x" % b for b in data[row:row + 16]) + ",")
+        out.append("};")
+        out.append("")
+    out.append("extern const ImageAsset AssetManifest_Images[%d] = {" % max(len(images), 1))
+    for i, image in enumerate(images):
+        out.append("    {%uU, %s, %u, %u, PixelFormat::Argb8888, s_image%d, %uU, nullptr, %s, %s}," % (
+            image["id"], c_string(image["name"]), image["width"], image["height"], i, image["size"],
+            "true" if image["pinned"] else "false", "true" if image["preload"] else "false"))
+    out.append("};")
+    out.append("extern const uint32_t AssetManifest_ImageCount = %d;" % len(images))
+    out.append("")
+    out.append("extern const AssetFont AssetManifest_Fonts[%d] = {" % max(len(fonts), 1))
+    for font in fonts:
+        out.append("    {%u, %u, %s, %s}," % (font["font"], font["size"], c_string(font["text"]),
+                                              "true" if font["pinned"] else "false"))
+    out.append("};")
+    out.append("extern const uint32_t AssetManifest_FontCount = %d;" % len(fonts))
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("manifest", help="manifest file")
+    parser.add_argument("-o", "--output", help="C++ file to write")
+    parser.add_argument("--depends", action="store_true", help="print the image files and exit")
+    args = parser.parse_args()
+    try:
+        images, fonts = parse(args.manifest)
+        if args.depends:
+            for image in images:
+                print(image["file"])
+            return 0
+        if not args.output:
+            parser.error("-o is required")
+        source = emit(images, fonts)
+    except (ManifestError, OSError, ValueError) as e:
+        print("asset_manifest.py: %s" % e, file=sys.stderr)
+        return 1
+    with open(args.output, "w") as f:
+        f.write(source)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
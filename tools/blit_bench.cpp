@@ -0,0 +1,234 @@
+// Checks the CPU blit kernel (src/blit.cpp) pixel for pixel against a
+// straightforward reference and times both on the host.
+//
+//   g++ -std=gnu++14 -O2 -Isrc tools/blit_bench.cpp src/blit.cpp -o blit_bench
+//   ./blit_bench [--quick]
+//
+// The reference follows the definition in src/blit.h literally: it scales
+// the source into a temporary image of the unrotated size, rotates that into
+// a second one, and converts and blends one pixel at a time with plain
+// arithmetic. Every format pair, rotation, a set of scale factors and
+// opacities are run on random pixels into a larger random destination, so
+// writes outside the rectangle are caught too. Exits 1 on the first
+// mismatch.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "blit.h"
+
+struct Argb {
+  uint32_t a, r, g, b;
+};
+
+static uint32_t widen(uint32_t value, uint32_t bits) {
+  // Bit replication: the top bits repeat below the value.
+  uint32_t out = value << (8U - bits);
+  for (uint32_t shift = bits; shift < 8U; shift += bits) {
+    out |= (value << (8U - bits)) >> shift;
+  }
+  return out & 0xFFU;
+}
+
+static Argb load(const uint8_t *p, PixelFormat format) {
+  if (format == PixelFormat::Argb8888) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return Argb{v >> 24, (v >> 16) & 0xFF, (v >> 8) & 0xFF, v & 0xFF};
+  }
+  uint16_t v;
+  memcpy(&v, p, 2);
+  if (format == PixelFormat::Rgb565) {
+    return Argb{255, widen(v >> 11, 5), widen((v >> 5) & 0x3F, 6), widen(v & 0x1F, 5)};
+  }
+  return Argb{widen(v >> 12, 4), widen((v >> 8) & 0xF, 4), widen((v >> 4) & 0xF, 4), widen(v & 0xF, 4)};
+}
+
+static void store(uint8_t *p, PixelFormat format, Argb c) {
+  if (format == PixelFormat::Argb8888) {
+    const uint32_t v = c.a << 24 | c.r << 16 | c.g << 8 | c.b;
+    memcpy(p, &v, 4);
+    return;
+  }
+  uint16_t v;
+  if (format == PixelFormat::Rgb565) {
+    v = (uint16_t)((c.r >> 3) << 11 | (c.g >> 2) << 5 | (c.b >> 3));
+  } else {
+    v = (uint16_t)((c.a >> 4) << 12 | (c.r >> 4) << 8 | (c.g >> 4) << 4 | (c.b >> 4));
+  }
+  memcpy(p, &v, 2);
+}
+
+static uint32_t divRound255(uint32_t x) { return (2U * x + 255U) / 510U; }
+
+static void reference(const BlitSurface &dst, const BlitSurface &src, const BlitOp &op) {
+  const bool swap = op.rotation == BlitRotation::Rot90 || op.rotation == BlitRotation::Rot270;
+  const uint32_t wr = swap ? op.height : op.width;
+  const uint32_t hr = swap ? op.width : op.height;
+  const uint32_t srcBpp = Blit_BytesPerPixel(src.format);
+  const uint32_t dstBpp = Blit_BytesPerPixel(dst.format);
+
+  std::vector<Argb> scaled(wr * hr);
+  for (uint32_t y = 0; y < hr; y++) {
+    for (uint32_t x = 0; x < wr; x++) {
+      const uint32_t sx = (uint32_t)((uint64_t)x * src.width / wr);
+      const uint32_t sy = (uint32_t)((uint64_t)y * src.height / hr);
+      scaled[y * wr + x] = load(static_cast<const uint8_t *>(src.pixels) + sy * src.stride + sx * srcBpp, src.format);
+    }
+  }
+  std::vector<Argb> turned(op.width * op.height);
+  for (uint32_t y = 0; y < op.height; y++) {
+    for (uint32_t x = 0; x < op.width; x++) {
+      uint32_t ox = x, oy = y;
+      switch (op.rotation) {
+      case BlitRotation::None:
+        break;
+      case BlitRotation::Rot90: // new(x, y) = old(y, h - 1 - x)
+        ox = y;
+        oy = hr - 1 - x;
+        break;
+      case BlitRotation::Rot180:
+        ox = wr - 1 - x;
+        oy = hr - 1 - y;
+        break;
+      case BlitRotation::Rot270: // new(x, y) = old(w - 1 - y, x)
+        ox = wr - 1 - y;
+        oy = x;
+        break;
+      }
+      turned[y * op.width + x] = scaled[oy * wr + ox];
+    }
+  }
+  for (uint32_t y = 0; y < op.height; y++) {
+    for (uint32_t x = 0; x < op.width; x++) {
+      uint8_t *p = static_cast<uint8_t *>(dst.pixels) + (op.y + y) * dst.stride + (op.x + x) * dstBpp;
+      Argb s = turned[y * op.width + x];
+      if (op.blend) {
+        const Argb d = load(p, dst.format);
+        const uint32_t a = divRound255(s.a * op.opacity);
+        s.r = divRound255(s.r * a + d.r * (255 - a));
+        s.g = divRound255(s.g * a + d.g * (255 - a));
+        s.b = divRound255(s.b * a + d.b * (255 - a));
+        s.a = a + divRound255(d.a * (255 - a));
+      }
+      store(p, dst.format, s);
+    }
+  }
+}
+
+struct Image {
+  std::vector<uint8_t> bytes;
+  BlitSurface surface;
+
+  Image(uint16_t width, uint16_t height, PixelFormat format, uint32_t padding) {
+    surface.width = width;
+    surface.height = height;
+    surface.format = format;
+    surface.stride = (width + padding) * Blit_BytesPerPixel(format);
+    bytes.resize(surface.stride * height);
+    for (uint8_t &b : bytes) {
+      b = (uint8_t)rand();
+    }
+    surface.pixels = bytes.data();
+  }
+};
+
+static const char *const s_formatNames[] = {"565", "4444", "8888"};
+static const char *const s_rotationNames[] = {"0", "90", "180", "270"};
+
+static double seconds(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+int main(int argc, char **argv) {
+  const bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+  srand(1);
+
+  for (uint32_t x = 0; x <= 255U * 255U; x++) {
+    if ((((x + 128U) * 257U) >> 16) != divRound255(x)) {
+      printf("div255 differs at %u\n", x);
+      return 1;
+    }
+  }
+
+  static const uint16_t sizes[][4] = {
+      // source w, h -> destination w, h (after rotation)
+      {64, 48, 64, 48},
+      {37, 29, 37, 29},
+      {96, 64, 48, 32}, // 2x down
+      {40, 30, 61, 45}, // ~1.5x up
+      {33, 71, 70, 19},
+  };
+  static const uint8_t opacities[] = {255, 128, 0};
+  uint32_t cases = 0;
+  for (const auto &size : sizes) {
+    for (int sf = 0; sf < 3; sf++) {
+      for (int df = 0; df < 3; df++) {
+        for (int r = 0; r < 4; r++) {
+          for (int mode = 0; mode < 4; mode++) {
+            const BlitRotation rotation = static_cast<BlitRotation>(r);
+            BlitOp op = {};
+            op.x = 5;
+            op.y = 3;
+            op.width = size[2];
+            op.height = size[3];
+            op.rotation = rotation;
+            op.blend = mode != 0;
+            op.opacity = mode != 0 ? opacities[mode - 1] : 255;
+            Image src(size[0], size[1], static_cast<PixelFormat>(sf), 3);
+            Image dst(op.width + 11, op.height + 7, static_cast<PixelFormat>(df), 1);
+            Image expected = dst;
+            expected.surface.pixels = expected.bytes.data();
+            reference(expected.surface, src.surface, op);
+            if (!Blit_Cpu(dst.surface, src.surface, op) || dst.bytes != expected.bytes) {
+              printf("MISMATCH %ux%u %s -> %ux%u %s rot %s blend %d opacity %u\n", size[0], size[1],
+                     s_formatNames[sf], op.width, op.height, s_formatNames[df], s_rotationNames[r],
+                     op.blend, op.opacity);
+              return 1;
+            }
+            cases++;
+          }
+        }
+      }
+    }
+  }
+  printf("%u cases bit-exact\n", cases);
+
+  // Throughput on panel-sized work: the portrait framebuffer rotated from a
+  // landscape one, a format conversion and a blended overlay.
+  struct Bench {
+    const char *name;
+    PixelFormat from, to;
+    uint16_t sw, sh, dw, dh;
+    BlitRotation rotation;
+    bool blend;
+  };
+  static const Bench benches[] = {
+      {"rotate 90 8888->8888", PixelFormat::Argb8888, PixelFormat::Argb8888, 1280, 720, 720, 1280, BlitRotation::Rot90, false},
+      {"convert 8888->565", PixelFormat::Argb8888, PixelFormat::Rgb565, 720, 1280, 720, 1280, BlitRotation::None, false},
+      {"blend 4444 over 8888", PixelFormat::Argb4444, PixelFormat::Argb8888, 720, 80, 720, 80, BlitRotation::None, true},
+      {"scale 2x 565->8888", PixelFormat::Rgb565, PixelFormat::Argb8888, 360, 640, 720, 1280, BlitRotation::None, false},
+  };
+  const int rounds = quick ? 1 : 5;
+  for (const Bench &bench : benches) {
+    Image src(bench.sw, bench.sh, bench.from, 0);
+    Image dst(bench.dw, bench.dh, bench.to, 0);
+    BlitOp op = {0, 0, bench.dw, bench.dh, bench.rotation, bench.blend, 200};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      reference(dst.surface, src.surface, op);
+    }
+    const double ref = seconds(start) / rounds;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+      Blit_Cpu(dst.surface, src.surface, op);
+    }
+    const double kernel = seconds(start) / rounds;
+    const double mpix = (double)bench.dw * bench.dh / 1e6;
+    printf("%-22s kernel %7.1f Mpix/s  reference %7.1f Mpix/s\n", bench.name, mpix / kernel, mpix / ref);
+  }
+  return 0;
+}
@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+"""Pre-render glyph sets into the flash-resident atlases of src/digit_atlas.h.
+
+Each set is given as FONT_FILE,FONT_ID,PIXEL_SIZE,GLYPHS, for example
+
+    digit_atlas.py -o digit_atlas_data.cpp fonts/Roboto-Bold.ttf,1,96,0123456789
+
+FONT_ID is the id the platform glue uses for that font (src/glyph_cache.h),
+GLYPHS the characters to render, one glyph each. The glyphs are rendered
+with FreeType's default hinting and anti-aliasing, packed left to right in
+rows no wider than --max-width with a one-pixel transparent gutter, and
+written as C++ tables. armgcc/CMakeLists.txt runs this at build time with
+APP_DIGIT_ATLAS; tools/digit_atlas_check.cpp checks the result.
+
+FreeType is loaded through ctypes from the system library, so nothing beyond
+Python is needed. --preview DIR also writes each atlas as a PGM image.
+"""
+
+import argparse
+import ctypes
+import ctypes.util
+import os
+import sys
+
+FT_LOAD_RENDER = 1 << 2
+FT_PIXEL_MODE_GRAY = 2
+GUTTER = 1
+PITCH_ALIGN = 16
+
+
+class FT_Generic(ctypes.Structure):
+    _fields_ = [("data", ctypes.c_void_p), ("finalizer", ctypes.c_void_p)]
+
+
+class FT_Vector(ctypes.Structure):
+    _fields_ = [("x", ctypes.c_long), ("y", ctypes.c_long)]
+
+
+class FT_Bitmap(ctypes.Structure):
+    _fields_ = [
+        ("rows", ctypes.c_uint),
+        ("width", ctypes.c_uint),
+        ("pitch", ctypes.c_int),
+        ("buffer", ctypes.POINTER(ctypes.c_ubyte)),
+        ("num_grays", ctypes.c_ushort),
+        ("pixel_mode", ctypes.c_ubyte),
+        ("palette_mode", ctypes.c_ubyte),
+        ("palette", ctypes.c_void_p),
+    ]
+
+
+class FT_GlyphSlotRec(ctypes.Structure):
+    _fields_ = [
+        ("library", ctypes.c_void_p),
+        ("face", ctypes.c_void_p),
+        ("next", ctypes.c_void_p),
+        ("glyph_index", ctypes.c_uint),
+        ("generic", FT_Generic),
+        ("metrics", ctypes.c_long * 8),
+        ("linearHoriAdvance", ctypes.c_long),
+        ("linearVertAdvance", ctypes.c_long),
+        ("advance", FT_Vector),
+        ("format", ctypes.c_int),
+        ("bitmap", FT_Bitmap),
+        ("bitmap_left", ctypes.c_int),
+        ("bitmap_top", ctypes.c_int),
+    ]
+
+
+class FT_FaceRec(ctypes.Structure):
+    _fields_ = [
+        ("num_faces", ctypes.c_long),
+        ("face_index", ctypes.c_long),
+        ("face_flags", ctypes.c_long),
+        ("style_flags", ctypes.c_long),
+        ("num_glyphs", ctypes.c_long),
+        ("family_name", ctypes.c_char_p),
+        ("style_name", ctypes.c_char_p),
+        ("num_fixed_sizes", ctypes.c_int),
+        ("available_sizes", ctypes.c_void_p),
+        ("num_charmaps", ctypes.c_int),
+        ("charmaps", ctypes.c_void_p),
+        ("generic", FT_Generic),
+        ("bbox", ctypes.c_long * 4),
+        ("units_per_EM", ctypes.c_ushort),
+        ("ascender", ctypes.c_short),
+        ("descender", ctypes.c_short),
+        ("height", ctypes.c_short),
+        ("max_advance_width", ctypes.c_short),
+        ("max_advance_height", ctypes.c_short),
+        ("underline_position", ctypes.c_short),
+        ("underline_thickness", ctypes.c_short),
+        ("glyph", ctypes.POINTER(FT_GlyphSlotRec)),
+    ]
+
+
+class FreeType:
+    def __init__(self):
+        path = ctypes.util.find_library("freetype")
+        if path is None:
+            sys.exit("digit_atlas: FreeType library not found")
+        self.lib = ctypes.CDLL(path)
+        self.lib.FT_New_Face.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_long,
+                                         ctypes.POINTER(ctypes.POINTER(FT_FaceRec))]
+        self.lib.FT_Set_Pixel_Sizes.argtypes = [ctypes.POINTER(FT_FaceRec), ctypes.c_uint, ctypes.c_uint]
+        self.lib.FT_Load_Char.argtypes = [ctypes.POINTER(FT_FaceRec), ctypes.c_ulong, ctypes.c_int32]
+        self.lib.FT_Get_Char_Index.argtypes = [ctypes.POINTER(FT_FaceRec), ctypes.c_ulong]
+        self.library = ctypes.c_void_p()
+        if self.lib.FT_Init_FreeType(ctypes.byref(self.library)) != 0:
+            sys.exit("digit_atlas: FT_Init_FreeType failed")
+
+    def face(self, path, size):
+        face = ctypes.POINTER(FT_FaceRec)()
+        if self.lib.FT_New_Face(self.library, path.encode(), 0, ctypes.byref(face)) != 0:
+            sys.exit("digit_atlas: cannot open %s" % path)
+        if self.lib.FT_Set_Pixel_Sizes(face, 0, size) != 0:
+            sys.exit("digit_atlas: %s has no %d px size" % (path, size))
+        return face
+
+    def render(self, face, char):
+        """Returns (width, height, bearing_x, bearing_y, advance, rows)."""
+        if self.lib.FT_Get_Char_Index(face, ord(char)) == 0:
+            sys.exit("digit_atlas: no glyph for %r" % char)
+        if self.lib.FT_Load_Char(face, ord(char), FT_LOAD_RENDER) != 0:
+            sys.exit("digit_atlas: cannot render %r" % char)
+        slot = face.contents.glyph.contents
+        bitmap = slot.bitmap
+        if bitmap.rows != 0 and bitmap.pixel_mode != FT_PIXEL_MODE_GRAY:
+            sys.exit("digit_atlas: %r is not an 8-bit alpha map" % char)
+        rows = []
+        for y in range(bitmap.rows):
+            start = y * bitmap.pitch
+            rows.append(bytes(bitmap.buffer[start:start + bitmap.width]))
+        advance = (slot.advance.x + 32) >> 6
+        return bitmap.width, bitmap.rows, slot.bitmap_left, slot.bitmap_top, advance, rows
+
+
+def parse_set(text):
+    parts = text.split(",", 3)
+    if len(parts) != 4 or not parts[3]:
+        raise argparse.ArgumentTypeError("expected FONT_FILE,FONT_ID,PIXEL_SIZE,GLYPHS: %s" % text)
+    return parts[0], int(parts[1], 0), int(parts[2], 0), "".join(sorted(set(parts[3])))
+
+
+def pack(glyphs, max_width):
+    """Places glyphs in rows; returns the atlas width and height."""
+    x, y, row_height, width = GUTTER, GUTTER, 0, 0
+    for g in glyphs:
+        if x + g["width"] + GUTTER > max_width and x > GUTTER:
+            x, y, row_height = GUTTER, y + row_height + GUTTER, 0
+        if g["width"] + 2 * GUTTER > max_width:
+            sys.exit("digit_atlas: %r is wider than --max-width" % g["char"])
+        g["x"], g["y"] = x, y
+        x += g["width"] + GUTTER
+        row_height = max(row_height, g["height"])
+        width = max(width, x)
+    return width, y + row_height + GUTTER
+
+
+def build(ft, font_file, font_id, size, chars, max_width):
+    face = ft.face(font_file, size)
+    glyphs = []
+    for char in chars:
+        width, height, bx, by, advance, rows = ft.render(face, char)
+        glyphs.append({"char": char, "width": width, "height": height, "bx": bx, "by": by,
+                       "advance": advance, "rows": rows})
+    width, height = pack(glyphs, max_width)
+    pitch = (width + PITCH_ALIGN - 1) // PITCH_ALIGN * PITCH_ALIGN
+    pixels = bytearray(pitch * height)
+    for g in glyphs:
+        for y, row in enumerate(g["rows"]):
+            start = (g["y"] + y) * pitch + g["x"]
+            pixels[start:start + g["width"]] = row
+    return {"file": os.path.basename(font_file), "font": font_id, "size": size, "chars": chars,
+            "width": width, "height": height, "pitch": pitch, "pixels": pixels, "glyphs": glyphs}
+
+
+def c_string(text):
+    return '"%s"' % text.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def emit(atlases):
+    out = ["// Generated by tools/digit_atlas.py; do not edit.",
+           "",
+           "#include \"digit_atlas.h\"",
+           ""]
+    for i, a in enumerate(atlases):
+        out.append("// %s, font %d, %d px: %s" % (a["file"], a["font"], a["size"], c_string(a["chars"])))
+        out.append("alignas(64) static const uint8_t s_pixels%d[] = {" % i)
+        data = a["pixels"]
+        for start in range(0, len(data), 16):
+            out.append("    " + " ".join("0x%02x," % b for b in data[start:start + 16]))
+        out.append("};")
+        out.append("")
+        out.append("static const DigitAtlasGlyph s_glyphs%d[] = {" % i)
+        for g in a["glyphs"]:
+            out.append("    {0x%x, %d, %d, %d, %d, %d, %d, %d}," % (ord(g["char"]), g["x"], g["y"], g["width"],
+                                                                   g["height"], g["bx"], g["by"], g["advance"]))
+        out.append("};")
+        out.append("")
+    out.append("extern const DigitAtlasSet DigitAtlas_Sets[] = {")
+    for i, a in enumerate(atlases):
+        out.append("    {%d, %d, %d, %d, %d, s_pixels%d, s_glyphs%d, %d}," % (
+            a["font"], a["size"], a["width"], a["height"], a["pitch"], i, i, len(a["glyphs"])))
+    out.append("};")
+    out.append("extern const uint32_t DigitAtlas_SetCount = %d;" % len(atlases))
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("sets", nargs="+", type=parse_set, metavar="FONT_FILE,FONT_ID,PIXEL_SIZE,GLYPHS")
+    parser.add_argument("-o", "--output", required=True, help="C++ file to write")
+    parser.add_argument("--max-width", type=int, default=1024, help="widest atlas row in pixels")
+    parser.add_argument("--preview", metavar="DIR", help="also write every atlas as a PGM image")
+    args = parser.parse_args()
+
+    seen = set()
+    for _, font_id, size, _ in args.sets:
+        if (font_id, size) in seen:
+            sys.exit("digit_atlas: font %d at %d px given twice" % (font_id, size))
+        seen.add((font_id, size))
+
+    ft = FreeType()
+    atlases = [build(ft, *s, max_width=args.max_width) for s in args.sets]
+    with open(args.output, "w") as f:
+        f.write(emit(atlases))
+    if args.preview:
+        os.makedirs(args.preview, exist_ok=True)
+        for a in atlases:
+            path = os.path.join(args.preview, "font%d_%dpx.pgm" % (a["font"], a["size"]))
+            with open(path, "wb") as f:
+                f.write(b"P5 %d %d 255\n" % (a["pitch"], a["height"]))
+                f.write(bytes(a["pixels"]))
+    total = sum(len(a["pixels"]) for a in atlases)
+    print("digit_atlas: %d sets, %d glyphs, %d bytes of flash" % (
+        len(atlases), sum(len(a["glyphs"]) for a in atlases), total))
+
+
+if __name__ == "__main__":
+    main()
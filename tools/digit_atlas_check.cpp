@@ -0,0 +1,265 @@
+// Checks generated digit atlases (tools/digit_atlas.py) and the flash glyph
+// blitter (src/digit_atlas.cpp) against FreeType on the host.
+//
+//   python3 tools/digit_atlas.py -o atlas.cpp SETS...
+//   g++ -std=gnu++14 -O2 -DAPP_DIGIT_ATLAS=1 -Isrc $(pkg-config --cflags freetype2) tools/digit_atlas_check.cpp
+//       src/digit_atlas.cpp src/blit.cpp atlas.cpp $(pkg-config --libs freetype2) -o digit_atlas_check
+//   ./digit_atlas_check SETS...
+//
+// SETS are the same FONT_FILE,FONT_ID,PIXEL_SIZE,GLYPHS arguments the atlas
+// was generated from. Every glyph is rendered again the way the generator
+// does it and must match the atlas in metrics and pixels; everything between
+// the glyphs must be transparent. Then each set's glyphs are drawn as one
+// line with DigitAtlas_Draw() into RGB565, ARGB4444 and ARGB8888 surfaces of
+// random pixels, at offsets that clip on every side, and compared with a
+// reference that composites the FreeType bitmaps pixel by pixel by the rules
+// of src/blit.h. Exits 1 on the first mismatch.
+//
+// The target's rasterizer is Qul's Monotype engine, which differs from
+// FreeType in hinting; "glyphs verify" on the console measures that.
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "digit_atlas.h"
+
+struct Glyph {
+  uint32_t code;
+  int width;
+  int height;
+  int bearingX;
+  int bearingY;
+  int advance;
+  std::vector<uint8_t> alpha;
+};
+
+static std::vector<Glyph> render(FT_Library library, const char *file, int size, const std::string &chars) {
+  FT_Face face;
+  if (FT_New_Face(library, file, 0, &face) != 0 || FT_Set_Pixel_Sizes(face, 0, size) != 0) {
+    fprintf(stderr, "cannot open %s at %d px\n", file, size);
+    exit(1);
+  }
+  std::vector<Glyph> glyphs;
+  for (unsigned char c : chars) {
+    if (FT_Load_Char(face, c, FT_LOAD_RENDER) != 0) {
+      fprintf(stderr, "cannot render '%c'\n", c);
+      exit(1);
+    }
+    const FT_GlyphSlot slot = face->glyph;
+    Glyph g;
+    g.code = c;
+    g.width = (int)slot->bitmap.width;
+    g.height = (int)slot->bitmap.rows;
+    g.bearingX = slot->bitmap_left;
+    g.bearingY = slot->bitmap_top;
+    g.advance = (int)((slot->advance.x + 32) >> 6);
+    for (int y = 0; y < g.height; y++) {
+      const uint8_t *row = slot->bitmap.buffer + y * slot->bitmap.pitch;
+      g.alpha.insert(g.alpha.end(), row, row + g.width);
+    }
+    glyphs.push_back(g);
+  }
+  FT_Done_Face(face);
+  return glyphs;
+}
+
+static bool checkAtlas(const DigitAtlasSet &set, const std::vector<Glyph> &glyphs) {
+  if (set.glyphCount != glyphs.size()) {
+    printf("  %u glyphs in the atlas, %u expected\n", (unsigned)set.glyphCount, (unsigned)glyphs.size());
+    return false;
+  }
+  std::vector<bool> covered(set.pitch * set.height);
+  for (size_t i = 0; i < glyphs.size(); i++) {
+    const Glyph &g = glyphs[i];
+    const DigitAtlasGlyph *a = DigitAtlas_FindGlyph(set, g.code);
+    if (a == nullptr || a->width != g.width || a->height != g.height || a->bearingX != g.bearingX ||
+        a->bearingY != g.bearingY || a->advance != g.advance) {
+      printf("  '%c': metrics differ\n", (char)g.code);
+      return false;
+    }
+    if (a->x < 1 || a->y < 1 || a->x + a->width + 1 > set.width || a->y + a->height + 1 > set.height) {
+      printf("  '%c': no gutter\n", (char)g.code);
+      return false;
+    }
+    for (int y = 0; y < g.height; y++) {
+      for (int x = 0; x < g.width; x++) {
+        const uint32_t at = (a->y + y) * set.pitch + a->x + x;
+        if (covered[at]) {
+          printf("  '%c': overlaps another glyph\n", (char)g.code);
+          return false;
+        }
+        covered[at] = true;
+        if (set.pixels[at] != g.alpha[y * g.width + x]) {
+          printf("  '%c': pixel %d,%d is %u, FreeType %u\n", (char)g.code, x, y, set.pixels[at],
+                 g.alpha[y * g.width + x]);
+          return false;
+        }
+      }
+    }
+  }
+  for (uint32_t i = 0; i < set.pitch * set.height; i++) {
+    if (!covered[i] && set.pixels[i] != 0U) {
+      printf("  atlas pixel %u,%u outside the glyphs is %u\n", (unsigned)(i % set.pitch), (unsigned)(i / set.pitch),
+             set.pixels[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// The reference follows src/blit.h literally, one pixel at a time.
+static uint32_t div255(uint32_t x) { return (x + 127U) / 255U; }
+
+static uint32_t widen(uint32_t value, uint32_t bits) {
+  uint32_t out = value << (8U - bits);
+  for (uint32_t shift = bits; shift < 8U; shift += bits) {
+    out |= (value << (8U - bits)) >> shift;
+  }
+  return out & 0xFFU;
+}
+
+static void loadPixel(const uint8_t *p, PixelFormat format, uint32_t c[4]) {
+  if (format == PixelFormat::Argb8888) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    c[0] = v >> 24, c[1] = (v >> 16) & 0xFFU, c[2] = (v >> 8) & 0xFFU, c[3] = v & 0xFFU;
+    return;
+  }
+  uint16_t v;
+  memcpy(&v, p, 2);
+  if (format == PixelFormat::Rgb565) {
+    c[0] = 255U, c[1] = widen(v >> 11, 5), c[2] = widen((v >> 5) & 0x3FU, 6), c[3] = widen(v & 0x1FU, 5);
+  } else {
+    c[0] = widen(v >> 12, 4), c[1] = widen((v >> 8) & 0xFU, 4), c[2] = widen((v >> 4) & 0xFU, 4),
+    c[3] = widen(v & 0xFU, 4);
+  }
+}
+
+static void storePixel(uint8_t *p, PixelFormat format, const uint32_t c[4]) {
+  if (format == PixelFormat::Argb8888) {
+    const uint32_t v = c[0] << 24 | c[1] << 16 | c[2] << 8 | c[3];
+    memcpy(p, &v, 4);
+    return;
+  }
+  const uint16_t v = format == PixelFormat::Rgb565
+                         ? (uint16_t)((c[1] >> 3) << 11 | (c[2] >> 2) << 5 | c[3] >> 3)
+                         : (uint16_t)((c[0] >> 4) << 12 | (c[1] >> 4) << 8 | (c[2] >> 4) << 4 | c[3] >> 4);
+  memcpy(p, &v, 2);
+}
+
+static void referenceDraw(std::vector<uint8_t> &pixels, uint32_t stride, int width, int height, PixelFormat format,
+                          int penX, int baseline, const std::vector<Glyph> &glyphs, uint32_t argb) {
+  const uint32_t bpp = Blit_BytesPerPixel(format);
+  const uint32_t color[4] = {argb >> 24, (argb >> 16) & 0xFFU, (argb >> 8) & 0xFFU, argb & 0xFFU};
+  for (const Glyph &g : glyphs) {
+    for (int y = 0; y < g.height; y++) {
+      for (int x = 0; x < g.width; x++) {
+        const int dx = penX + g.bearingX + x;
+        const int dy = baseline - g.bearingY + y;
+        if (dx < 0 || dy < 0 || dx >= width || dy >= height) {
+          continue;
+        }
+        uint8_t *p = &pixels[dy * stride + dx * bpp];
+        uint32_t d[4];
+        loadPixel(p, format, d);
+        const uint32_t a = div255(g.alpha[y * g.width + x] * color[0]);
+        uint32_t out[4];
+        out[0] = format == PixelFormat::Rgb565 ? 255U : a + div255(d[0] * (255U - a));
+        for (int i = 1; i < 4; i++) {
+          out[i] = div255(color[i] * a + d[i] * (255U - a));
+        }
+        storePixel(p, format, out);
+      }
+    }
+    penX += g.advance;
+  }
+}
+
+static bool checkDraw(const DigitAtlasSet &set, const std::vector<Glyph> &glyphs, const std::string &text) {
+  static const PixelFormat formats[] = {PixelFormat::Rgb565, PixelFormat::Argb4444, PixelFormat::Argb8888};
+  static const uint32_t colors[] = {0xFFFFFFFFU, 0xFF20C0F0U, 0x80FF4000U, 0x01000000U};
+  int lineWidth = 0;
+  for (const Glyph &g : glyphs) {
+    lineWidth += g.advance;
+  }
+  const int width = lineWidth / 2 + 7;
+  const int height = set.size;
+  // Pen positions and baselines that cut off each side in turn.
+  const int pens[] = {-lineWidth / 3, 0, width / 4, width - lineWidth / 2};
+  const int baselines[] = {height / 3, height - height / 4, height + height / 4};
+  for (PixelFormat format : formats) {
+    const uint32_t stride = (uint32_t)width * Blit_BytesPerPixel(format) + 8U;
+    for (uint32_t argb : colors) {
+      for (int pen : pens) {
+        for (int baseline : baselines) {
+          std::vector<uint8_t> actual(stride * height);
+          for (uint8_t &b : actual) {
+            b = (uint8_t)rand();
+          }
+          std::vector<uint8_t> expected = actual;
+          const BlitSurface dst = {actual.data(), stride, (uint16_t)width, (uint16_t)height, format};
+          const int32_t end = DigitAtlas_Draw(dst, pen, baseline, set, text.c_str(), argb);
+          referenceDraw(expected, stride, width, height, format, pen, baseline, glyphs, argb);
+          if (end != pen + lineWidth || actual != expected) {
+            printf("  drawing differs: format %d, color %08x, pen %d, baseline %d\n", (int)format, (unsigned)argb,
+                   pen, baseline);
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if ((uint32_t)(argc - 1) != DigitAtlas_SetCount) {
+    fprintf(stderr, "usage: %s SETS...\n  the %u FONT_FILE,FONT_ID,PIXEL_SIZE,GLYPHS the atlas was built from\n",
+            argv[0], (unsigned)DigitAtlas_SetCount);
+    return 2;
+  }
+  FT_Library library;
+  if (FT_Init_FreeType(&library) != 0) {
+    fprintf(stderr, "FT_Init_FreeType failed\n");
+    return 1;
+  }
+  srand(1);
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const size_t a = arg.find(',');
+    const size_t b = a == std::string::npos ? a : arg.find(',', a + 1);
+    const size_t c = b == std::string::npos ? b : arg.find(',', b + 1);
+    if (c == std::string::npos) {
+      fprintf(stderr, "bad set %s\n", argv[i]);
+      return 2;
+    }
+    const std::string file = arg.substr(0, a);
+    const int font = atoi(arg.substr(a + 1, b - a - 1).c_str());
+    const int size = atoi(arg.substr(b + 1, c - b - 1).c_str());
+    std::string chars = arg.substr(c + 1);
+    // The generator sorts and deduplicates.
+    std::sort(chars.begin(), chars.end());
+    chars.erase(std::unique(chars.begin(), chars.end()), chars.end());
+
+    const DigitAtlasSet *set = DigitAtlas_FindSet((uint16_t)font, (uint16_t)size);
+    printf("font %d, %d px, %u glyphs, %ux%u\n", font, size, (unsigned)chars.size(), set ? set->width : 0U,
+           set ? set->height : 0U);
+    if (set == nullptr) {
+      printf("  not in the atlas\n");
+      return 1;
+    }
+    const std::vector<Glyph> glyphs = render(library, file.c_str(), size, chars);
+    if (!checkAtlas(*set, glyphs) || !checkDraw(*set, glyphs, chars)) {
+      return 1;
+    }
+  }
+  FT_Done_FreeType(library);
+  printf("all sets match\n");
+  return 0;
+}
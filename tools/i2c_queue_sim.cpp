@@ -0,0 +1,262 @@
+// Drives the I2C transaction queue (src/i2c_queue.cpp) against a simulated
+// bus on the host.
+//
+//   g++ -std=gnu++14 -O2 -Isrc tools/i2c_queue_sim.cpp src/i2c_queue.cpp -o i2c_queue_sim
+//   ./i2c_queue_sim
+//
+// The simulated bus records every transfer start() puts on the wire and
+// finishes it only when a scenario calls complete(), so each scenario sets up
+// the exact interleaving it checks: priority ordering, a submit from a
+// callback jumping its priority, a failed start, cancel, a timeout on a
+// queued request and the abort of one on the wire (I2cQueue::abandon, as
+// I2cBus_Transfer uses them), and the statistics. Prints every failed check
+// and exits 1 if there was one.
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "i2c_queue.h"
+
+static int s_failures;
+static int s_checks;
+
+#define CHECK(cond)                                                                                                    \
+  do {                                                                                                                 \
+    s_checks++;                                                                                                        \
+    if (!(cond)) {                                                                                                     \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                                                                \
+      s_failures++;                                                                                                    \
+    }                                                                                                                  \
+  } while (0)
+
+static const int32_t Timeout = 5;
+
+struct SimBus {
+  std::string started; // request names in the order they went on the wire
+  std::string done;    // "name:status " per callback
+  int32_t failStart = 0;
+  uint32_t clock = 0;
+  uint32_t aborts = 0;
+  I2cQueue queue;
+
+  SimBus() { queue = I2cQueue(I2cBusOps{start, abort, now, this}); }
+
+  static int32_t start(void *context, const I2cRequest &request) {
+    SimBus &bus = *static_cast<SimBus *>(context);
+    bus.started += static_cast<const char *>(request.user);
+    const int32_t status = bus.failStart;
+    bus.failStart = 0;
+    return status;
+  }
+  static void abort(void *context) { static_cast<SimBus *>(context)->aborts++; }
+  static uint32_t now(void *context) { return static_cast<SimBus *>(context)->clock; }
+
+  const char *active() const {
+    return queue.active() != nullptr ? static_cast<const char *>(queue.active()->user) : "";
+  }
+};
+
+static SimBus *s_bus; // for the callbacks
+
+static void recordDone(I2cRequest &request, int32_t status) {
+  s_bus->done += static_cast<const char *>(request.user);
+  s_bus->done += ":" + std::to_string(status) + " ";
+}
+
+static I2cRequest make(const char *name, I2cPriority priority) {
+  I2cRequest request = {};
+  request.address = 0x5D;
+  request.priority = priority;
+  request.done = recordDone;
+  request.user = const_cast<char *>(name);
+  return request;
+}
+
+// Completes whatever is on the wire until the bus is idle.
+static void drain(SimBus &bus) {
+  for (int i = 0; i < 100 && bus.queue.active() != nullptr; i++) {
+    bus.queue.complete(0);
+  }
+}
+
+static void priorityOrder() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest a = make("A", I2cPriority::Bulk);
+  I2cRequest b = make("B", I2cPriority::Bulk);
+  I2cRequest c = make("C", I2cPriority::Control);
+  I2cRequest d = make("D", I2cPriority::Input);
+  I2cRequest e = make("E", I2cPriority::Input);
+  bus.queue.submit(a);
+  CHECK(bus.started == "A"); // an idle bus starts right away
+  bus.queue.submit(b);
+  bus.queue.submit(c);
+  bus.queue.submit(d);
+  bus.queue.submit(e);
+  CHECK(bus.started == "A"); // a transfer on the wire is never cut short
+  CHECK(bus.queue.stats().depth == 4);
+  drain(bus);
+  CHECK(bus.started == "ADECB");
+  CHECK(bus.done == "A:0 D:0 E:0 C:0 B:0 ");
+  CHECK(bus.queue.idle());
+}
+
+// The acknowledge write submitted from the read's callback.
+static I2cRequest s_ack;
+
+static void submitAck(I2cRequest &request, int32_t status) {
+  recordDone(request, status);
+  s_bus->queue.submit(s_ack);
+}
+
+static void callbackJumpsQueue() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest read = make("R", I2cPriority::Input);
+  read.done = submitAck;
+  I2cRequest other = make("O", I2cPriority::Input);
+  I2cRequest bulk = make("B", I2cPriority::Bulk);
+  s_ack = make("W", I2cPriority::Input);
+  bus.queue.submit(read);
+  bus.queue.submit(other);
+  bus.queue.submit(bulk);
+  bus.queue.complete(0);
+  // W went ahead of O, which was queued first at the same priority, and only
+  // one transfer is on the wire.
+  CHECK(bus.started == "RW");
+  CHECK(std::string(bus.active()) == "W");
+  drain(bus);
+  CHECK(bus.started == "RWOB");
+
+  // Into an empty priority it simply queues, behind nothing.
+  SimBus idle;
+  s_bus = &idle;
+  I2cRequest lone = make("L", I2cPriority::Control);
+  lone.done = submitAck;
+  s_ack = make("W", I2cPriority::Input);
+  idle.queue.submit(lone);
+  idle.queue.complete(0);
+  CHECK(idle.started == "LW");
+  drain(idle);
+  CHECK(idle.queue.idle());
+}
+
+static void failedStart() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest a = make("A", I2cPriority::Control);
+  I2cRequest b = make("B", I2cPriority::Control);
+  I2cRequest c = make("C", I2cPriority::Control);
+  bus.queue.submit(a);
+  bus.queue.submit(b);
+  bus.queue.submit(c);
+  bus.failStart = 7;
+  bus.queue.complete(0);
+  // B failed to start; its callback ran with the driver's status and C went
+  // out in its place.
+  CHECK(bus.done == "A:0 B:7 ");
+  CHECK(std::string(bus.active()) == "C");
+  CHECK(bus.queue.stats().failed[static_cast<int>(I2cPriority::Control)] == 1);
+  drain(bus);
+}
+
+static void cancel() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest a = make("A", I2cPriority::Control);
+  I2cRequest b = make("B", I2cPriority::Control);
+  I2cRequest c = make("C", I2cPriority::Control);
+  I2cRequest d = make("D", I2cPriority::Control);
+  bus.queue.submit(a);
+  bus.queue.submit(b);
+  bus.queue.submit(c);
+  CHECK(!bus.queue.cancel(a)); // on the wire
+  CHECK(bus.queue.cancel(c));  // the tail
+  CHECK(!bus.queue.cancel(c));
+  bus.queue.submit(d); // must link behind B, not behind the cancelled C
+  drain(bus);
+  CHECK(bus.started == "ABD");
+  CHECK(bus.done == "A:0 B:0 D:0 "); // no callback for C
+  CHECK(bus.queue.idle());
+}
+
+static void timeoutWhileQueued() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest a = make("A", I2cPriority::Bulk);
+  I2cRequest b = make("B", I2cPriority::Input);
+  bus.queue.submit(a);
+  bus.queue.submit(b);
+  CHECK(bus.queue.abandon(b, Timeout));
+  CHECK(bus.done == "B:5 ");
+  CHECK(bus.aborts == 0);
+  CHECK(std::string(bus.active()) == "A"); // untouched
+  CHECK(bus.queue.stats().depth == 0);
+  drain(bus);
+  CHECK(bus.started == "A");
+  CHECK(!bus.queue.abandon(b, Timeout)); // finished requests are left alone
+}
+
+static void abortOnTheWire() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest a = make("A", I2cPriority::Input);
+  I2cRequest b = make("B", I2cPriority::Bulk);
+  bus.queue.submit(a);
+  bus.queue.submit(b);
+  CHECK(bus.queue.abandon(a, Timeout));
+  CHECK(bus.aborts == 1);
+  CHECK(bus.done == "A:5 ");
+  CHECK(std::string(bus.active()) == "B"); // the bus moved on
+  bus.queue.complete(0);
+  CHECK(bus.done == "A:5 B:0 ");
+  CHECK(bus.queue.idle());
+  bus.queue.complete(0); // a stray completion on an idle bus is ignored
+  CHECK(bus.done == "A:5 B:0 ");
+
+  // Without an abort hook a transfer on the wire cannot be abandoned.
+  I2cQueue plain(I2cBusOps{SimBus::start, nullptr, nullptr, &bus});
+  I2cRequest c = make("C", I2cPriority::Control);
+  plain.submit(c);
+  CHECK(!plain.abandon(c, Timeout));
+  CHECK(plain.active() == &c);
+}
+
+static void statistics() {
+  SimBus bus;
+  s_bus = &bus;
+  I2cRequest a = make("A", I2cPriority::Bulk);
+  I2cRequest b = make("B", I2cPriority::Input);
+  I2cRequest c = make("C", I2cPriority::Input);
+  bus.queue.submit(a);
+  bus.queue.submit(b);
+  bus.clock = 10;
+  bus.queue.submit(c);
+  CHECK(bus.queue.stats().maxDepth == 2);
+  bus.clock = 40;
+  bus.queue.complete(0); // B waited 40
+  bus.clock = 45;
+  bus.queue.complete(0); // C waited 35
+  bus.queue.complete(0);
+  const I2cQueueStats &stats = bus.queue.stats();
+  CHECK(stats.maxWait[static_cast<int>(I2cPriority::Input)] == 40);
+  CHECK(stats.maxWait[static_cast<int>(I2cPriority::Bulk)] == 0);
+  CHECK(stats.submitted[static_cast<int>(I2cPriority::Input)] == 2);
+  CHECK(stats.submitted[static_cast<int>(I2cPriority::Bulk)] == 1);
+  bus.queue.resetStats();
+  CHECK(bus.queue.stats().maxDepth == 0);
+  CHECK(bus.queue.stats().submitted[static_cast<int>(I2cPriority::Input)] == 0);
+}
+
+int main() {
+  priorityOrder();
+  callbackJumpsQueue();
+  failedStart();
+  cancel();
+  timeoutWhileQueued();
+  abortOnTheWire();
+  statistics();
+  printf("%d of %d checks passed\n", s_checks - s_failures, s_checks);
+  return s_failures == 0 ? 0 : 1;
+}
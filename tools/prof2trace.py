@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Convert a "prof dump" console capture into Chrome trace-event JSON.
+
+Feed it a captured console log (file argument or stdin); the last complete
+PRF block is converted. Open the result in chrome://tracing or
+https://ui.perfetto.dev. The dump format is documented in src/profiler.cpp.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+LINE = re.compile(r"PRF (.*?)\s*$")
+
+
+def blocks(lines):
+    block = []
+    for line in lines:
+        m = LINE.search(line)
+        if not m:
+            continue
+        fields = m.group(1)
+        if fields == ".":
+            if block:
+                yield block
+            block = []
+        elif fields.startswith("hz "):
+            block = [fields]
+        elif block:
+            block.append(fields)
+
+
+def convert(block, pid):
+    hz = int(block[0].split()[1])
+    threads = {}
+    zones = []
+    for fields in block[1:]:
+        kind, rest = fields.split(" ", 1)
+        if kind == "T":
+            ring, rest = rest.split(" ", 1)
+            owner, dropped = rest.rsplit(" ", 1)
+            threads[int(ring)] = (owner, int(dropped))
+        elif kind == "E":
+            ring, age, duration, name = rest.split(" ", 3)
+            zones.append((int(ring), int(age), int(duration), name))
+
+    # Ages count back from the dump; the oldest zone becomes t = 0.
+    oldest = max((z[1] for z in zones), default=0)
+    events = []
+    for ring, (owner, dropped) in sorted(threads.items()):
+        events.append({"name": "thread_name", "ph": "M", "pid": pid, "tid": ring,
+                       "args": {"name": owner}})
+        if dropped:
+            events.append({"name": "dropped %d" % dropped, "ph": "i", "s": "t",
+                           "pid": pid, "tid": ring, "ts": 0})
+    for ring, age, duration, name in zones:
+        events.append({"name": name, "ph": "X", "pid": pid, "tid": ring,
+                       "ts": (oldest - age) * 1e6 / hz, "dur": duration * 1e6 / hz})
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    parser.add_argument("-o", "--output", type=argparse.FileType("w"), default=sys.stdout)
+    parser.add_argument("--all", action="store_true",
+                        help="convert every dump, one process per dump")
+    args = parser.parse_args()
+
+    found = list(blocks(args.log))
+    if not found:
+        print("no complete PRF dump found", file=sys.stderr)
+        return 1
+    if not args.all:
+        found = found[-1:]
+    events = []
+    for pid, block in enumerate(found, 1):
+        events.extend(convert(block, pid))
+    json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, args.output)
+    args.output.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Decode the run-time stats records printed by the "cpu bin" console command.
+
+Feed it a captured console log (file argument or stdin). Every complete
+"RTS ..." block is decoded into a per-task table and an ASCII flame-style
+summary grouped by priority. With --folded the output is in the folded-stack
+format understood by flamegraph.pl / speedscope instead.
+
+The record layout is documented in src/runtime_stats.cpp.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+STATES = ["running", "ready", "blocked", "suspended", "deleted", "invalid"]
+LINE = re.compile(r"RTS ([0-9a-f]+|\.)\s*$")
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def records(lines):
+    chunk = []
+    for line in lines:
+        m = LINE.search(line)
+        if not m:
+            continue
+        if m.group(1) == ".":
+            if chunk:
+                yield bytes.fromhex("".join(chunk))
+            chunk = []
+        else:
+            chunk.append(m.group(1))
+
+
+def decode(data):
+    if len(data) < 24 or data[:4] != b"RTS1":
+        raise ValueError("not an RTS1 record")
+    body, (checksum,) = data[:-4], struct.unpack_from("<I", data, len(data) - 4)
+    if fnv1a(body) != checksum:
+        raise ValueError("checksum mismatch")
+    version, count, _, cpu_hz, window = struct.unpack_from("<BBHIQ", body, 4)
+    at = 20
+    tasks = []
+    for _ in range(count):
+        number, prio, state, name_len = struct.unpack_from("<BBBB", body, at)
+        at += 4
+        name = body[at:at + name_len].decode("ascii", "replace")
+        at += name_len
+        cycles, stack_free = struct.unpack_from("<QI", body, at)
+        at += 12
+        tasks.append(dict(number=number, prio=prio, state=STATES[min(state, 5)],
+                          name=name, cycles=cycles, stack_free=stack_free))
+    return dict(version=version, cpu_hz=cpu_hz, window=window, tasks=tasks)
+
+
+def print_table(rec):
+    window = rec["window"] or 1
+    ms = rec["window"] * 1000.0 / rec["cpu_hz"] if rec["cpu_hz"] else 0.0
+    print("window %.1f ms @ %u MHz" % (ms, rec["cpu_hz"] // 1000000))
+    print("%-4s %-20s %4s %-9s %7s %12s %10s" %
+          ("#", "task", "prio", "state", "cpu%", "cycles", "stack free"))
+    for t in sorted(rec["tasks"], key=lambda t: -t["cycles"]):
+        print("%-4u %-20s %4u %-9s %6.2f%% %12u %10u" %
+              (t["number"], t["name"], t["prio"], t["state"],
+               100.0 * t["cycles"] / window, t["cycles"], t["stack_free"]))
+
+
+def print_flame(rec, width=60):
+    window = rec["window"] or 1
+    by_prio = {}
+    for t in rec["tasks"]:
+        by_prio.setdefault(t["prio"], []).append(t)
+    print()
+    for prio in sorted(by_prio, reverse=True):
+        group = sorted(by_prio[prio], key=lambda t: -t["cycles"])
+        share = sum(t["cycles"] for t in group) / window
+        print("prio %-2u %s %5.1f%%" % (prio, "#" * int(round(share * width)), share * 100))
+        for t in group:
+            part = t["cycles"] / window
+            print("   %-16s %s %5.1f%%" % (t["name"][:16], "=" * int(round(part * width)), part * 100))
+
+
+def print_folded(rec):
+    for t in rec["tasks"]:
+        if t["cycles"]:
+            print("cpu;prio%u;%s %u" % (t["prio"], t["name"].replace(" ", "_"), t["cycles"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    parser.add_argument("--folded", action="store_true", help="emit folded stacks")
+    parser.add_argument("--last", action="store_true", help="only the last record")
+    args = parser.parse_args()
+
+    decoded = []
+    for data in records(args.log):
+        try:
+            decoded.append(decode(data))
+        except (ValueError, struct.error) as err:
+            print("skipping record: %s" % err, file=sys.stderr)
+    if args.last:
+        decoded = decoded[-1:]
+    for rec in decoded:
+        if args.folded:
+            print_folded(rec)
+        else:
+            print_table(rec)
+            print_flame(rec)
+            print()
+    return 0 if decoded else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,115 @@
+// Per-frame drain cost of the latest-value table (src/signal_table.h) against
+// draining every update from a queue, with 10k updates arriving per frame.
+//
+//   g++ -std=gnu++14 -O2 -Isrc tools/signal_drain_bench.cpp -o signal_drain_bench
+//   ./signal_drain_bench [updates-per-frame [signals]]
+//
+// Each frame writes updates-per-frame (default 10000) random updates spread
+// over the given number of distinct signals (default 40) of a table the size
+// of SIGNAL_BRIDGE_TABLE_SIZE, and the same updates into an SpscRing big
+// enough to hold them, then drains both into a sink standing in for
+// Msg_SendToUI. Reported per frame: average and p99 drain time and sink
+// calls, plus the producer-side cost per update. After every drain the sink
+// state is compared with the last value written per signal; the tool exits
+// 1 on a mismatch.
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "signal_table.h"
+#include "spsc_ring.h"
+
+static const size_t TableSize = 64; // SIGNAL_BRIDGE_TABLE_SIZE
+static const size_t QueueDepth = 1U << 15;
+static const uint32_t Frames = 2000;
+
+struct Update {
+  uint32_t id;
+  int32_t value;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t nsSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+struct Timing {
+  std::vector<uint32_t> drainNs;
+  uint64_t writeNs = 0;
+  uint64_t calls = 0;
+
+  void print(const char *name, uint32_t updates) {
+    std::sort(drainNs.begin(), drainNs.end());
+    uint64_t total = 0;
+    for (uint32_t ns : drainNs) {
+      total += ns;
+    }
+    printf("%-20s drain avg %7.2f us  p99 %7.2f us  %6llu calls/frame  write %5.2f ns/update\n", name,
+           total / 1000.0 / drainNs.size(), drainNs[drainNs.size() * 99 / 100] / 1000.0,
+           (unsigned long long)(calls / drainNs.size()), writeNs / (double)drainNs.size() / updates);
+  }
+};
+
+int main(int argc, char **argv) {
+  const uint32_t updates = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000U;
+  const uint32_t signals = argc > 2 ? (uint32_t)atoi(argv[2]) : 40U;
+  if (updates == 0 || updates > QueueDepth || signals == 0 || signals > TableSize) {
+    fprintf(stderr, "updates-per-frame must be 1..%u, signals 1..%u\n", (unsigned)QueueDepth, (unsigned)TableSize);
+    return 2;
+  }
+
+  static LatestValueTable<TableSize> table;
+  static SpscRing<Update, QueueDepth> queue;
+  std::vector<Update> frame(updates);
+  int32_t expected[TableSize] = {};
+  int32_t sinkTable[TableSize] = {};
+  int32_t sinkQueue[TableSize] = {};
+  Timing tableTiming, queueTiming;
+  tableTiming.drainNs.reserve(Frames);
+  queueTiming.drainNs.reserve(Frames);
+
+  uint32_t seed = 0x2545F491U;
+  for (uint32_t f = 0; f < Frames; f++) {
+    for (Update &u : frame) {
+      seed = seed * 1664525U + 1013904223U;
+      u.id = (seed >> 8) % signals;
+      u.value = (int32_t)(seed ^ f);
+      expected[u.id] = u.value;
+    }
+
+    Clock::time_point start = Clock::now();
+    for (const Update &u : frame) {
+      (void)table.set(u.id, u.value);
+    }
+    tableTiming.writeNs += nsSince(start);
+    start = Clock::now();
+    tableTiming.calls += table.drain([&](size_t slot, int32_t value) { sinkTable[slot] = value; });
+    tableTiming.drainNs.push_back((uint32_t)nsSince(start));
+
+    start = Clock::now();
+    for (const Update &u : frame) {
+      (void)queue.push(u);
+    }
+    queueTiming.writeNs += nsSince(start);
+    start = Clock::now();
+    queueTiming.calls += queue.drain([&](const Update &u) { sinkQueue[u.id] = u.value; });
+    queueTiming.drainNs.push_back((uint32_t)nsSince(start));
+
+    for (uint32_t id = 0; id < signals; id++) {
+      if (sinkTable[id] != expected[id] || sinkQueue[id] != expected[id]) {
+        printf("frame %u, signal %u: table %d, queue %d, expected %d\n", (unsigned)f, (unsigned)id,
+               (int)sinkTable[id], (int)sinkQueue[id], (int)expected[id]);
+        return 1;
+      }
+    }
+  }
+
+  printf("%u frames, %u updates/frame over %u signals\n", (unsigned)Frames, (unsigned)updates, (unsigned)signals);
+  tableTiming.print("latest-value table", updates);
+  queueTiming.print("queue, every update", updates);
+  return queue.dropped() == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Replays a "touch dump" console capture through TouchFilter on the host and
+// reports how far the delivered position is from where the finger actually
+// was when the frame reached the panel.
+//
+//   g++ -std=gnu++14 -O2 -Isrc tools/touch_replay.cpp src/touch_filter.cpp -o touch_replay
+//   ./touch_replay [--lead-us N] [--no-predict] [--max-filtered-mean PX]
+//                  [--max-predicted-mean PX] capture.log
+//
+// The dump format is documented in src/touch_gt911.cpp: one "TCH <us> <n>
+// [<id> <x> <y>]..." line per controller report. The true position at
+// report time + lead is interpolated from the later raw samples of the same
+// stroke; reports whose stroke ends before then are skipped. Three columns
+// are printed: the raw sample as delivered before the input stage existed,
+// the filtered position, and the filtered position extrapolated by the lead.
+//
+// tools/traces/swipe.log is a synthetic 20-stroke swipe trace written by
+// tools/traces/swipe.py (see there for how it is made); the TouchFilter
+// defaults were tuned on it. With those defaults it replays as:
+//
+//   $ ./touch_replay tools/traces/swipe.log
+//   1090 reports, lead 25000 us
+//   raw        mean  22.24 px  p95  73.09 px  max 128.68 px
+//   filtered   mean  24.45 px  p95  77.25 px  max 133.38 px
+//   predicted  mean   8.05 px  p95  25.83 px  max  53.45 px
+//
+// The --max-*-mean bounds turn the replay into a check: it prints FAIL and
+// exits 1 when a mean error exceeds its bound. For this trace
+//
+//   ./touch_replay --max-filtered-mean 25 --max-predicted-mean 8.5 tools/traces/swipe.log
+//
+// passes with the defaults above and catches a filter change that makes
+// either stage worse. A change that moves these numbers should say why and
+// update the bounds. Replay a board capture ("touch rec", swipe, "touch
+// dump") before retuning on it.
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "touch_filter.h"
+
+struct Point {
+  uint8_t id;
+  float x;
+  float y;
+};
+
+struct Report {
+  uint32_t timeUs;
+  std::vector<Point> points;
+};
+
+struct Errors {
+  std::vector<float> samples;
+
+  void add(float error) { samples.push_back(error); }
+
+  // Prints the statistics and returns the mean, 0 without samples.
+  double print(const char *name) {
+    if (samples.empty()) {
+      printf("%-10s no samples\n", name);
+      return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (float error : samples) {
+      sum += error;
+    }
+    const size_t p95 = (samples.size() * 95) / 100;
+    printf("%-10s mean %6.2f px  p95 %6.2f px  max %6.2f px\n", name, sum / samples.size(),
+           samples[std::min(p95, samples.size() - 1)], samples.back());
+    return sum / samples.size();
+  }
+};
+
+// False, after saying so, if mean exceeds a bound given (> 0).
+static bool withinBound(const char *name, double mean, double bound) {
+  if (bound > 0 && mean > bound) {
+    printf("FAIL: %s mean %.2f px above %.2f px\n", name, mean, bound);
+    return false;
+  }
+  return true;
+}
+
+static std::vector<Report> load(FILE *in) {
+  std::vector<Report> reports;
+  char line[512];
+  while (fgets(line, sizeof(line), in) != nullptr) {
+    const char *tag = strstr(line, "TCH ");
+    if (tag == nullptr || tag[4] == '.') {
+      continue;
+    }
+    char *cursor = const_cast<char *>(tag + 4);
+    Report report;
+    report.timeUs = (uint32_t)strtoul(cursor, &cursor, 10);
+    const unsigned count = (unsigned)strtoul(cursor, &cursor, 10);
+    for (unsigned i = 0; i < count; i++) {
+      Point point;
+      point.id = (uint8_t)strtoul(cursor, &cursor, 10);
+      point.x = strtof(cursor, &cursor);
+      point.y = strtof(cursor, &cursor);
+      report.points.push_back(point);
+    }
+    reports.push_back(report);
+  }
+  return reports;
+}
+
+static const Point *find(const Report &report, uint8_t id) {
+  for (const Point &point : report.points) {
+    if (point.id == id) {
+      return &point;
+    }
+  }
+  return nullptr;
+}
+
+// Raw position of contact id at timeUs, interpolated between the samples of
+// the stroke that starts at or before report index. False once it lifted.
+static bool truth(const std::vector<Report> &reports, size_t index, uint8_t id, uint32_t timeUs,
+                  float &x, float &y) {
+  for (size_t i = index; i + 1 < reports.size(); i++) {
+    const Point *a = find(reports[i], id);
+    const Point *b = find(reports[i + 1], id);
+    if (a == nullptr || b == nullptr) {
+      return false;
+    }
+    const int32_t span = (int32_t)(reports[i + 1].timeUs - reports[i].timeUs);
+    const int32_t into = (int32_t)(timeUs - reports[i].timeUs);
+    if (span > 0 && into <= span) {
+      const float t = (float)into / (float)span;
+      x = a->x + (b->x - a->x) * t;
+      y = a->y + (b->y - a->y) * t;
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  uint32_t leadUs = 25000; // 1.5 frames at 60 Hz
+  bool predict = true;
+  double maxFiltered = 0;
+  double maxPredicted = 0;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--lead-us") == 0 && i + 1 < argc) {
+      leadUs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--no-predict") == 0) {
+      predict = false;
+    } else if (strcmp(argv[i], "--max-filtered-mean") == 0 && i + 1 < argc) {
+      maxFiltered = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--max-predicted-mean") == 0 && i + 1 < argc) {
+      maxPredicted = atof(argv[++i]);
+    } else {
+      path = argv[i];
+    }
+  }
+  FILE *in = path != nullptr ? fopen(path, "r") : stdin;
+  if (in == nullptr) {
+    perror(path);
+    return 1;
+  }
+  const std::vector<Report> reports = load(in);
+  if (reports.empty()) {
+    fprintf(stderr, "no TCH lines found\n");
+    return 1;
+  }
+
+  TouchFilter filter;
+  Errors raw;
+  Errors filtered;
+  Errors predicted;
+  uint16_t down = 0;
+  for (size_t i = 0; i < reports.size(); i++) {
+    const Report &report = reports[i];
+    uint16_t now = 0;
+    for (const Point &point : report.points) {
+      filter.update(point.id, point.x, point.y, report.timeUs);
+      now |= (uint16_t)(1U << point.id);
+    }
+    for (uint8_t id = 0; id < 16; id++) {
+      if ((down & ~now) & (1U << id)) {
+        filter.release(id);
+      }
+    }
+    down = now;
+
+    for (const Point &point : report.points) {
+      float tx, ty;
+      if (!truth(reports, i, point.id, report.timeUs + leadUs, tx, ty)) {
+        continue;
+      }
+      float fx, fy, px, py;
+      filter.position(point.id, fx, fy);
+      filter.predict(point.id, report.timeUs + leadUs, px, py);
+      if (!predict) {
+        px = fx;
+        py = fy;
+      }
+      raw.add(hypotf(point.x - tx, point.y - ty));
+      filtered.add(hypotf(fx - tx, fy - ty));
+      predicted.add(hypotf(px - tx, py - ty));
+    }
+  }
+
+  printf("%zu reports, lead %u us\n", reports.size(), (unsigned)leadUs);
+  raw.print("raw");
+  bool ok = withinBound("filtered", filtered.print("filtered"), maxFiltered);
+  ok &= withinBound("predicted", predicted.print("predicted"), maxPredicted);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+"""Write the synthetic swipe trace tools/traces/swipe.log.
+
+The trace is in the "touch dump" format (src/touch_gt911.cpp) and stands in
+for a board capture so tools/touch_replay.cpp can be run without hardware.
+Twenty single-finger strokes start at (400, 240). Each moves 200..700 px in a
+random direction with an ease-in-out profile over 150..500 ms, then holds
+for 200 ms before lifting. Reports come every 10 ms (0.7 ms jitter), the GT911
+rate, and each sample carries 1 px of Gaussian noise, rounded to whole pixels
+as the controller reports them. The seed is fixed, so rerunning this
+reproduces swipe.log byte for byte.
+
+    python3 tools/traces/swipe.py > tools/traces/swipe.log
+"""
+
+import math
+import random
+import sys
+
+
+def main():
+    rng = random.Random(1)
+    t = 0
+    for _ in range(20):
+        duration = rng.uniform(0.15, 0.5)
+        distance = rng.uniform(200, 700)
+        angle = rng.uniform(0, 6.28)
+        s = 0.0
+        while s < duration + 0.2:
+            u = min(s / duration, 1.0)
+            eased = 0.5 - 0.5 * math.cos(math.pi * u)
+            x = 400 + distance * eased * math.cos(angle) + rng.gauss(0, 1.0)
+            y = 240 + distance * eased * math.sin(angle) + rng.gauss(0, 1.0)
+            sys.stdout.write("TCH %d 1 0 %d %d\n" % (t, round(x), round(y)))
+            dt = rng.gauss(0.010, 0.0007)
+            s += dt
+            t += int(dt * 1e6)
+        sys.stdout.write("TCH %d 0\n" % t)
+        t += 300000
+    sys.stdout.write("TCH .\n")
+
+
+if __name__ == "__main__":
+    main()